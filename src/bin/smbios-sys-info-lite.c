@@ -22,10 +22,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
 #include <locale.h>
 #include <libintl.h>
+#include <pthread.h>
+#include <unistd.h>     // sysconf()
 
+#include "smbios_c/obj/cmos.h"
 #include "smbios_c/obj/memory.h"
+#include "smbios_c/obj/smbios.h"
 #include "smbios_c/system_info.h"
 #include "smbios_c/smbios.h"
 
@@ -38,8 +44,15 @@
 /*  0x0B is the OEM Strings smbios structure    */
 #define SMBIOS_TBL_OEM_Strings      0x0B
 
+#define MAX_JOBS 64
+
+enum { FORMAT_JSON, FORMAT_CSV };
+
 struct options opts[] =
     {
+        { 251, "batch", N_("Print one record per system dump directory. The directories follow the options, or are read from stdin, one per line"), "b", 0 },
+        { 252, "format", N_("Batch record format: json (default) or csv"), "f", 1 },
+        { 253, "jobs", N_("Number of batch worker threads (default: one per CPU)"), "j", 1 },
         { 254, "memory_file", N_("Debug: Memory dump file to use instead of physical memory"), "m", 1 },
         { 255, "version", N_("Display libsmbios version information"), "v", 0 },
         { 0, NULL, NULL, NULL, 0 }
@@ -61,11 +74,344 @@ static void print_oem_strings()
     }
 }
 
+/*
+ * Batch mode. Each dump directory (the layout smbios-get-ut-data writes) is
+ * read with its own memory, cmos and table objects and
+ * sysinfo_snapshot_from(), so the workers share nothing but the queue
+ * below. Records are printed in input order, each as soon as all earlier
+ * ones are done.
+ */
+struct record
+{
+    char *buf;
+    size_t len;
+    size_t size;
+};
+
+static void record_printf(struct record *r, const char *fmt, ...)
+{
+    for (;;)
+    {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(r->buf ? r->buf + r->len : 0, r->size - r->len, fmt, ap);
+        va_end(ap);
+        if (n < 0)
+            return;
+        if (r->len + n < r->size)
+        {
+            r->len += n;
+            return;
+        }
+
+        size_t size = r->size ? r->size : 256;
+        while (size <= r->len + n)
+            size *= 2;
+        char *buf = realloc(r->buf, size);
+        if (!buf)
+            return;
+        r->buf = buf;
+        r->size = size;
+    }
+}
+
+static void record_json_string(struct record *r, const char *str)
+{
+    if (!str)
+    {
+        record_printf(r, "null");
+        return;
+    }
+
+    record_printf(r, "\"");
+    for (; *str; ++str)
+    {
+        unsigned char ch = *str;
+        if (ch == '"' || ch == '\\')
+            record_printf(r, "\\%c", ch);
+        else if (ch < 0x20)
+            record_printf(r, "\\u%04x", ch);
+        else
+            record_printf(r, "%c", ch);
+    }
+    record_printf(r, "\"");
+}
+
+static void record_csv_string(struct record *r, const char *str)
+{
+    if (!str)
+        return;
+    if (!strpbrk(str, ",\"\r\n"))
+    {
+        record_printf(r, "%s", str);
+        return;
+    }
+
+    record_printf(r, "\"");
+    for (; *str; ++str)
+        record_printf(r, *str == '"' ? "\"\"" : "%c", *str);
+    record_printf(r, "\"");
+}
+
+static void record_csv_id(struct record *r, int id)
+{
+    if (id)
+        record_printf(r, "0x%04X", id);
+}
+
+static struct sysinfo_snapshot *read_dump(const char *dir)
+{
+    struct memory_access_obj *memory = 0;
+    struct cmos_access_obj *cmos = 0;
+    struct smbios_table *table = 0;
+    struct sysinfo_snapshot *snap = 0;
+    FILE *f;
+
+    char *path = malloc(strlen(dir) + sizeof("/cmos.dat"));
+    if (!path)
+        return 0;
+
+    memory = memory_obj_factory(MEMORY_GET_NEW | MEMORY_UNIT_TEST_MODE, dir);
+    sprintf(path, "%s/cmos.dat", dir);
+    cmos = cmos_obj_factory(CMOS_GET_NEW | CMOS_UNIT_TEST_MODE, path);
+
+    // newer dumps carry the table the kernel exports. older ones only have
+    // the memory image, with the entry point in it
+    sprintf(path, "%s/DMI", dir);
+    f = fopen(path, "rb");
+    if (f)
+    {
+        fclose(f);
+        table = smbios_table_factory(SMBIOS_GET_NEW | SMBIOS_UNIT_TEST_MODE | SMBIOS_NO_FIXUPS, dir);
+    }
+    else if (memory)
+        table = smbios_table_factory(SMBIOS_GET_NEW | SMBIOS_FROM_MEMORY, memory);
+
+    if (table)
+        snap = sysinfo_snapshot_from(table, memory, cmos);
+
+    smbios_table_free(table);
+    cmos_obj_free(cmos);
+    memory_obj_free(memory);
+    free(path);
+    return snap;
+}
+
+// one line of output. *ok is false if the dump could not be read
+static char *batch_record(const char *dir, int format, bool *ok)
+{
+    struct record r;
+    struct sysinfo_snapshot *snap = read_dump(dir);
+    const char *error = snap ? 0 : _("no readable SMBIOS table");
+
+    memset(&r, 0, sizeof(r));
+    *ok = (snap != 0);
+    if (format == FORMAT_CSV)
+    {
+        record_csv_string(&r, dir);
+        if (snap)
+        {
+            const char *str[] = { snap->vendor_name, snap->system_name, snap->bios_version, snap->service_tag, snap->asset_tag };
+            for (size_t i = 0; i < sizeof(str)/sizeof(str[0]); ++i)
+            {
+                record_printf(&r, ",");
+                record_csv_string(&r, str[i]);
+            }
+            record_printf(&r, ",");
+            record_csv_id(&r, snap->dell_system_id);
+            record_printf(&r, ",");
+            record_csv_id(&r, snap->dell_oem_system_id);
+            record_printf(&r, ",");
+        }
+        else
+            record_printf(&r, ",,,,,,,,");
+        record_csv_string(&r, error);
+    }
+    else
+    {
+        record_printf(&r, "{\"dir\": ");
+        record_json_string(&r, dir);
+        if (snap)
+        {
+            record_printf(&r, ", \"vendor\": ");
+            record_json_string(&r, snap->vendor_name);
+            record_printf(&r, ", \"system\": ");
+            record_json_string(&r, snap->system_name);
+            record_printf(&r, ", \"bios_version\": ");
+            record_json_string(&r, snap->bios_version);
+            record_printf(&r, ", \"service_tag\": ");
+            record_json_string(&r, snap->service_tag);
+            record_printf(&r, ", \"asset_tag\": ");
+            record_json_string(&r, snap->asset_tag);
+            record_printf(&r, ", \"system_id\": %d, \"oem_system_id\": %d",
+                          snap->dell_system_id, snap->dell_oem_system_id);
+        }
+        else
+        {
+            record_printf(&r, ", \"error\": ");
+            record_json_string(&r, error);
+        }
+        record_printf(&r, "}");
+    }
+    record_printf(&r, "\n");
+
+    sysinfo_snapshot_free(snap);
+    return r.buf;
+}
+
+struct batch_slot
+{
+    char *text;
+    bool done;
+};
+
+struct batch
+{
+    pthread_mutex_t lock;
+    char **dirs;            // from the command line, or 0 to read stdin
+    size_t num_dirs;
+    size_t next_in;         // directories handed out so far
+    size_t next_out;        // records printed so far
+    struct batch_slot *slots;   // by input index, until printed
+    size_t num_slots;
+    int format;
+    int failed;
+};
+
+// the next directory to read, allocated, or 0 when there are no more
+static char *batch_next(struct batch *b, size_t *index)
+{
+    char line[4096];
+    char *dir = 0;
+
+    pthread_mutex_lock(&b->lock);
+    if (b->dirs)
+    {
+        if (b->next_in < b->num_dirs)
+            dir = strdup(b->dirs[b->next_in]);
+    }
+    else
+    {
+        while (!dir && fgets(line, sizeof(line), stdin))
+        {
+            line[strcspn(line, "\r\n")] = 0;
+            if (line[0])
+                dir = strdup(line);
+        }
+    }
+
+    if (dir && b->next_in >= b->num_slots)
+    {
+        size_t num = b->num_slots ? b->num_slots * 2 : 64;
+        struct batch_slot *slots = realloc(b->slots, num * sizeof(*slots));
+        if (slots)
+        {
+            memset(slots + b->num_slots, 0, (num - b->num_slots) * sizeof(*slots));
+            b->slots = slots;
+            b->num_slots = num;
+        }
+        else
+        {
+            free(dir);
+            dir = 0;
+        }
+    }
+
+    if (dir)
+        *index = b->next_in++;
+    pthread_mutex_unlock(&b->lock);
+    return dir;
+}
+
+static void batch_done(struct batch *b, size_t index, char *text, bool ok)
+{
+    pthread_mutex_lock(&b->lock);
+    b->slots[index].text = text;
+    b->slots[index].done = true;
+    if (!ok || !text)
+        b->failed++;
+
+    bool printed = false;
+    while (b->next_out < b->next_in && b->slots[b->next_out].done)
+    {
+        struct batch_slot *slot = &b->slots[b->next_out++];
+        if (slot->text)
+            fputs(slot->text, stdout);
+        free(slot->text);
+        slot->text = 0;
+        printed = true;
+    }
+    if (printed)
+        fflush(stdout);
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void *batch_worker(void *arg)
+{
+    struct batch *b = (struct batch *)arg;
+    size_t index;
+    char *dir;
+
+    while ((dir = batch_next(b, &index)) != 0)
+    {
+        bool ok;
+        char *text = batch_record(dir, b->format, &ok);
+        free(dir);
+        batch_done(b, index, text, ok);
+    }
+    return 0;
+}
+
+static int run_batch(char **dirs, size_t num_dirs, int format, int jobs)
+{
+    pthread_t threads[MAX_JOBS];
+    struct batch b;
+    int started = 0;
+
+    memset(&b, 0, sizeof(b));
+    pthread_mutex_init(&b.lock, 0);
+    b.dirs = num_dirs ? dirs : 0;
+    b.num_dirs = num_dirs;
+    b.format = format;
+
+    if (jobs <= 0)
+    {
+#ifdef _SC_NPROCESSORS_ONLN
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (jobs <= 0)
+            jobs = 1;
+    }
+    if (jobs > MAX_JOBS)
+        jobs = MAX_JOBS;
+    if (b.dirs && (size_t)jobs > num_dirs)
+        jobs = num_dirs;
+
+    if (format == FORMAT_CSV)
+        printf("dir,vendor,system,bios_version,service_tag,asset_tag,system_id,oem_system_id,error\n");
+
+    for (int i = 0; i < jobs; ++i)
+        if (pthread_create(&threads[started], 0, batch_worker, &b) == 0)
+            started++;
+
+    // no threads at all still gets the work done
+    if (!started)
+        batch_worker(&b);
+
+    for (int i = 0; i < started; ++i)
+        pthread_join(threads[i], 0);
+
+    free(b.slots);
+    pthread_mutex_destroy(&b.lock);
+    return b.failed ? 1 : 0;
+}
+
 int
 main (int argc, char **argv)
 {
     int reseller_sysid = 0, sysid = 0;
-    char *str;
+    const char *str;
+    struct sysinfo_snapshot *snap = 0;
 
     setlocale(LC_ALL, "");
     bindtextdomain(GETTEXT_PACKAGE, LIBSMBIOS_LOCALEDIR);
@@ -73,10 +419,39 @@ main (int argc, char **argv)
 
     int c=0;
     char *args = 0;
+    bool batch = false;
+    int format = FORMAT_JSON;
+    int jobs = 0;
+    char *end = 0;
+    long num;
     while ( (c=getopts(argc, argv, opts, &args)) != 0 )
     {
         switch(c)
         {
+        case 251:
+            batch = true;
+            break;
+        case 252:
+            if (!strcmp(args, "csv"))
+                format = FORMAT_CSV;
+            else if (!strcmp(args, "json"))
+                format = FORMAT_JSON;
+            else
+            {
+                fprintf(stderr, _("Unknown batch format: %s\n"), args);
+                exit(1);
+            }
+            break;
+        case 253:
+            num = strtol(args, &end, 10);
+            if (end == args || *end || num <= 0)
+            {
+                fprintf(stderr, _("Invalid number of jobs: %s\n"), args);
+                exit(1);
+            }
+            // run_batch() caps it at MAX_JOBS
+            jobs = num > MAX_JOBS ? MAX_JOBS : num;
+            break;
         case 254:
             // This is for unit testing. You can specify a file that
             // contains a dump of memory to use instead of writing
@@ -93,10 +468,22 @@ main (int argc, char **argv)
         free(args);
     }
 
+    // getopts stops at the first argument that is not an option
+    if (batch)
+        return run_batch(argv + option_index, argc - option_index, format, jobs);
+
     printf(_("Libsmbios:    %s\n"), smbios_get_library_version_string());
 
+    // everything in one table walk; see sysinfo_snapshot()
+    snap = sysinfo_snapshot();
+    if (!snap)
+    {
+        printf(_("Error getting system information:    out of memory.\n"));
+        return 1;
+    }
+
     //Error handling needs to be implemented for each of these functions
-    sysid     = sysinfo_get_dell_system_id();
+    sysid     = snap->dell_system_id;
     if(sysid)
         printf(_("System ID:    0x%04X\n"), sysid);
     else
@@ -104,7 +491,7 @@ main (int argc, char **argv)
         printf(_("Error getting the System ID:    unknown error.\n"));
     }
 
-    reseller_sysid     = sysinfo_get_dell_oem_system_id();
+    reseller_sysid     = snap->dell_oem_system_id;
     if(reseller_sysid != sysid)
     {
         if(reseller_sysid)
@@ -115,7 +502,7 @@ main (int argc, char **argv)
         }
     }
 
-    str    = sysinfo_get_service_tag();
+    str    = snap->service_tag;
     if(str)
     {
         printf(_("Service Tag:  %s\n"), str);
@@ -125,47 +512,43 @@ main (int argc, char **argv)
     {
         printf(_("Error getting the Service Tag:  unknown error\n"));
     }
-    sysinfo_string_free(str);
 
-    str    = sysinfo_get_asset_tag();
+    str    = snap->asset_tag;
     if(str)
         printf(_("Asset Tag:  %s\n"), str);
     else
     {
         printf(_("Error getting the Asset Tag:  unknown error\n"));
     }
-    sysinfo_string_free(str);
 
-    str   = sysinfo_get_system_name();
+    str   = snap->system_name;
     if(str)
         printf(_("Product Name: %s\n"), str);
     else
     {
         printf(_("Error getting the System Name:    unknown error.\n"));
     }
-    sysinfo_string_free(str);
 
-    str   = sysinfo_get_bios_version();
+    str   = snap->bios_version;
     if(str)
         printf(_("BIOS Version: %s\n"), str);
     else
     {
         printf(_("Error getting the BIOS Version:    unknown error.\n"));
     }
-    sysinfo_string_free(str);
 
-    str   = sysinfo_get_vendor_name();
+    str   = snap->vendor_name;
     if(str)
         printf(_("Vendor:       %s\n"), str);
     else
     {
         printf(_("Error getting the Vendor:    unknown error.\n"));
     }
-    sysinfo_string_free(str);
 
     printf(_("Is Dell:      %d\n"), (sysid!=0));
 
     print_oem_strings();
 
+    sysinfo_snapshot_free(snap);
     return 0;
 }
@@ -0,0 +1,147 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <libintl.h>
+
+#include "smbios_c/obj/cmos.h"
+#include "smbios_c/obj/memory.h"
+#include "smbios_c/smbiosd.h"
+#include "smbios_c/system_info.h"
+
+#include "getopts.h"
+
+#define _(String) gettext(String)
+#define gettext_noop(String) String
+#define N_(String) gettext_noop (String)
+
+// retval = 0; daemon stopped by a signal, or reload done
+// retval = 1; could not start, or reload failed
+// retval = 2; error while serving
+
+struct options opts[] =
+{
+    { 1, "socket",  N_("Socket to listen on (default " SMBIOSD_DEFAULT_SOCKET ")"), "s", 1 },
+    { 2, "reload",  N_("Ask the running daemon to re-read token values and tags"), "r", 0 },
+    { 253, "cmos_file",  N_("Debug: CMOS dump file to use instead of physical cmos"), "c", 1 },
+    { 254, "memory_file", N_("Debug: Memory dump file to use instead of physical memory"), "m", 1 },
+    { 255, "version", N_("Display libsmbios version information"), "v", 0 },
+    { 0, NULL, NULL, NULL, 0 }
+};
+
+static struct smbiosd_server *server;
+
+static void stop(int sig)
+{
+    smbiosd_server_stop(server);
+}
+
+static int reload(const char *path)
+{
+    int retval = 1;
+    struct smbiosd_client *client = smbiosd_client_open(path);
+    if (client && !smbiosd_client_reload(client))
+        retval = 0;
+    else
+        fprintf(stderr, _("Reload failed:\n%s\n"), smbiosd_strerror());
+    smbiosd_client_close(client);
+    return retval;
+}
+
+int
+main (int argc, char **argv)
+{
+    int retval = 0;
+    int do_reload = 0;
+    char *path = 0;
+
+    setlocale(LC_ALL, "");
+    bindtextdomain(GETTEXT_PACKAGE, LIBSMBIOS_LOCALEDIR);
+    textdomain(GETTEXT_PACKAGE);
+
+    int c;
+    char *args = 0;
+    while ( (c=getopts(argc, argv, opts, &args)) != 0 )
+    {
+        switch(c)
+        {
+        case 1:
+            free(path);
+            path = strdup(args);
+            break;
+        case 2:
+            do_reload = 1;
+            break;
+        case 253:
+            cmos_obj_factory(CMOS_UNIT_TEST_MODE | CMOS_GET_SINGLETON, args);
+            break;
+        case 254:
+            memory_obj_factory(MEMORY_UNIT_TEST_MODE | MEMORY_GET_SINGLETON, args);
+            break;
+        case 255:
+            printf("%s\n", smbios_get_library_version_string());
+            exit(0);
+            break;
+        default:
+            break;
+        }
+        free(args);
+    }
+
+    if (do_reload)
+    {
+        retval = reload(path);
+        goto out;
+    }
+
+    // runs in the foreground; the service manager takes care of the rest
+    server = smbiosd_server_create(path);
+    if (!server)
+    {
+        fprintf(stderr, _("Could not start the daemon:\n%s\n"), smbiosd_strerror());
+        retval = 1;
+        goto out;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop;
+    sigaction(SIGTERM, &sa, 0);
+    sigaction(SIGINT, &sa, 0);
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, 0);
+
+    if (smbiosd_server_run(server))
+    {
+        fprintf(stderr, _("The daemon stopped on an error:\n%s\n"), smbiosd_strerror());
+        retval = 2;
+    }
+    smbiosd_server_free(server);
+
+out:
+    free(path);
+    exit(retval);
+}
@@ -55,6 +55,19 @@ LIBSMBIOS_C_DLL_SPEC int cmos_write_byte(u8 byte,  u32 indexPort, u32 dataPort,
  */
 LIBSMBIOS_C_DLL_SPEC int cmos_run_callbacks(bool do_update);
 
+/** Write several bytes as one update.
+ * Callbacks (checksum updates) are not run for writes between
+ * cmos_begin_write_batch() and cmos_end_write_batch(), but once at the end,
+ * if anything was written. Calls must be properly nested in equal pairs.
+ */
+LIBSMBIOS_C_DLL_SPEC void cmos_begin_write_batch();
+
+/** End a batch started with cmos_begin_write_batch().
+ * @return as cmos_run_callbacks(), 0 if the callbacks did not need to run,
+ * < 0 if there was no batch
+ */
+LIBSMBIOS_C_DLL_SPEC int cmos_end_write_batch();
+
 /** Returns string describing the last error condition.
  * Can return 0. The buffer used is guaranteed to be valid until the next call
  * to any cmos_* function. Copy the contents if you need it longer.
@@ -21,6 +21,7 @@
 // include smbios_c/compat.h first
 #include "smbios_c/compat.h"
 #include "smbios_c/types.h"
+#include "smbios_c/obj/memory.h"
 
 EXTERN_C_BEGIN;
 
@@ -67,6 +68,22 @@ LIBSMBIOS_C_DLL_SPEC int memory_write(void *buffer, u64 offset, size_t length);
  */
 LIBSMBIOS_C_DLL_SPEC s64 memory_search(const char *pat, size_t patlen, u64 start, u64 end, u64 stride);
 
+/** Search a range of physical addresses for several patterns in one pass.
+ * Every occurrence of every pattern is reported to the callback, in address
+ * order, so callers looking for e.g. "_SM_", "_SM3_", "_DMI_" and "_UP_" only
+ * have to read the segment once.
+ *  @param pats  array of patterns to search for
+ *  @param numpats  number of entries in pats
+ *  @param start  physical address offset to start search
+ *  @param end  ending physical address offset
+ *  @param stride search for patterns only where physical addresses % stride == 0
+ *  @param fn  called with pattern index and address for each match. Return
+ *  nonzero from the callback to stop the search.
+ *  @param userdata  passed unchanged to fn
+ *  @return  < 0 on failure, number of matches reported on success
+ */
+LIBSMBIOS_C_DLL_SPEC int memory_search_multi(const struct memory_search_pattern *pats, size_t numpats, u64 start, u64 end, u64 stride, memory_search_fn fn, void *userdata);
+
 // Following calls must be properly nested in equal pairs
 
 /** Optimize memory device access - request memory device be kept open between calls.
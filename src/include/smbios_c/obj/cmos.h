@@ -22,6 +22,7 @@
 // include smbios_c/compat.h first
 #include "smbios_c/compat.h"
 
+#include "smbios_c/stats.h"
 #include "smbios_c/types.h"
 
 EXTERN_C_BEGIN;
@@ -31,6 +32,7 @@ EXTERN_C_BEGIN;
 #define CMOS_GET_NEW        0x0002
 #define CMOS_UNIT_TEST_MODE 0x0004
 #define CMOS_NO_ERR_CLEAR   0x0008
+#define CMOS_FROM_BUFFER    0x0010  // args: (void *buf, size_t len). buf is borrowed, not copied
 
 // forward declaration to reduce header file deps
 struct cmos_access_obj;
@@ -49,6 +51,16 @@ typedef int (*cmos_write_callback)(const struct cmos_access_obj *, bool, void *)
 LIBSMBIOS_C_DLL_SPEC void cmos_obj_register_write_callback(struct cmos_access_obj *, cmos_write_callback, void *, void (*destruct)(void *));
 LIBSMBIOS_C_DLL_SPEC int cmos_obj_run_callbacks(const struct cmos_access_obj *m, bool do_update);
 
+// Following calls must be properly nested in equal pairs. Writes in between
+// do not run the callbacks; the outermost end runs them once, if anything
+// was written, and returns their result.
+LIBSMBIOS_C_DLL_SPEC void cmos_obj_begin_write_batch(struct cmos_access_obj *);
+LIBSMBIOS_C_DLL_SPEC int  cmos_obj_end_write_batch(struct cmos_access_obj *);
+
+// counters are only updated while libsmbios_c_stats_enabled(). returns < 0 on bad object
+LIBSMBIOS_C_DLL_SPEC int  cmos_obj_get_stats(const struct cmos_access_obj *, struct libsmbios_c_obj_stats *out);
+LIBSMBIOS_C_DLL_SPEC void cmos_obj_reset_stats(struct cmos_access_obj *);
+
 EXTERN_C_END;
 
 #endif  /* CMOS_H */
@@ -20,6 +20,7 @@
 
 // include smbios_c/compat.h first
 #include "smbios_c/compat.h"
+#include "smbios_c/stats.h"
 #include "smbios_c/types.h"
 
 EXTERN_C_BEGIN;
@@ -29,9 +30,21 @@ EXTERN_C_BEGIN;
 #define MEMORY_GET_NEW        0x0002
 #define MEMORY_UNIT_TEST_MODE 0x0004
 #define MEMORY_NO_ERR_CLEAR   0x0008
+#define MEMORY_PERSISTENT     0x0010
+#define MEMORY_FROM_BUFFER    0x0020  // args: (u64 base, void *buf, size_t len). buf is borrowed, not copied
 
 struct memory_access_obj;
 
+// one entry per anchor for memory_obj_search_multi()
+struct memory_search_pattern
+{
+    const char *pat;
+    size_t patlen;
+};
+
+// called for each match; 'which' indexes the pattern array. return nonzero to stop searching.
+typedef int (*memory_search_fn)(const struct memory_access_obj *, size_t which, u64 offset, void *userdata);
+
 // construct
 LIBSMBIOS_C_DLL_SPEC struct memory_access_obj *memory_obj_factory(int flags, ...);
 
@@ -46,14 +59,22 @@ LIBSMBIOS_C_DLL_SPEC const char *memory_obj_strerror(const struct memory_access_
 
 // helper
 LIBSMBIOS_C_DLL_SPEC s64  memory_obj_search(const struct memory_access_obj *, const char *pat, size_t patlen, u64 start, u64 end, u64 stride);
+// single pass for several anchors. returns number of matches reported, < 0 on error
+LIBSMBIOS_C_DLL_SPEC int  memory_obj_search_multi(const struct memory_access_obj *, const struct memory_search_pattern *pats, size_t numpats, u64 start, u64 end, u64 stride, memory_search_fn fn, void *userdata);
 
-// Following calls must be properly nested in equal pairs
+// Following calls must be properly nested in equal pairs. Each leave_open
+// starts a session; the device is released when the last session closes.
+// Objects created with MEMORY_PERSISTENT hold the device open until freed.
 LIBSMBIOS_C_DLL_SPEC void  memory_obj_suggest_leave_open(struct memory_access_obj *);
 LIBSMBIOS_C_DLL_SPEC void  memory_obj_suggest_close(struct memory_access_obj *);
 
 // ask if close flag is set
 LIBSMBIOS_C_DLL_SPEC bool  memory_obj_should_close(const struct memory_access_obj *);
 
+// counters are only updated while libsmbios_c_stats_enabled(). returns < 0 on bad object
+LIBSMBIOS_C_DLL_SPEC int  memory_obj_get_stats(const struct memory_access_obj *, struct libsmbios_c_obj_stats *out);
+LIBSMBIOS_C_DLL_SPEC void memory_obj_reset_stats(struct memory_access_obj *);
+
 EXTERN_C_END;
 
 #endif  /* MEMORY_H */
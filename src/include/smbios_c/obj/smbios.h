@@ -34,6 +34,8 @@ EXTERN_C_BEGIN;
 #define SMBIOS_UNIT_TEST_MODE 0x0004
 #define SMBIOS_NO_FIXUPS      0x0008
 #define SMBIOS_NO_ERR_CLEAR   0x0010
+#define SMBIOS_FROM_BUFFER    0x0020  // args: (const void *table, size_t len). table is borrowed, not copied
+#define SMBIOS_FROM_MEMORY    0x0040  // args: (struct memory_access_obj *). table is read from it, no fixups
 
 struct smbios_table;
 struct smbios_struct;
@@ -55,6 +57,18 @@ LIBSMBIOS_C_DLL_SPEC struct smbios_struct *smbios_table_get_next_struct(const st
 LIBSMBIOS_C_DLL_SPEC struct smbios_struct *smbios_table_get_next_struct_by_type(const struct smbios_table *, const struct smbios_struct *cur, u8 type);
 LIBSMBIOS_C_DLL_SPEC struct smbios_struct *smbios_table_get_next_struct_by_handle(const struct smbios_table *, const struct smbios_struct *cur, u16 handle);
 
+// Dell OEM strings (type 0x0B) items of the form "N[value]", parsed once
+// when the table is set up. Strings belong to the table.
+struct smbios_oem_tag
+{
+    int tag;
+    const char *value;  // text between the brackets
+};
+// value of the first item with this tag, or 0
+LIBSMBIOS_C_DLL_SPEC const char *smbios_table_get_dell_oem_tag(const struct smbios_table *, int tag);
+// all items in table order: returns how many, *tags gets the array
+LIBSMBIOS_C_DLL_SPEC size_t smbios_table_get_dell_oem_tags(const struct smbios_table *, const struct smbios_oem_tag **tags);
+
 #define smbios_table_for_each_struct(table_name, struct_name)  \
         for(    \
             const struct smbios_struct *struct_name = smbios_table_get_next_struct(table_name, 0);\
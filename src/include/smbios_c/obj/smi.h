@@ -20,6 +20,7 @@
 
 // include smbios_c/compat.h first
 #include "smbios_c/compat.h"
+#include "smbios_c/stats.h"
 #include "smbios_c/types.h"
 
 EXTERN_C_BEGIN;
@@ -29,10 +30,29 @@ EXTERN_C_BEGIN;
 #define DELL_SMI_GET_NEW        0x0002
 #define DELL_SMI_UNIT_TEST_MODE 0x0004
 #define DELL_SMI_NO_ERR_CLEAR   0x0008
+#define DELL_SMI_PERSISTENT     0x0010
+#define DELL_SMI_CACHE_RESULTS  0x0020
+#define DELL_SMI_GET_PER_THREAD 0x0040
 
 struct dell_smi_obj;
 
+// one entry for dell_smi_obj_execute_batch()
+struct dell_smi_request
+{
+    u16 smi_class;
+    u16 select;
+    u32 args[4];
+    u8 *buffer[4];          // optional, as for dell_smi_obj_set_buffer()
+    size_t buffer_size[4];
+    u32 res[4];             // out
+    int retval;             // out: dell_smi_obj_execute() result for this entry
+};
+
 // construct
+// DELL_SMI_DEFAULTS hands out one object per calling thread
+// (DELL_SMI_GET_PER_THREAD), owned by the library and freed at thread exit.
+// DELL_SMI_UNIT_TEST_MODE takes an init function as the next argument; a NULL
+// function selects a built-in loopback backend that needs no hardware.
 LIBSMBIOS_C_DLL_SPEC struct dell_smi_obj *dell_smi_factory(int flags, ...);
 
 // destruct
@@ -44,11 +64,86 @@ LIBSMBIOS_C_DLL_SPEC void dell_smi_obj_set_class(struct dell_smi_obj *, u16 );
 LIBSMBIOS_C_DLL_SPEC void dell_smi_obj_set_select(struct dell_smi_obj *, u16 );
 LIBSMBIOS_C_DLL_SPEC void dell_smi_obj_set_arg(struct dell_smi_obj *, u8 argno, u32 value);
 LIBSMBIOS_C_DLL_SPEC u32  dell_smi_obj_get_res(struct dell_smi_obj *, u8 argno);
+// supported command bitmap from the 0xDA structure, read when the object is
+// created. class_supported() is false only when the bitmap says so, letting
+// callers skip a round trip that would fail anyway.
+LIBSMBIOS_C_DLL_SPEC u32  dell_smi_obj_get_supported_cmds(struct dell_smi_obj *);
+LIBSMBIOS_C_DLL_SPEC bool dell_smi_obj_class_supported(struct dell_smi_obj *, u16 smi_class);
 LIBSMBIOS_C_DLL_SPEC u8  *dell_smi_obj_make_buffer_frombios_auto(struct dell_smi_obj *, u8 argno, size_t size);
 LIBSMBIOS_C_DLL_SPEC u8  *dell_smi_obj_make_buffer_frombios_withheader(struct dell_smi_obj *, u8 argno, size_t size);
 LIBSMBIOS_C_DLL_SPEC u8  *dell_smi_obj_make_buffer_frombios_withoutheader(struct dell_smi_obj *, u8 argno, size_t size);
 LIBSMBIOS_C_DLL_SPEC u8  *dell_smi_obj_make_buffer_tobios(struct dell_smi_obj *, u8 argno, size_t size);
+// use caller memory as the argument buffer, in both directions. It is not
+// copied or freed, and must stay valid until the next execute returns.
+// Replaced by the next set_arg()/make_buffer_*() on the same arg.
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_obj_set_buffer(struct dell_smi_obj *, u8 argno, u8 *buffer, size_t size);
 LIBSMBIOS_C_DLL_SPEC int  dell_smi_obj_execute(struct dell_smi_obj *);
+// run each request in order under a single lock and buffer setup. Every
+// entry is attempted and gets its own retval; strerror() describes the
+// first failure. returns the number of failed entries, < 0 if the batch
+// could not start (all entries then have retval -1)
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_obj_execute_batch(struct dell_smi_obj *, struct dell_smi_request *reqs, size_t count);
+
+// Result cache for read-only selectors (token reads, tag reads, password
+// status, ...), keyed by class, select and args. Calls with buffer args are
+// never cached. Any selector without a policy is assumed to write and
+// flushes the cache. Off unless enabled or created with DELL_SMI_CACHE_RESULTS.
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_obj_cache_enable(struct dell_smi_obj *, bool enable);
+// add or change a policy; ttl_ms 0 marks a selector read-only but uncached
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_obj_cache_set_ttl(struct dell_smi_obj *, u16 smi_class, u16 select, u32 ttl_ms);
+LIBSMBIOS_C_DLL_SPEC void dell_smi_obj_cache_invalidate(struct dell_smi_obj *);
+
+// Asynchronous execution (linux). A worker thread runs submitted requests in
+// order on 'smi', taking the same locks as dell_smi_obj_execute(). 'smi' must
+// come from DELL_SMI_GET_NEW; the singleton and per-thread default objects are
+// refused. Do not use 'smi' directly until dell_smi_async_free() returns.
+struct dell_smi_async;
+typedef void (*dell_smi_async_fn)(struct dell_smi_request *req, void *userdata);
+LIBSMBIOS_C_DLL_SPEC struct dell_smi_async *dell_smi_async_new(struct dell_smi_obj *smi);
+// waits for queued requests to run. callbacks not yet collected are dropped
+LIBSMBIOS_C_DLL_SPEC void dell_smi_async_free(struct dell_smi_async *);
+// req (and its buffers) must stay valid until its callback has run
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_async_submit(struct dell_smi_async *, struct dell_smi_request *req, dell_smi_async_fn fn, void *userdata);
+// readable while completions are waiting to be collected. for poll/epoll
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_async_fd(const struct dell_smi_async *);
+// run callbacks for finished requests in the calling thread. timeout_ms is
+// as for poll(): 0 returns at once, -1 waits for a completion. returns the
+// number of requests collected, < 0 on error
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_async_complete(struct dell_smi_async *, int timeout_ms);
+
+// Firmware emulator for tests and benchmarks (linux). Creates stand-in dcdbas
+// sysfs files (or a stand-in dell-smbios wmi device) in 'dir' and redirects
+// the kernel interface there, so the real backend code runs without Dell
+// hardware. Only one emulator can be active. Create it before the smi
+// objects that should use it. Unprogrammed selectors answer cbRES1 == -2.
+#define DELL_SMI_EMU_DCDBAS 0
+#define DELL_SMI_EMU_WMI    1
+struct dell_smi_emu;
+LIBSMBIOS_C_DLL_SPEC struct dell_smi_emu *dell_smi_emu_new(const char *dir, int interface);
+LIBSMBIOS_C_DLL_SPEC void dell_smi_emu_free(struct dell_smi_emu *);
+// answer for a class/select pair
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_emu_set_result(struct dell_smi_emu *, u16 smi_class, u16 select, const u32 res[4]);
+// also copy 'data' into the buffer the caller passed for 'argno'
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_emu_set_buffer(struct dell_smi_emu *, u16 smi_class, u16 select, u8 argno, const u8 *data, size_t size);
+// time each request takes, in microseconds
+LIBSMBIOS_C_DLL_SPEC void dell_smi_emu_set_latency(struct dell_smi_emu *, unsigned int usec);
+// requests seen for a class/select pair, or in total
+LIBSMBIOS_C_DLL_SPEC u64  dell_smi_emu_get_count(struct dell_smi_emu *, u16 smi_class, u16 select);
+LIBSMBIOS_C_DLL_SPEC u64  dell_smi_emu_get_total(struct dell_smi_emu *);
+// the most recent request as the firmware saw it. returns < 0 if none yet
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_emu_get_last_request(struct dell_smi_emu *, u16 *smi_class, u16 *select, u32 args[4]);
+
+// Following calls must be properly nested in equal pairs. Each leave_open
+// starts a session; the kernel interface files stay open until the last
+// session closes. Objects created with DELL_SMI_PERSISTENT hold them open
+// until freed.
+LIBSMBIOS_C_DLL_SPEC void dell_smi_obj_suggest_leave_open(struct dell_smi_obj *);
+LIBSMBIOS_C_DLL_SPEC void dell_smi_obj_suggest_close(struct dell_smi_obj *);
+LIBSMBIOS_C_DLL_SPEC bool dell_smi_obj_should_close(const struct dell_smi_obj *);
+
+// counters are only updated while libsmbios_c_stats_enabled(). returns < 0 on bad object
+LIBSMBIOS_C_DLL_SPEC int  dell_smi_obj_get_stats(struct dell_smi_obj *, struct libsmbios_c_obj_stats *out);
+LIBSMBIOS_C_DLL_SPEC void dell_smi_obj_reset_stats(struct dell_smi_obj *);
 
 EXTERN_C_END;
 
@@ -36,6 +36,7 @@ EXTERN_C_BEGIN;
 
 struct token_table;
 struct token_obj;
+struct dell_smi_security;
 
 // construct
 LIBSMBIOS_C_DLL_SPEC struct token_table *token_table_factory(int flags, ...);
@@ -78,6 +79,9 @@ LIBSMBIOS_C_DLL_SPEC int token_obj_set_string(const struct token_obj *, const ch
 
 LIBSMBIOS_C_DLL_SPEC const struct smbios_struct *token_obj_get_smbios_struct(const struct token_obj *);
 LIBSMBIOS_C_DLL_SPEC int token_obj_try_password(const struct token_obj *, const char *pass_ascii, const char *pass_scancode);
+// like token_obj_try_password(), but takes the key from an already verified
+// security context instead of probing the bios again for every token
+LIBSMBIOS_C_DLL_SPEC int token_obj_use_security(const struct token_obj *, struct dell_smi_security *);
 LIBSMBIOS_C_DLL_SPEC const void *token_obj_get_ptr(const struct token_obj *t);
 
 #if defined(_MSC_VER)
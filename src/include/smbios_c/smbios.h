@@ -26,6 +26,7 @@
 EXTERN_C_BEGIN;
 
 struct smbios_struct;
+struct smbios_oem_tag;
 
 /** Function for looping over smbios table structures.
  * Returns a pointer to the next smbios structure. You can cast this structure
@@ -88,6 +89,21 @@ LIBSMBIOS_C_DLL_SPEC void smbios_walk(void (*fn)(const struct smbios_struct *, v
             struct_name = smbios_get_next_struct_by_type(struct_name, struct_type)\
            )
 
+/** Value of a Dell OEM strings item.
+ * Dell OEM strings (type 0x0B) structures hold items of the form "N[value]",
+ * eg. the system ID is "1[0234]". These are parsed once per table.
+ * @param tag  the N to look for
+ * @return  the text between the brackets of the first matching item, or 0.
+ * Belongs to the table, do not free.
+ */
+LIBSMBIOS_C_DLL_SPEC const char *smbios_get_dell_oem_tag(int tag);
+
+/** All Dell OEM strings items, in table order.
+ * @param tags  gets a pointer to the array, which belongs to the table
+ * @return  number of items
+ */
+LIBSMBIOS_C_DLL_SPEC size_t smbios_get_dell_oem_tags(const struct smbios_oem_tag **tags);
+
 /** Returns the structure type of a given smbios structure. */
 LIBSMBIOS_C_DLL_SPEC u8 smbios_struct_get_type(const struct smbios_struct *);
 
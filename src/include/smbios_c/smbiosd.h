@@ -0,0 +1,139 @@
+// vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:
+/*
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef C_SMBIOSD_H
+#define C_SMBIOSD_H
+
+// include smbios_c/compat.h first
+#include "smbios_c/compat.h"
+#include "smbios_c/types.h"
+
+EXTERN_C_BEGIN;
+
+/** Inventory daemon.
+ * smbiosd reads the SMBIOS table, the token list with the current token
+ * values and a sysinfo_snapshot() once, then answers read queries from those
+ * copies over a local socket. Clients need no access to firmware, memory,
+ * CMOS or SMI. Only available on Linux; elsewhere the functions fail.
+ */
+
+//! Socket used when 0 is passed for the path and SMBIOSD_SOCKET_ENV is unset
+#define SMBIOSD_DEFAULT_SOCKET "/run/libsmbios/smbiosd.sock"
+//! Environment variable overriding the default socket path
+#define SMBIOSD_SOCKET_ENV "LIBSMBIOS_C_SMBIOSD_SOCKET"
+
+#define SMBIOSD_TOKEN_BOOL    0x01  //!< token is a boolean
+#define SMBIOSD_TOKEN_STRING  0x02  //!< token is a string
+#define SMBIOSD_TOKEN_ACTIVE  0x04  //!< boolean token was active
+#define SMBIOSD_TOKEN_ERROR   0x08  //!< value could not be read
+
+//! A token as the daemon last read it
+struct smbiosd_token
+{
+    u16 id;
+    u8 type;            //!< as token_obj_get_type()
+    u8 flags;           //!< SMBIOSD_TOKEN_* bits
+    u16 value_len;      //!< length of value, string tokens only
+    const char *value;  //!< string token value, 0 terminated; 0 otherwise
+};
+
+struct smbiosd_server;
+struct smbiosd_client;
+struct smbios_table;
+struct sysinfo_snapshot;
+
+/** Load everything the daemon serves and start listening.
+ * The table, token and sysinfo singletons are used, so unit test data can be
+ * set up before calling this. A stale socket at path is replaced; if a
+ * daemon still answers on it, this fails.
+ * @param path socket path, or 0 for the default
+ * @return server, or 0 on error. See smbiosd_strerror().
+ */
+LIBSMBIOS_C_DLL_SPEC struct smbiosd_server *smbiosd_server_create(const char *path);
+
+/** Serve clients until smbiosd_server_stop() is called.
+ * @return 0 when stopped, negative on error
+ */
+LIBSMBIOS_C_DLL_SPEC int smbiosd_server_run(struct smbiosd_server *);
+
+/** Re-read token values and the sysinfo snapshot. The table is not re-read.
+ * @return 0 on success, negative on error (the old data is kept)
+ */
+LIBSMBIOS_C_DLL_SPEC int smbiosd_server_reload(struct smbiosd_server *);
+
+//! Make smbiosd_server_run() return. Safe to call from a signal handler.
+LIBSMBIOS_C_DLL_SPEC void smbiosd_server_stop(struct smbiosd_server *);
+
+//! Close all connections and remove the socket.
+LIBSMBIOS_C_DLL_SPEC void smbiosd_server_free(struct smbiosd_server *);
+
+/** Connect to a running daemon.
+ * @param path socket path, or 0 for the default
+ * @return client, or 0 on error. See smbiosd_strerror().
+ */
+LIBSMBIOS_C_DLL_SPEC struct smbiosd_client *smbiosd_client_open(const char *path);
+
+//! Disconnect. Frees everything the client returned.
+LIBSMBIOS_C_DLL_SPEC void smbiosd_client_close(struct smbiosd_client *);
+
+//! @return 0 if the daemon answers, negative otherwise
+LIBSMBIOS_C_DLL_SPEC int smbiosd_client_ping(struct smbiosd_client *);
+
+/** The raw SMBIOS structure table the daemon read.
+ * Fetched on first use. The buffer belongs to the client.
+ * @param len receives the table length
+ * @return table, or 0 on error
+ */
+LIBSMBIOS_C_DLL_SPEC const void *smbiosd_client_get_table_buffer(struct smbiosd_client *, size_t *len);
+
+/** The same table as a smbios_table object, for the smbios_table_* calls.
+ * The table belongs to the client; do not free it.
+ * @return table, or 0 on error
+ */
+LIBSMBIOS_C_DLL_SPEC struct smbios_table *smbiosd_client_get_table(struct smbiosd_client *);
+
+/** The daemon's sysinfo_snapshot().
+ * @return snapshot, or 0 on error. Deallocate with sysinfo_snapshot_free().
+ */
+LIBSMBIOS_C_DLL_SPEC struct sysinfo_snapshot *smbiosd_client_get_snapshot(struct smbiosd_client *);
+
+/** All tokens, in token table order.
+ * Fetched on first use. The array belongs to the client.
+ * @param tokens receives the array, or 0 on error
+ * @return number of tokens
+ */
+LIBSMBIOS_C_DLL_SPEC size_t smbiosd_client_get_tokens(struct smbiosd_client *, const struct smbiosd_token **tokens);
+
+/** One token. Uses the token list if it was already fetched, otherwise asks
+ * for just this token. The result is valid until the next call or until the
+ * client is closed.
+ * @return token, or 0 if there is no such token or on error
+ */
+LIBSMBIOS_C_DLL_SPEC const struct smbiosd_token *smbiosd_client_get_token(struct smbiosd_client *, u16 id);
+
+/** Ask the daemon to smbiosd_server_reload(). Only root may do this.
+ * Token values the client already fetched are dropped.
+ * @return 0 on success, negative on error
+ */
+LIBSMBIOS_C_DLL_SPEC int smbiosd_client_reload(struct smbiosd_client *);
+
+//! Description of the last server or client error, or 0
+LIBSMBIOS_C_DLL_SPEC const char *smbiosd_strerror();
+
+EXTERN_C_END;
+
+#endif  /* C_SMBIOSD_H */
@@ -21,6 +21,7 @@
 // include smbios_c/compat.h first
 #include "smbios_c/compat.h"
 #include "smbios_c/types.h"
+#include "smbios_c/obj/smi.h"
 
 EXTERN_C_BEGIN;
 
@@ -39,8 +40,13 @@ LIBSMBIOS_C_DLL_SPEC const char *dell_smi_strerror();
 
 LIBSMBIOS_C_DLL_SPEC int dell_simple_ci_smi(u16 smiClass, u16 select, const u32 args[4], u32 res[4]);
 
-// not yet implemented
-LIBSMBIOS_C_DLL_SPEC int dell_adv_ci_smi(u16 smiClass, u16 select, const u32 args[4], u32 res[4], const u8 *buffer[4], const size_t buffer_size[4]);
+// like dell_simple_ci_smi(), but any arg with a non-NULL buffer[] entry is
+// passed to the BIOS as a pointer to that buffer instead of args[]. The
+// buffers are used in place (no copies kept) and receive the BIOS output.
+LIBSMBIOS_C_DLL_SPEC int dell_adv_ci_smi(u16 smiClass, u16 select, const u32 args[4], u32 res[4], u8 *buffer[4], const size_t buffer_size[4]);
+
+// dell_smi_obj_execute_batch() on the calling thread's default smi object
+LIBSMBIOS_C_DLL_SPEC int dell_smi_batch(struct dell_smi_request *reqs, size_t count);
 
 LIBSMBIOS_C_DLL_SPEC int dell_smi_read_nv_storage         (u32 location, u32 *curValue, u32 *minValue, u32 *maxValue);
 LIBSMBIOS_C_DLL_SPEC int dell_smi_read_battery_mode_setting(u32 location, u32 *curValue, u32 *minValue, u32 *maxValue);
@@ -61,6 +67,26 @@ LIBSMBIOS_C_DLL_SPEC int dell_smi_password_max_len(int which);
 LIBSMBIOS_C_DLL_SPEC int dell_smi_password_min_len(int which);
 LIBSMBIOS_C_DLL_SPEC int dell_smi_password_change(int which, const char *oldpass, const char *newpass);
 
+// security context: holds a password pair and verifies it against the BIOS
+// only once, on first use. Afterwards the key, the password type that
+// produced it and that password's format are answered from the context, so
+// a whole series of protected writes costs a single verification.
+// Call dell_smi_security_invalidate() after changing the BIOS password.
+struct dell_smi_security;
+LIBSMBIOS_C_DLL_SPEC struct dell_smi_security *dell_smi_security_new(const char *pass_ascii, const char *pass_scancode);
+LIBSMBIOS_C_DLL_SPEC void dell_smi_security_free(struct dell_smi_security *);
+LIBSMBIOS_C_DLL_SPEC void dell_smi_security_invalidate(struct dell_smi_security *);
+// same return codes as dell_smi_get_security_key(): 0 ok, -1 bad password, -2 smi failure
+LIBSMBIOS_C_DLL_SPEC int dell_smi_security_get_key(struct dell_smi_security *, u16 *security_key);
+// DELL_SMI_PASSWORD_ADMIN/USER that verified, or DELL_SMI_PASSWORD_ANY if none is installed
+LIBSMBIOS_C_DLL_SPEC int dell_smi_security_password_type(struct dell_smi_security *);
+LIBSMBIOS_C_DLL_SPEC int dell_smi_security_password_format(struct dell_smi_security *);
+
+// dell_smi_write_*() taking the key from a security context
+LIBSMBIOS_C_DLL_SPEC int dell_smi_security_write_nv_storage         (struct dell_smi_security *, u32 location, u32 value, u32 *smiret);
+LIBSMBIOS_C_DLL_SPEC int dell_smi_security_write_battery_mode_setting(struct dell_smi_security *, u32 location, u32 value, u32 *smiret);
+LIBSMBIOS_C_DLL_SPEC int dell_smi_security_write_ac_mode_setting     (struct dell_smi_security *, u32 location, u32 value, u32 *smiret);
+
 EXTERN_C_END;
 
 #endif  /* C_SMI_H */
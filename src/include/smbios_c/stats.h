@@ -0,0 +1,81 @@
+// vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:
+/*
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef C_STATS_H
+#define C_STATS_H
+
+// include smbios_c/compat.h first
+#include "smbios_c/compat.h"
+#include "smbios_c/types.h"
+
+#include <stdio.h>
+
+EXTERN_C_BEGIN;
+
+/** Number of buckets in a latency histogram.
+ * Bucket N counts operations that took [2^N, 2^(N+1)) nanoseconds; the last
+ * bucket also collects everything slower.
+ */
+#define LIBSMBIOS_C_STATS_BUCKETS 32
+
+/** Counters for one kind of operation (read, write, execute). */
+struct libsmbios_c_op_stats
+{
+    u64 calls;      /**< number of operations */
+    u64 errors;     /**< operations that returned non-zero */
+    u64 bytes;      /**< bytes transferred */
+    u64 total_ns;   /**< summed latency */
+    u64 max_ns;     /**< slowest single operation */
+    u64 hist[LIBSMBIOS_C_STATS_BUCKETS]; /**< log2 latency histogram */
+};
+
+/** Per-object counters.
+ * For memory and cmos objects, read/write are the byte accessors. For SMI
+ * objects, "read" counts dell_smi_obj_execute() calls and "write" is unused.
+ */
+struct libsmbios_c_obj_stats
+{
+    struct libsmbios_c_op_stats read;
+    struct libsmbios_c_op_stats write;
+    u64 remaps;     /**< memory: mmap window changes */
+    u64 reopens;    /**< memory: device (re)opens */
+    u64 callbacks;  /**< cmos: write callbacks run */
+};
+
+/** Turn statistics collection on or off for all objects.
+ * Collection is off by default. Setting the LIBSMBIOS_C_STATS environment
+ * variable to a value > 0 turns it on at load time and also prints a
+ * per-module summary to stderr when the process exits.
+ * Counting is not atomic: objects shared between threads may lose counts.
+ */
+LIBSMBIOS_C_DLL_SPEC void libsmbios_c_stats_enable(bool enable);
+
+/** Check whether statistics collection is on.
+ *  @return true if counters are being updated
+ */
+LIBSMBIOS_C_DLL_SPEC bool libsmbios_c_stats_enabled(void);
+
+/** Print a summary of process-wide counters.
+ * Totals for each module include the singleton plus every object freed so
+ * far.
+ *  @param fp  stream to print to (normally stderr)
+ */
+LIBSMBIOS_C_DLL_SPEC void libsmbios_c_stats_print(FILE *fp);
+
+EXTERN_C_END;
+
+#endif  /* C_STATS_H */
@@ -25,6 +25,11 @@
 
 EXTERN_C_BEGIN;
 
+struct dell_smi_security;
+struct smbios_table;
+struct memory_access_obj;
+struct cmos_access_obj;
+
 /** Return a string representing the version of the libsmbios library.
  * This string is statically allocated in the library, so there is no need to
  * free it when done.
@@ -65,6 +70,37 @@ LIBSMBIOS_C_DLL_SPEC  int  sysinfo_get_dell_system_id();
  */
 LIBSMBIOS_C_DLL_SPEC  int  sysinfo_get_dell_oem_system_id();
 
+//! Suggested directory for sysinfo_id_cache_set_dir()
+#define SYSINFO_ID_CACHE_DEFAULT_DIR "/run/libsmbios"
+
+/** Keep the Dell system IDs in an on-disk cache.
+ * The IDs, and the ID byte the SMBIOS table fixups look at, cannot change
+ * before the next reboot, so once found they are written to a small file in
+ * 'dir', keyed by the kernel boot id and a hash of the SMBIOS table. Later
+ * lookups, also from other processes, read that file instead of probing
+ * memory and walking the table. Off by default; LIBSMBIOS_C_ID_CACHE=1 in
+ * the environment turns it on in SYSINFO_ID_CACHE_DEFAULT_DIR (ignored in
+ * setuid programs). Linux only.
+ * @param dir  directory, created if needed (0 turns the cache off)
+ * @return 0 on success, < 0 on failure
+ */
+LIBSMBIOS_C_DLL_SPEC int sysinfo_id_cache_set_dir(const char *dir);
+
+#define SYSINFO_DEFAULTS      0x0000
+#define SYSINFO_FORCE_TABLE   0x0001  // never use the kernel's /sys/class/dmi/id strings
+
+/** Set process wide flags for the sysinfo_get_* functions.
+ * By default the vendor name, system name, bios version, service tag and
+ * asset tag are read from the strings the kernel exports in
+ * /sys/class/dmi/id when it has them, which needs neither root nor loading
+ * the SMBIOS table. SYSINFO_FORCE_TABLE always reads the table instead.
+ * The kernel files are also skipped when the SMBIOS singleton was set up from
+ * a caller buffer. sysinfo_snapshot() always reads the table.
+ * @param flags SYSINFO_DEFAULTS or SYSINFO_FORCE_TABLE
+ * @return previous flags
+ */
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_flags(int flags);
+
 /** Return a buffer containing the system vendor name.
  * Return value *must* be de-allocated using sysinfo_string_free(), or memory
  * will leak.
@@ -121,6 +157,11 @@ LIBSMBIOS_C_DLL_SPEC char * sysinfo_get_property_ownership_tag();
  */
 LIBSMBIOS_C_DLL_SPEC int sysinfo_set_property_ownership_tag(const char *newTag, const char *pass_ascii, const char *pass_scancode);
 
+/** Same as sysinfo_set_property_ownership_tag(), but takes the password from
+ * a security context (see dell_smi_security_new()).
+ */
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_property_ownership_tag_security(const char *newTag, struct dell_smi_security *sec);
+
 /** set the system asset tag.
  * Note some systems store password in ascii and some store keyboard scancodes. Thus you must pass both.
  * @param assetTag  null-terminated new asset tag string
@@ -133,6 +174,149 @@ LIBSMBIOS_C_DLL_SPEC int sysinfo_set_property_ownership_tag(const char *newTag,
  */
 LIBSMBIOS_C_DLL_SPEC int sysinfo_set_asset_tag(const char *assetTag, const char *pass_ascii, const char *pass_scancode);
 
+/** Same as sysinfo_set_asset_tag(), but takes the password from a security
+ * context (see dell_smi_security_new()).
+ */
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_asset_tag_security(const char *assetTag, struct dell_smi_security *sec);
+
+/** set the system service tag.
+ * Only manufacturing software should need this. Passwords are handled the
+ * same as for sysinfo_set_asset_tag().
+ * @return 0 == success, -1 == general failure, -2 == password incorrect
+ */
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_service_tag(const char *serviceTag, const char *pass_ascii, const char *pass_scancode);
+
+/** Same as sysinfo_set_service_tag(), but takes the password from a security
+ * context (see dell_smi_security_new()).
+ */
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_service_tag_security(const char *serviceTag, struct dell_smi_security *sec);
+
+#define SYSINFO_SVC_TAG_LEN       7   //!< max characters in a service tag
+#define SYSINFO_SVC_TAG_CMOS_LEN  5   //!< bytes of a service tag image in CMOS
+
+// status bits for the service tag codec functions below
+#define SYSINFO_SVC_TAG_UNCODED   0x01  //!< short tag stored as plain text
+#define SYSINFO_SVC_TAG_BAD_CHAR  0x02  //!< character other than 0-9 or a consonant
+#define SYSINFO_SVC_TAG_TOO_LONG  0x04  //!< encode: over SYSINFO_SVC_TAG_LEN chars, rest ignored
+#define SYSINFO_SVC_TAG_ERRORS    (SYSINFO_SVC_TAG_BAD_CHAR | SYSINFO_SVC_TAG_TOO_LONG)
+
+/** Decode raw CMOS service tag images.
+ * Dell BIOSes pack 7-character service tags into 5 bytes of CMOS; tags of up
+ * to 5 characters are stored as plain text. This is the decoding the library
+ * uses when reading the tag from CMOS, without the CMOS access, so archived
+ * images can be decoded in bulk.
+ * @param images  count images of SYSINFO_SVC_TAG_CMOS_LEN bytes, back to back
+ * @param count   number of images
+ * @param tags    out: count nul terminated tags of SYSINFO_SVC_TAG_LEN + 1
+ * bytes each, back to back. Invalid digits decode as '['.
+ * @param status  out, may be 0: SYSINFO_SVC_TAG_* bits for each tag
+ * @return number of tags without SYSINFO_SVC_TAG_ERRORS bits
+ */
+LIBSMBIOS_C_DLL_SPEC size_t sysinfo_decode_service_tags(const u8 *images, size_t count, char *tags, int *status);
+
+/** Encode service tags into CMOS images, the inverse of
+ * sysinfo_decode_service_tags(). Lower case is accepted and decodes back as
+ * upper case, except for the first character, which is stored as is.
+ * Characters that cannot be coded become '0', as does the missing seventh
+ * character of a 6-character tag.
+ * @param tags    count nul terminated tags of SYSINFO_SVC_TAG_LEN + 1 bytes each
+ * @param count   number of tags
+ * @param images  out: count images of SYSINFO_SVC_TAG_CMOS_LEN bytes
+ * @param status  out, may be 0: SYSINFO_SVC_TAG_* bits for each tag
+ * @return number of tags without SYSINFO_SVC_TAG_ERRORS bits
+ */
+LIBSMBIOS_C_DLL_SPEC size_t sysinfo_encode_service_tags(const char *tags, size_t count, u8 *images, int *status);
+
+//! Where a sysinfo_snapshot value came from
+enum sysinfo_source
+{
+    SYSINFO_SRC_NONE = 0,           //!< not found
+    SYSINFO_SRC_BIOS_INFO,          //!< SMBIOS BIOS Information (type 0)
+    SYSINFO_SRC_SYSTEM_INFO,        //!< SMBIOS System Information (type 1)
+    SYSINFO_SRC_ENCLOSURE,          //!< SMBIOS System Enclosure (type 3)
+    SYSINFO_SRC_OEM_STRINGS,        //!< SMBIOS OEM Strings (type 0x0B)
+    SYSINFO_SRC_REV_AND_ID,         //!< Dell Revisions and IDs (type 0xD0)
+    SYSINFO_SRC_MEMORY,             //!< BIOS image in memory
+    SYSINFO_SRC_SMI,                //!< Dell SMI call
+    SYSINFO_SRC_CMOS,               //!< CMOS token
+};
+
+//! Everything the sysinfo_get_* functions return, gathered at once
+/** Values are the same the individual functions would give. Strings are 0
+ * when not found, except asset_tag, which is then "Not Specified" like
+ * sysinfo_get_asset_tag(). Each value has a matching *_src member.
+ */
+struct sysinfo_snapshot
+{
+    const char *vendor_name;
+    const char *system_name;
+    const char *bios_version;
+    const char *service_tag;
+    const char *asset_tag;
+    int dell_system_id;
+    int dell_oem_system_id;
+
+    enum sysinfo_source vendor_name_src;
+    enum sysinfo_source system_name_src;
+    enum sysinfo_source bios_version_src;
+    enum sysinfo_source service_tag_src;
+    enum sysinfo_source asset_tag_src;
+    enum sysinfo_source dell_system_id_src;
+    enum sysinfo_source dell_oem_system_id_src;
+};
+
+/** Gather all system information in one go.
+ * Walks the SMBIOS table once and only goes to memory, SMI or CMOS for
+ * values the table does not have, with at most one pass over each. The
+ * snapshot and all its strings are a single allocation.
+ * @return snapshot, or 0 if out of memory. Deallocate with
+ * sysinfo_snapshot_free() when done.
+ */
+LIBSMBIOS_C_DLL_SPEC struct sysinfo_snapshot * sysinfo_snapshot();
+
+/** Same as sysinfo_snapshot(), but for a system described by the objects
+ * passed in, for example a dump directory opened with the *_GET_NEW and
+ * *_UNIT_TEST_MODE factory flags. No singleton, cache or SMI is used, so
+ * different threads may run this on different objects at the same time.
+ * @param table the system's SMBIOS table
+ * @param memory its memory image for the ID byte, or 0
+ * @param cmos its CMOS for the service and asset tags, or 0
+ * @return snapshot, or 0 if out of memory or table is 0. Deallocate with
+ * sysinfo_snapshot_free() when done.
+ */
+LIBSMBIOS_C_DLL_SPEC struct sysinfo_snapshot * sysinfo_snapshot_from(const struct smbios_table *table, struct memory_access_obj *memory, const struct cmos_access_obj *cmos);
+
+//! Free a snapshot returned by sysinfo_snapshot() or sysinfo_snapshot_from().
+LIBSMBIOS_C_DLL_SPEC void sysinfo_snapshot_free(struct sysinfo_snapshot *);
+
+//! mask bit for a source, for the 'sources' argument below
+#define SYSINFO_SOURCE_BIT(src)  (1 << (src))
+#define SYSINFO_ALL_SOURCES      (~0)
+
+/** Same as sysinfo_get_service_tag(), but only tries the sources in the
+ * 'sources' mask and reports where the tag came from.
+ * Tags are cached for the life of the process once the full chain has run,
+ * until changed with sysinfo_set_service_tag*() or dropped with
+ * sysinfo_tag_cache_invalidate().
+ * @param sources   SYSINFO_ALL_SOURCES, or SYSINFO_SOURCE_BIT()s of
+ * SYSINFO_SRC_SYSTEM_INFO, SYSINFO_SRC_ENCLOSURE, SYSINFO_SRC_SMI and
+ * SYSINFO_SRC_CMOS
+ * @param src   if not 0, gets the source, SYSINFO_SRC_NONE if not found
+ * @return as sysinfo_get_service_tag()
+ */
+LIBSMBIOS_C_DLL_SPEC char * sysinfo_get_service_tag_src(int sources, enum sysinfo_source *src);
+
+/** Same as sysinfo_get_asset_tag(), with source mask and reporting as for
+ * sysinfo_get_service_tag_src(). Sources are SYSINFO_SRC_ENCLOSURE,
+ * SYSINFO_SRC_CMOS and SYSINFO_SRC_SMI.
+ */
+LIBSMBIOS_C_DLL_SPEC char * sysinfo_get_asset_tag_src(int sources, enum sysinfo_source *src);
+
+/** Forget cached service and asset tags.
+ * Only needed if they were changed other than through this library.
+ */
+LIBSMBIOS_C_DLL_SPEC void sysinfo_tag_cache_invalidate();
+
 /** Returns string describing the last error condition.
  * Can return 0. The buffer used is guaranteed to be valid until the next call
  * to any sysinfo_* function. Copy the contents if you need it longer.
@@ -148,7 +332,7 @@ LIBSMBIOS_C_DLL_SPEC  void sysinfo_string_free(void *);
 // experimental functions
 LIBSMBIOS_C_DLL_SPEC int sysinfo_has_nvram_state_bytes();
 LIBSMBIOS_C_DLL_SPEC int sysinfo_get_nvram_state_bytes( int user );
-LIBSMBIOS_C_DLL_SPEC void sysinfo_set_nvram_state_bytes(int value, int user);
+LIBSMBIOS_C_DLL_SPEC void sysinfo_set_nvram_state_bytes(int user, int value);
 
 LIBSMBIOS_C_DLL_SPEC int sysinfo_has_up_boot_flag();
 LIBSMBIOS_C_DLL_SPEC int sysinfo_set_up_boot_flag(int state);
@@ -25,6 +25,8 @@
 
 EXTERN_C_BEGIN;
 
+struct dell_smi_security;
+
 #define TOKEN_TYPE_D4  0xD4
 #define TOKEN_TYPE_D5  0xD5
 #define TOKEN_TYPE_D6  0xD6
@@ -99,6 +101,12 @@ LIBSMBIOS_C_DLL_SPEC const void * token_get_ptr(u16 id);
  */
 LIBSMBIOS_C_DLL_SPEC int token_try_password(u16 id, const char *pass_ascii, const char *pass_scancode);
 
+/** For tokens that are password protected, use the key held by a security
+ * context (see dell_smi_security_new()). The password is only verified
+ * once per context no matter how many tokens use it.
+ */
+LIBSMBIOS_C_DLL_SPEC int token_use_security(u16 id, struct dell_smi_security *sec);
+
 
 EXTERN_C_END;
 
@@ -53,6 +53,21 @@ int cmos_run_callbacks(bool do_update)
     return retval;
 }
 
+void cmos_begin_write_batch()
+{
+    struct cmos_access_obj *c = cmos_obj_factory(CMOS_GET_SINGLETON);
+    cmos_obj_begin_write_batch(c);
+    cmos_obj_free(c);
+}
+
+int cmos_end_write_batch()
+{
+    struct cmos_access_obj *c = cmos_obj_factory(CMOS_GET_SINGLETON);
+    int retval = cmos_obj_end_write_batch(c);
+    cmos_obj_free(c);
+    return retval;
+}
+
 const char * cmos_strerror()
 {
     struct cmos_access_obj *m = cmos_obj_factory(CMOS_GET_SINGLETON | CMOS_NO_ERR_CLEAR);
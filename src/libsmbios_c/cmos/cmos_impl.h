@@ -20,6 +20,7 @@
 
 #include "smbios_c/compat.h"
 #include "smbios_c/obj/cmos.h"
+#include "smbios_c/stats.h"
 #include "smbios_c/types.h"
 
 EXTERN_C_BEGIN;
@@ -48,6 +49,9 @@ struct cmos_access_obj
     struct callback *cb_list_head;
     void *private_data;
     int write_lock;
+    int batch_depth;    // cmos_obj_begin_write_batch() nesting
+    bool batch_dirty;   // bytes written in the batch, callbacks still due
+    struct libsmbios_c_obj_stats stats;
 };
 
 // regular one
@@ -56,6 +60,7 @@ __hidden int _init_cmos_std_stuff(struct cmos_access_obj *m);  // base class con
 
 // unit test one
 __hidden int init_cmos_struct_filename(struct cmos_access_obj *m, const char *fn);
+__hidden int init_cmos_struct_buffer(struct cmos_access_obj *m, void *buf, size_t len);
 
 // other funcs
 __hidden char *cmos_get_module_error_buf();
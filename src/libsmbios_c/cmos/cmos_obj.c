@@ -32,24 +32,17 @@
 
 // private
 #include "cmos_impl.h"
+#include "stats_impl.h"
 #include "libsmbios_c_intlize.h"
 #include "internal_strl.h"
 
 struct cmos_access_obj singleton; // auto-init to 0
-static char *module_error_buf; // auto-init to 0
-
-__attribute__((destructor)) static void return_mem(void)
-{
-    fnprintf("\n");
-    free(module_error_buf);
-    module_error_buf = 0;
-}
+// per thread, like errno: objects are used from many threads at once
+static __thread char module_error_buf[ERROR_BUFSIZE];
 
 char *cmos_get_module_error_buf()
 {
     fnprintf("\n");
-    if (!module_error_buf)
-        module_error_buf = calloc(1, ERROR_BUFSIZE);
     return module_error_buf;
 }
 
@@ -57,8 +50,7 @@ static void clear_err(const struct cmos_access_obj *this)
 {
     if (this && this->errstring)
         memset(this->errstring, 0, ERROR_BUFSIZE);
-    if(module_error_buf)
-        memset(module_error_buf, 0, ERROR_BUFSIZE);
+    memset(module_error_buf, 0, ERROR_BUFSIZE);
 }
 
 LIBSMBIOS_C_DLL_SPEC struct cmos_access_obj *cmos_obj_factory(int flags, ...)
@@ -71,14 +63,23 @@ LIBSMBIOS_C_DLL_SPEC struct cmos_access_obj *cmos_obj_factory(int flags, ...)
         flags = CMOS_GET_SINGLETON;
 
     if (flags & CMOS_GET_SINGLETON)
+    {
         toReturn = &singleton;
-    else
+        stats_track(STATS_CMOS, &singleton.stats);
+    } else
         toReturn = (struct cmos_access_obj *)calloc(1, sizeof(struct cmos_access_obj));
 
     if (toReturn->initialized)
         goto out;
 
-    if (flags & CMOS_UNIT_TEST_MODE)
+    if (flags & CMOS_FROM_BUFFER)
+    {
+        va_start(ap, flags);
+        void *buf = va_arg(ap, void *);
+        size_t len = va_arg(ap, size_t);
+        va_end(ap);
+        ret = init_cmos_struct_buffer(toReturn, buf, len);
+    } else if (flags & CMOS_UNIT_TEST_MODE)
     {
         va_start(ap, flags);
         ret = init_cmos_struct_filename(toReturn, va_arg(ap, const char *));
@@ -127,7 +128,9 @@ int  cmos_obj_read_byte(const struct cmos_access_obj *m, u8 *byte, u32 indexPort
     if (!m->read_fn)
         goto out;
 
+    u64 start = stats_start();
     retval = m->read_fn(m, byte, indexPort, dataPort, offset);
+    stats_record(&obj_stats(m)->read, start, retval ? 0 : 1, retval);
 
 out:
     return retval;
@@ -145,16 +148,45 @@ int  cmos_obj_write_byte(const struct cmos_access_obj *m, u8 byte, u32 indexPort
     if (!m->write_fn)
         goto out;
 
+    // timed including callbacks: a checksum update is part of the write cost
+    u64 start = stats_start();
     ((struct cmos_access_obj *)m)->write_lock++;
     retval = m->write_fn(m, byte, indexPort, dataPort, offset);
-    if (m->write_lock == 1)
+    if (m->write_lock == 1 && m->batch_depth)
+        ((struct cmos_access_obj *)m)->batch_dirty = true;
+    else if (m->write_lock == 1)
         cmos_obj_run_callbacks(m, true);
     ((struct cmos_access_obj *)m)->write_lock--;
+    stats_record(&obj_stats(m)->write, start, retval ? 0 : 1, retval);
 
 out:
     return retval;
 }
 
+void cmos_obj_begin_write_batch(struct cmos_access_obj *m)
+{
+    if (m)
+        m->batch_depth++;
+}
+
+int cmos_obj_end_write_batch(struct cmos_access_obj *m)
+{
+    int retval = 0;
+    if (!m || !m->batch_depth)
+        return -5;
+
+    if (--m->batch_depth || !m->batch_dirty)
+        return retval;
+
+    // run them the way a single write would, so the checksum writes they do
+    // themselves do not start another round
+    m->batch_dirty = false;
+    m->write_lock++;
+    retval = cmos_obj_run_callbacks(m, true);
+    m->write_lock--;
+    return retval;
+}
+
 void cmos_obj_free(struct cmos_access_obj *m)
 {
     struct callback *ptr = 0;
@@ -192,6 +224,7 @@ void cmos_obj_free(struct cmos_access_obj *m)
     if(m->free)
         m->free(m);
 
+    stats_retire(STATS_CMOS, &m->stats);
     memset(m, 0, sizeof(*m)); // big hammer
     free(m);
 }
@@ -252,6 +285,7 @@ int cmos_obj_run_callbacks(const struct cmos_access_obj *m, bool do_update)
     do{
         fnprintf(" ptr->cb_fn %p\n", ptr->cb_fn);
         retval |= ptr->cb_fn(m, do_update, ptr->userdata);
+        STATS_INC(obj_stats(m)->callbacks);
         ptr = ptr->next;
     } while (ptr);
 
@@ -259,6 +293,20 @@ out:
     return retval;
 }
 
+int cmos_obj_get_stats(const struct cmos_access_obj *m, struct libsmbios_c_obj_stats *out)
+{
+    if (!m || !out)
+        return -5;
+    *out = m->stats;
+    return 0;
+}
+
+void cmos_obj_reset_stats(struct cmos_access_obj *m)
+{
+    if (m)
+        memset(&m->stats, 0, sizeof(m->stats));
+}
+
 int __hidden _init_cmos_std_stuff(struct cmos_access_obj *m)
 {
     int retval = 0;
@@ -182,3 +182,70 @@ int init_cmos_struct_filename(struct cmos_access_obj *m, const char *fn)
 
     return 0;
 }
+
+// zero-copy view of a caller-owned CMOS image, same layout as the unit test
+// file: byte (indexPort * 256 + offset). Caller keeps buf alive.
+struct buf_data
+{
+    u8 *buf;
+    size_t len;
+};
+
+static int BUF_read_fn(const struct cmos_access_obj *this, u8 *byte, u32 indexPort, u32 dataPort, u32 offset)
+{
+    struct buf_data *private_data = (struct buf_data *)this->private_data;
+    size_t pos = (size_t)indexPort * 256 + offset;
+
+    if (pos >= private_data->len)
+        return -3;
+
+    *byte = private_data->buf[pos];
+    return 0;
+}
+
+static int BUF_write_fn(const struct cmos_access_obj *this, u8 byte, u32 indexPort, u32 dataPort, u32 offset)
+{
+    struct buf_data *private_data = (struct buf_data *)this->private_data;
+    size_t pos = (size_t)indexPort * 256 + offset;
+
+    if (pos >= private_data->len)
+        return -1;
+
+    private_data->buf[pos] = byte;
+    return 0;
+}
+
+static void BUF_free(struct cmos_access_obj *this)
+{
+    free(this->private_data);
+    this->private_data = 0;
+}
+
+int init_cmos_struct_buffer(struct cmos_access_obj *m, void *buf, size_t len)
+{
+    struct buf_data *priv_buf = 0;
+
+    if (!buf)
+        return -1;
+
+    priv_buf = (struct buf_data *)calloc(1, sizeof(struct buf_data));
+    if (!priv_buf)
+        return -1;
+
+    priv_buf->buf = (u8 *)buf;
+    priv_buf->len = len;
+
+    m->private_data = priv_buf;
+    m->free = BUF_free;
+    m->read_fn = BUF_read_fn;
+    m->write_fn = BUF_write_fn;
+    m->cleanup = 0;
+
+    if (_init_cmos_std_stuff(m))
+    {
+        BUF_free(m);
+        return -1;
+    }
+
+    return 0;
+}
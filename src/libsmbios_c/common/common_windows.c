@@ -27,6 +27,7 @@
 // private
 #include "miniddk.h"
 #include "common_windows.h"
+#include "stats_impl.h"
 
 #ifdef _MSC_VER
 #define NTDLL L"ntdll.dll"
@@ -118,3 +119,12 @@ int EnableDebug(void)
 
     return TRUE;
 }
+
+// no thread support here yet
+void __hidden stats_lock(void)
+{
+}
+
+void __hidden stats_unlock(void)
+{
+}
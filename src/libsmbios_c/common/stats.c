@@ -0,0 +1,216 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+#define DEBUG_MODULE_NAME "DEBUG_STATS_C"
+
+// Include compat.h first, then system headers, then public, then private
+#include "smbios_c/compat.h"
+
+// system
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// public
+#include "smbios_c/stats.h"
+
+// private
+#include "stats_impl.h"
+#include "libsmbios_c_intlize.h"
+
+int stats_on; // auto-init to 0
+static int print_at_exit;
+static struct libsmbios_c_obj_stats retired[STATS_NUM_MODULES];
+
+// objects that live until exit (singletons, per-thread smi objects)
+struct live_obj
+{
+    enum stats_module module;
+    const struct libsmbios_c_obj_stats *s;
+    struct live_obj *next;
+};
+static struct live_obj *live;
+static const char *module_names[STATS_NUM_MODULES] = { "memory", "cmos", "smi" };
+
+__attribute__((constructor)) static void stats_initialize(void)
+{
+    const char *env = getenv("LIBSMBIOS_C_STATS");
+    if (env && atoi(env) > 0)
+        stats_on = print_at_exit = 1;
+}
+
+__attribute__((destructor)) static void stats_summary(void)
+{
+    if (print_at_exit)
+        libsmbios_c_stats_print(stderr);
+}
+
+void libsmbios_c_stats_enable(bool enable)
+{
+    stats_on = enable;
+}
+
+bool libsmbios_c_stats_enabled(void)
+{
+    return stats_on != 0;
+}
+
+static u64 now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+    return 0;
+}
+
+u64 stats_start(void)
+{
+    return stats_on ? now_ns() : 0;
+}
+
+void stats_record(struct libsmbios_c_op_stats *op, u64 start, size_t bytes, int retval)
+{
+    if (!stats_on)
+        return;
+
+    op->calls++;
+    op->bytes += bytes;
+    if (retval)
+        op->errors++;
+
+    // collection was switched on mid-call, or no clock
+    if (!start)
+        return;
+
+    u64 ns = now_ns() - start;
+    op->total_ns += ns;
+    if (ns > op->max_ns)
+        op->max_ns = ns;
+
+    int bucket = 0;
+    while (ns >>= 1)
+        bucket++;
+    if (bucket >= LIBSMBIOS_C_STATS_BUCKETS)
+        bucket = LIBSMBIOS_C_STATS_BUCKETS - 1;
+    op->hist[bucket]++;
+}
+
+
+static void add_op(struct libsmbios_c_op_stats *to, const struct libsmbios_c_op_stats *from)
+{
+    to->calls += from->calls;
+    to->errors += from->errors;
+    to->bytes += from->bytes;
+    to->total_ns += from->total_ns;
+    if (from->max_ns > to->max_ns)
+        to->max_ns = from->max_ns;
+    for (int i=0; i<LIBSMBIOS_C_STATS_BUCKETS; ++i)
+        to->hist[i] += from->hist[i];
+}
+
+static void add_obj(struct libsmbios_c_obj_stats *to, const struct libsmbios_c_obj_stats *from)
+{
+    add_op(&to->read, &from->read);
+    add_op(&to->write, &from->write);
+    to->remaps += from->remaps;
+    to->reopens += from->reopens;
+    to->callbacks += from->callbacks;
+}
+
+void stats_track(enum stats_module module, const struct libsmbios_c_obj_stats *s)
+{
+    struct live_obj *l;
+
+    stats_lock();
+    for (l = live; l; l = l->next)
+        if (l->s == s)
+            goto out;
+
+    l = calloc(1, sizeof(struct live_obj));
+    if (!l)
+        goto out;
+    l->module = module;
+    l->s = s;
+    l->next = live;
+    live = l;
+
+out:
+    stats_unlock();
+}
+
+void stats_retire(enum stats_module module, const struct libsmbios_c_obj_stats *s)
+{
+    stats_lock();
+    for (struct live_obj **l = &live; *l; l = &(*l)->next)
+        if ((*l)->s == s)
+        {
+            struct live_obj *gone = *l;
+            *l = gone->next;
+            free(gone);
+            break;
+        }
+    add_obj(&retired[module], s);
+    stats_unlock();
+}
+
+static void print_op(FILE *fp, const char *module, const char *name, const struct libsmbios_c_op_stats *op)
+{
+    if (!op->calls)
+        return;
+
+    fprintf(fp, "  %-6s %-7s calls %llu  errors %llu  bytes %llu  avg %lluns  max %lluns\n",
+            module, name,
+            (unsigned long long)op->calls, (unsigned long long)op->errors,
+            (unsigned long long)op->bytes,
+            (unsigned long long)(op->total_ns / op->calls),
+            (unsigned long long)op->max_ns);
+
+    fprintf(fp, "        ");
+    for (int i=0; i<LIBSMBIOS_C_STATS_BUCKETS; ++i)
+        if (op->hist[i])
+            fprintf(fp, " <%lluns:%llu", 2ULL << i, (unsigned long long)op->hist[i]);
+    fprintf(fp, "\n");
+}
+
+void libsmbios_c_stats_print(FILE *fp)
+{
+    fprintf(fp, _("libsmbios_c statistics:\n"));
+    for (int m=0; m<STATS_NUM_MODULES; ++m)
+    {
+        struct libsmbios_c_obj_stats total;
+
+        stats_lock();
+        total = retired[m];
+        for (struct live_obj *l = live; l; l = l->next)
+            if (l->module == (enum stats_module)m)
+                add_obj(&total, l->s);
+        stats_unlock();
+
+        print_op(fp, module_names[m], m == STATS_SMI ? "execute" : "read", &total.read);
+        print_op(fp, module_names[m], "write", &total.write);
+        if (total.remaps || total.reopens)
+            fprintf(fp, "  %-6s remaps %llu  reopens %llu\n", module_names[m],
+                    (unsigned long long)total.remaps, (unsigned long long)total.reopens);
+        if (total.callbacks)
+            fprintf(fp, "  %-6s callbacks %llu\n", module_names[m], (unsigned long long)total.callbacks);
+    }
+}
@@ -0,0 +1,54 @@
+// vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:
+/*
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _LIBSMBIOS_C_STATS_IMPL_H
+#define _LIBSMBIOS_C_STATS_IMPL_H
+
+#include "smbios_c/compat.h"
+#include "smbios_c/stats.h"
+#include "smbios_c/types.h"
+
+EXTERN_C_BEGIN;
+
+enum stats_module { STATS_MEMORY, STATS_CMOS, STATS_SMI, STATS_NUM_MODULES };
+
+// set from LIBSMBIOS_C_STATS at load time or libsmbios_c_stats_enable()
+__hidden extern int stats_on;
+
+// returns 0 when collection is off so stats_record() can skip the clock
+__hidden u64 stats_start(void);
+__hidden void stats_record(struct libsmbios_c_op_stats *op, u64 start, size_t bytes, int retval);
+
+// objects the caller never frees (singletons, per-thread objects) are
+// registered so the exit summary can include them. Repeat calls are harmless.
+__hidden void stats_track(enum stats_module module, const struct libsmbios_c_obj_stats *live);
+// fold a freed object into the module totals, ends tracking
+__hidden void stats_retire(enum stats_module module, const struct libsmbios_c_obj_stats *s);
+
+// objects may be created and freed from any thread, the totals are shared.
+// OS specific, in common_<os>.c
+__hidden void stats_lock(void);
+__hidden void stats_unlock(void);
+
+#define STATS_INC(field) do { if (stats_on) (field)++; } while(0)
+
+// objects are usually passed const; stats are bookkeeping, not state
+#define obj_stats(o) ((struct libsmbios_c_obj_stats *)&(o)->stats)
+
+EXTERN_C_END;
+
+#endif /* _LIBSMBIOS_C_STATS_IMPL_H */
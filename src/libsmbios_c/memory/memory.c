@@ -68,6 +68,14 @@ s64  memory_search(const char *pat, size_t patlen, u64 start, u64 end, u64 strid
     return retval;
 }
 
+int  memory_search_multi(const struct memory_search_pattern *pats, size_t numpats, u64 start, u64 end, u64 stride, memory_search_fn fn, void *userdata)
+{
+    struct memory_access_obj *m = memory_obj_factory(MEMORY_GET_SINGLETON);
+    int retval = memory_obj_search_multi(m, pats, numpats, start, end, stride, fn, userdata);
+    memory_obj_free(m);
+    return retval;
+}
+
 const char * memory_strerror()
 {
     struct memory_access_obj *m = memory_obj_factory(MEMORY_GET_SINGLETON|MEMORY_NO_ERR_CLEAR);
@@ -19,6 +19,7 @@
 #define MEMORY_IMPL_H
 
 #include "smbios_c/compat.h"
+#include "smbios_c/stats.h"
 #include "smbios_c/types.h"
 
 EXTERN_C_BEGIN;
@@ -37,12 +38,23 @@ struct memory_access_obj
     void (*cleanup)(struct memory_access_obj *this); // called instead of ->free for singleton
     void *private_data;
     char *errstring;
-    int close;
+    int open_sessions;  // nesting depth of suggest_leave_open()/suggest_close()
+    int persistent;     // MEMORY_PERSISTENT: keep device open for object lifetime
+    int emulated;       // unit test image or caller buffer, not this machine's memory
+    struct libsmbios_c_obj_stats stats;
 };
 
 __hidden int init_mem_struct(struct memory_access_obj *m);
 __hidden int init_mem_struct_filename(struct memory_access_obj *m, const char *fn);
+__hidden bool memory_is_segment_source(const char *fn);
+__hidden int init_mem_struct_segments(struct memory_access_obj *m, const char *fn);
+__hidden bool memory_is_offset_dump(const char *name);
+// os layer: names in dirname that memory_is_offset_dump(), sorted by name.
+// returns how many, or < 0 on error. free each name and the array
+__hidden int memory_list_offset_dumps(const char *dirname, char ***names);
+__hidden int init_mem_struct_buffer(struct memory_access_obj *m, u64 base, void *buf, size_t len);
 __hidden char * memory_get_module_error_buf();
+__hidden bool memory_singleton_is_emulated(void);
 
 EXTERN_C_END;
 
@@ -27,6 +27,9 @@
 #include <stdio.h>
 #include <string.h>     // memcpy
 #include <errno.h>
+#include <dirent.h>     // scandir
+#include <fcntl.h>      // open
+#include <unistd.h>     // pread, close
 #include <sys/mman.h>   // mmap
 #include <sys/stat.h>
 
@@ -34,6 +37,7 @@
 #include "smbios_c/types.h"
 #include "memory_impl.h"
 #include "common_internal.h"
+#include "stats_impl.h"
 
 // usually want to include this last
 #include "libsmbios_c_intlize.h"
@@ -41,7 +45,7 @@
 struct linux_data
 {
     char *filename;
-    FILE *fd;
+    int fd;
     int mem_errno;
     bool rw;
     void *lastMapping;
@@ -65,23 +69,20 @@ static void closefds(struct linux_data *private_data)
     private_data->lastMapping = 0;
     private_data->lastMappedOffset = -1;
 
-    if (private_data->fd)
-        fclose(private_data->fd);
+    if (private_data->fd >= 0)
+        close(private_data->fd);
 
-    private_data->fd = 0;
+    private_data->fd = -1;
 }
 
-static FILE * reopen(struct linux_data *private_data, int rw)
+static int reopen(struct linux_data *private_data, int rw)
 {
-    char *openMode = rw ? "r+b": "rb";
+    int openMode = (rw ? O_RDWR : O_RDONLY) | O_CLOEXEC;
     fnprintf(" file: %s,  rw: %d\n", private_data->filename, rw );
-    if(private_data->fd)
-        fclose(private_data->fd);
+    closefds(private_data);
 
     private_data->rw = rw;
-    private_data->lastMapping = 0;
-    private_data->lastMappedOffset = -1;
-    private_data->fd = fopen( private_data->filename, openMode ); // re-open for write
+    private_data->fd = open( private_data->filename, openMode ); // re-open for write
     return private_data->fd;
 }
 
@@ -100,7 +101,8 @@ static void debug_dump_buffer(const char *fn, const char *s, const u8 *buffer, s
 #define debug_dump_buffer(...) do {} while(0)
 #endif
 
-static void remap(struct linux_data *private_data, off_t offset, bool rw)
+// returns true if a new window had to be mapped
+static bool remap(struct linux_data *private_data, off_t offset, bool rw)
 {
     int flags = rw ? PROT_WRITE : PROT_READ;
     off_t mmoff = offset % private_data->mappingSize;
@@ -109,7 +111,7 @@ static void remap(struct linux_data *private_data, off_t offset, bool rw)
 
     // no need to remap if we already have the correct area mapped.
     if (offset-mmoff == private_data->lastMappedOffset)
-        goto out;
+        return false;
 
     private_data->lastMappedOffset = offset-mmoff;
 
@@ -121,10 +123,9 @@ static void remap(struct linux_data *private_data, off_t offset, bool rw)
                   private_data->mappingSize,
                   flags,
                   MAP_SHARED,
-                  fileno(private_data->fd),
+                  private_data->fd,
                   private_data->lastMappedOffset); // last arg, offset, must be mod pagesize.
-out:
-    return;
+    return true;
 }
 
 static size_t trycopy(struct linux_data *private_data, u8 *buffer, u64 offset, size_t length, bool rw)
@@ -160,7 +161,7 @@ static int copy_mmap(const struct memory_access_obj *this, u8 *buffer, u64 offse
     size_t bytesCopied = 0;
 
     fnprintf("buffer(%p) offset(%lld) length(%zd) rw(%d)\n", buffer, offset, length, rw);
-    fnprintf("->rw: %d  fd: %p\n", private_data->rw, private_data->fd);
+    fnprintf("->rw: %d  fd: %d\n", private_data->rw, private_data->fd);
 
     if(private_data->fileSize > 0 && length + offset > private_data->fileSize) {
         error = _("File size is too small: File: ");
@@ -169,15 +170,25 @@ static int copy_mmap(const struct memory_access_obj *this, u8 *buffer, u64 offse
     }
 
     error = _("Could not (re)open file. File: ");
-    if( (rw && !private_data->rw) || !private_data->fd)
-        if (!reopen(private_data, rw))
+    if( (rw && !private_data->rw) || private_data->fd < 0)
+    {
+        STATS_INC(obj_stats(this)->reopens);
+        if (reopen(private_data, rw) < 0)
             goto err_out;
+    }
+
+    // small reads on a persistent object skip the mmap/munmap entirely.
+    // fall back to mapping if the device refuses read().
+    if (!rw && this->persistent && length < private_data->mappingSize)
+        if (pread(private_data->fd, buffer, length, offset) == (ssize_t)length)
+            bytesCopied = length;
 
     fnprintf("Start of copy loop\n");
     while( bytesCopied < length )
     {
         fnprintf("\tLOOP: bytesCopied(%zd) length(%zd)\n", bytesCopied, length);
-        remap(private_data, offset + bytesCopied, rw);
+        if (remap(private_data, offset + bytesCopied, rw))
+            STATS_INC(obj_stats(this)->remaps);
         fnprintf("\tlastMapping(%p)\n", private_data->lastMapping);
         error = _("The mmap() call returned mapping of -1 (failure). File: ");
         if (private_data->lastMapping == (void *)-1)
@@ -283,6 +294,7 @@ __hidden int init_mem_struct_filename(struct memory_access_obj *m, const char *f
         goto out_fail;
 
     strcat(private_data->filename, fn);
+    private_data->fd = -1;
     private_data->lastMappedOffset = -1;
     private_data->rw = 0;
     private_data->mappingSize = getpagesize(); // must be power of 2, >= getpagesize()
@@ -291,18 +303,18 @@ __hidden int init_mem_struct_filename(struct memory_access_obj *m, const char *f
     m->read_fn = linux_read_fn;
     m->write_fn = linux_write_fn;
     m->cleanup = linux_cleanup;
-    m->close = 1;
 
     error = _("File open error during memory object construction. The filename: ");
-    if (!reopen(private_data, false))
+    if (reopen(private_data, false) < 0)
         goto out_fail;
-    if (fstat (fileno(private_data->fd), &st_dev) == -1)
+    if (fstat (private_data->fd, &st_dev) == -1)
         goto out_fail;
     if (S_ISCHR (st_dev.st_mode))
         private_data->fileSize = -1;
     else
         private_data->fileSize = st_dev.st_size;
-    closefds(private_data);
+    if (!m->persistent)
+        closefds(private_data);
     m->initialized = 1;
     goto out;
 
@@ -329,3 +341,39 @@ __hidden int init_mem_struct(struct memory_access_obj *m)
 {
    return init_mem_struct_filename(m, "/dev/mem");
 }
+
+static int offset_dump_filter(const struct dirent *ent)
+{
+    return memory_is_offset_dump(ent->d_name);
+}
+
+__hidden int memory_list_offset_dumps(const char *dirname, char ***names)
+{
+    struct dirent **ents;
+    int num, retval;
+
+    *names = 0;
+    num = scandir(dirname, &ents, offset_dump_filter, alphasort);
+    if (num < 0)
+        return -1;
+
+    retval = num;
+    *names = calloc(num + 1, sizeof(char *));
+    for (int i=0; i<num; ++i)
+    {
+        if (*names && !((*names)[i] = strdup(ents[i]->d_name)))
+            retval = -1;
+        free(ents[i]);
+    }
+    free(ents);
+
+    if (!*names || retval < 0)
+    {
+        for (int i=0; *names && i<num; ++i)
+            free((*names)[i]);
+        free(*names);
+        *names = 0;
+        return -1;
+    }
+    return retval;
+}
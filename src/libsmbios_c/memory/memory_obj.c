@@ -32,25 +32,24 @@
 
 // private
 #include "memory_impl.h"
+#include "stats_impl.h"
 
 // usually want to include this last
 #include "libsmbios_c_intlize.h"
 
 static struct memory_access_obj singleton; // auto-init to 0
-static char *module_error_buf; // auto-init to 0
+// per thread, like errno: objects are used from many threads at once
+static __thread char module_error_buf[ERROR_BUFSIZE];
 
-__attribute__((destructor)) static void return_mem(void)
+__attribute__((destructor)) static void close_singleton(void)
 {
-    fnprintf("\n");
-    free(module_error_buf);
-    module_error_buf = 0;
+    if (singleton.initialized && singleton.cleanup)
+        singleton.cleanup(&singleton);
 }
 
 char *memory_get_module_error_buf()
 {
     fnprintf("\n");
-    if (!module_error_buf)
-        module_error_buf = calloc(1, ERROR_BUFSIZE);
     return module_error_buf;
 }
 
@@ -58,8 +57,7 @@ static void clear_err(const struct memory_access_obj *this)
 {
     if (this && this->errstring)
         memset(this->errstring, 0, ERROR_BUFSIZE);
-    if(module_error_buf)
-        memset(module_error_buf, 0, ERROR_BUFSIZE);
+    memset(module_error_buf, 0, ERROR_BUFSIZE);
 }
 
 struct memory_access_obj *memory_obj_factory(int flags, ...)
@@ -68,26 +66,40 @@ struct memory_access_obj *memory_obj_factory(int flags, ...)
     struct memory_access_obj *toReturn = 0;
     int ret;
 
-    fnprintf("1\n");
-    return_mem();
-
-    fnprintf("2\n");
+    fnprintf("\n");
     if (flags==MEMORY_DEFAULTS)
         flags = MEMORY_GET_SINGLETON;
 
     if (flags & MEMORY_GET_SINGLETON)
+    {
         toReturn = &singleton;
-    else
+        stats_track(STATS_MEMORY, &singleton.stats);
+    } else
         toReturn = (struct memory_access_obj *)calloc(1, sizeof(struct memory_access_obj));
 
     if (toReturn->initialized)
         goto out;
 
-    if (flags & MEMORY_UNIT_TEST_MODE)
+    toReturn->persistent = (flags & MEMORY_PERSISTENT) != 0;
+    toReturn->emulated = (flags & (MEMORY_FROM_BUFFER | MEMORY_UNIT_TEST_MODE)) != 0;
+    if (flags & MEMORY_FROM_BUFFER)
+    {
+        va_start(ap, flags);
+        u64 base = va_arg(ap, u64);
+        void *buf = va_arg(ap, void *);
+        size_t len = va_arg(ap, size_t);
+        va_end(ap);
+        ret = init_mem_struct_buffer(toReturn, base, buf, len);
+    } else if (flags & MEMORY_UNIT_TEST_MODE)
     {
         va_start(ap, flags);
-        ret = init_mem_struct_filename(toReturn, va_arg(ap, const char *));
+        const char *fn = va_arg(ap, const char *);
         va_end(ap);
+        // dump directories and manifests are served segment by segment
+        if (memory_is_segment_source(fn))
+            ret = init_mem_struct_segments(toReturn, fn);
+        else
+            ret = init_mem_struct_filename(toReturn, fn);
     } else
     {
         ret = init_mem_struct(toReturn);
@@ -107,25 +119,36 @@ out:
     return toReturn;
 }
 
+// true if the singleton was set up from a unit test image or caller buffer
+bool __hidden memory_singleton_is_emulated(void)
+{
+    return singleton.initialized && singleton.emulated;
+}
+
 void  memory_obj_suggest_leave_open(struct memory_access_obj *this)
 {
     clear_err(this);
     if (this)
-        this->close--;
+        this->open_sessions++;
 }
 
 void  memory_obj_suggest_close(struct memory_access_obj *this)
 {
     clear_err(this);
-    if (this)
-        this->close++;
+    if (!this || this->open_sessions <= 0)
+        return;
+
+    // last session out releases the device
+    this->open_sessions--;
+    if (memory_obj_should_close(this) && this->cleanup)
+        this->cleanup(this);
 }
 
 bool  memory_obj_should_close(const struct memory_access_obj *this)
 {
     clear_err(this);
     if (this)
-        return this->close > 0;
+        return !this->persistent && this->open_sessions == 0;
     return true;
 }
 
@@ -137,7 +160,11 @@ int  memory_obj_read(const struct memory_access_obj *m, void *buffer, u64 offset
         retval = -5; // bad memory_access_obj
 
     if (m && buffer)
+    {
+        u64 start = stats_start();
         retval = m->read_fn(m, (u8 *)buffer, offset, length);
+        stats_record(&obj_stats(m)->read, start, retval ? 0 : length, retval);
+    }
 
     return retval ;
 }
@@ -150,7 +177,11 @@ int  memory_obj_write(const struct memory_access_obj *m, void *buffer, u64 offse
         retval = -5; // bad memory_access_obj
 
     if (m && buffer)
+    {
+        u64 start = stats_start();
         retval = m->write_fn(m, (u8 *)buffer, offset, length);
+        stats_record(&obj_stats(m)->write, start, retval ? 0 : length, retval);
+    }
 
     return retval;
 }
@@ -170,12 +201,14 @@ void memory_obj_free(struct memory_access_obj *m)
 {
     fnprintf("  m(%p)  singleton(%p)\n", m, &singleton);
     if (!m) goto out;
-    if (m->cleanup)
+    // singleton keeps the device open while a session is active
+    if (m->cleanup && (m != &singleton || memory_obj_should_close(m)))
         m->cleanup(m);
     if (m != &singleton)
     {
         if (m->free)
             m->free(m);
+        stats_retire(STATS_MEMORY, &m->stats);
         memset(m, 0, sizeof(*m)); // big hammer
         free(m);
     }
@@ -183,39 +216,176 @@ out:
     return;
 }
 
-s64  memory_obj_search(const struct memory_access_obj *m, const char *pat, size_t patlen, u64 start, u64 end, u64 stride)
+int memory_obj_get_stats(const struct memory_access_obj *m, struct libsmbios_c_obj_stats *out)
 {
-    u8 *buf = calloc(1, patlen);
-    u64 cur = start;
-    int ret;
-    memory_obj_suggest_leave_open((struct memory_access_obj *)m);
+    if (!m || !out)
+        return -5;
+    *out = m->stats;
+    return 0;
+}
+
+void memory_obj_reset_stats(struct memory_access_obj *m)
+{
+    if (m)
+        memset(&m->stats, 0, sizeof(m->stats));
+}
 
-    memset(buf, 0, patlen);
+// search is done over windows of this size rather than one read per candidate
+// offset. Windows overlap by (longest pattern - 1) so no match can straddle two.
+#define SEARCH_WINDOW_SIZE (64 * 1024)
 
-    while ( (cur + patlen) < end)
+struct search_filter
+{
+    u8 first[256];      // nonzero if some pattern starts with this byte
+    int num_distinct;
+    u8 only;            // the single first byte, when num_distinct == 1
+    size_t minlen;
+    size_t maxlen;
+};
+
+static void init_search_filter(struct search_filter *f, const struct memory_search_pattern *pats, size_t numpats)
+{
+    memset(f, 0, sizeof(*f));
+    f->minlen = (size_t)-1;
+    for (size_t i=0; i<numpats; ++i)
     {
-        ret = memory_obj_read(m, buf, cur, patlen);
-        if(ret != 0)
-            goto err_out;
+        u8 c = (u8)pats[i].pat[0];
+        if (!f->first[c])
+            f->num_distinct++;
+        f->first[c] = 1;
+        f->only = c;
+        if (pats[i].patlen < f->minlen)
+            f->minlen = pats[i].patlen;
+        if (pats[i].patlen > f->maxlen)
+            f->maxlen = pats[i].patlen;
+    }
+}
+
+// returns pointer to the next byte in [p, end) that can start a pattern.
+// memchr() is the vectorized fast path for the common single-anchor case.
+static const u8 *next_candidate(const struct search_filter *f, const u8 *p, const u8 *end)
+{
+    if (p >= end)
+        return 0;
 
-        if (memcmp (buf, pat, patlen) == 0)
-            goto out;
+    if (f->num_distinct == 1)
+        return memchr(p, f->only, end - p);
 
-        cur += stride;
-    }
+    for (; p < end; ++p)
+        if (f->first[*p])
+            return p;
+
+    return 0;
+}
+
+// walks [start, end) once, calling fn for every pattern match at an offset
+// where (offset - start) % stride == 0. fn returns nonzero to stop early.
+// returns number of matches, or -1 on read error.
+static int search_windows(const struct memory_access_obj *m, const struct memory_search_pattern *pats, size_t numpats, u64 start, u64 end, u64 stride, memory_search_fn fn, void *userdata)
+{
+    struct search_filter filter;
+    size_t bufsize;
+    u8 *buf = 0;
+    u64 wstart = start;
+    int matches = 0;
+
+    if (!m || !pats || !numpats || !fn)
+        goto err_out;
 
-    // bad stuff happened if we got to here and cur > end
-    if ((cur + patlen) >= end)
+    for (size_t i=0; i<numpats; ++i)
+        if (!pats[i].pat || !pats[i].patlen)
+            goto err_out;
+
+    if (!stride)
+        stride = 1;
+
+    init_search_filter(&filter, pats, numpats);
+    bufsize = SEARCH_WINDOW_SIZE + filter.maxlen;
+    buf = calloc(1, bufsize);
+    if (!buf)
         goto err_out;
 
+    while ( (wstart + filter.minlen) < end )
+    {
+        size_t wlen = (end - wstart) < bufsize ? (size_t)(end - wstart) : bufsize;
+        bool last = (wstart + wlen >= end);
+        // offsets >= scan_end are handled by the next (overlapping) window
+        u64 scan_end = last ? end : wstart + wlen - filter.maxlen + 1;
+        const u8 *scan_stop = buf + (scan_end - wstart);
+        const u8 *p = buf;
+
+        if (memory_obj_read(m, buf, wstart, wlen) != 0)
+            goto err_out;
+
+        if (stride > 1)
+            p += (stride - ((wstart - start) % stride)) % stride;
+
+        while (p < scan_stop)
+        {
+            if (stride == 1)
+            {
+                p = next_candidate(&filter, p, scan_stop);
+                if (!p)
+                    break;
+            }
+            else if (!filter.first[*p])
+            {
+                p += stride;
+                continue;
+            }
+
+            u64 cur = wstart + (p - buf);
+            for (size_t i=0; i<numpats; ++i)
+            {
+                if (cur + pats[i].patlen >= end || cur + pats[i].patlen > wstart + wlen)
+                    continue;
+                if (memcmp(p, pats[i].pat, pats[i].patlen) != 0)
+                    continue;
+                matches++;
+                if (fn(m, i, cur, userdata))
+                    goto out;
+            }
+            p += stride;
+        }
+
+        if (last)
+            break;
+        wstart = scan_end;
+    }
     goto out;
 
 err_out:
-    cur = -1;
+    matches = -1;
 
 out:
-    memory_obj_suggest_close((struct memory_access_obj *)m);
     free(buf);
+    return matches;
+}
+
+static int search_first_fn(const struct memory_access_obj *m, size_t which, u64 offset, void *userdata)
+{
+    *(s64 *)userdata = offset;
+    return 1;
+}
+
+s64  memory_obj_search(const struct memory_access_obj *m, const char *pat, size_t patlen, u64 start, u64 end, u64 stride)
+{
+    struct memory_search_pattern p = { pat, patlen };
+    s64 cur = -1;
+    memory_obj_suggest_leave_open((struct memory_access_obj *)m);
+
+    if (search_windows(m, &p, 1, start, end, stride, search_first_fn, &cur) <= 0)
+        cur = -1;
+
+    memory_obj_suggest_close((struct memory_access_obj *)m);
     return cur;
 }
 
+int  memory_obj_search_multi(const struct memory_access_obj *m, const struct memory_search_pattern *pats, size_t numpats, u64 start, u64 end, u64 stride, memory_search_fn fn, void *userdata)
+{
+    int retval;
+    memory_obj_suggest_leave_open((struct memory_access_obj *)m);
+    retval = search_windows(m, pats, numpats, start, end, stride, fn, userdata);
+    memory_obj_suggest_close((struct memory_access_obj *)m);
+    return retval;
+}
@@ -0,0 +1,428 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+
+// Include compat.h first, then system headers, then public, then private
+#include "smbios_c/compat.h"
+
+// system
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+// public
+#include "smbios_c/obj/memory.h"
+#include "smbios_c/types.h"
+
+// private
+#include "memory_impl.h"
+#include "internal_strl.h"
+
+// usually want to include this last
+#include "libsmbios_c_intlize.h"
+
+// UNIT TEST: sparse memory image assembled from (offset, file) segments.
+//
+// The source is either a system dump directory (same layout as
+// src/pyunit/system_dumps/*) or a manifest file. A manifest has one segment
+// per line: "<offset> <file>", with '#' comments. Relative file names are
+// resolved against the directory holding the manifest. Reads of addresses not
+// covered by any segment return zeros. Later segments overlay earlier ones.
+
+#define MANIFEST_SUFFIX ".manifest"
+#define DIR_MANIFEST    "memdump.manifest"
+#define DIR_FULL_DUMP   "memdump.dat"
+#define OFFSET_PREFIX   "offset-"
+
+struct segment
+{
+    u64 offset;
+    size_t length;
+    u8 *data;
+};
+
+struct segments_data
+{
+    struct segment *segs;
+    size_t num_segs;
+    bool borrowed;      // segment data belongs to the caller (MEMORY_FROM_BUFFER)
+};
+
+// well known files in a system dump directory, see smbios-get-ut-data
+static const struct { const char *fn; u64 offset; } dump_layout[] = {
+    { "smbios.dat", 0xE0000 },
+    { "sysstr.dat", 0xFE076 },
+    { "idbyte.dat", 0xFE840 },
+};
+
+static int SEG_read_fn(const struct memory_access_obj *this, u8 *buffer, u64 offset, size_t length)
+{
+    struct segments_data *private_data = (struct segments_data *)this->private_data;
+
+    memset(buffer, 0, length);
+    for (size_t i=0; i<private_data->num_segs; ++i)
+    {
+        const struct segment *s = &private_data->segs[i];
+        u64 lo = offset > s->offset ? offset : s->offset;
+        u64 hi_seg = s->offset + s->length;
+        u64 hi = (offset + length) < hi_seg ? (offset + length) : hi_seg;
+        if (lo >= hi)
+            continue;
+        memcpy(buffer + (lo - offset), s->data + (lo - s->offset), hi - lo);
+    }
+    return 0;
+}
+
+static int SEG_write_fn(const struct memory_access_obj *this, u8 *buffer, u64 offset, size_t length)
+{
+    struct segments_data *private_data = (struct segments_data *)this->private_data;
+    bool covered = false;
+
+    // writes only land in memory, and only where a segment backs the range
+    for (size_t i=0; i<private_data->num_segs; ++i)
+    {
+        const struct segment *s = &private_data->segs[i];
+        if (offset >= s->offset && offset + length <= s->offset + s->length)
+            covered = true;
+    }
+
+    if (!covered)
+    {
+        strlcpy(this->errstring, _("Write to an address range not backed by any memory dump segment."), ERROR_BUFSIZE);
+        return -1;
+    }
+
+    for (size_t i=0; i<private_data->num_segs; ++i)
+    {
+        struct segment *s = &private_data->segs[i];
+        u64 lo = offset > s->offset ? offset : s->offset;
+        u64 hi_seg = s->offset + s->length;
+        u64 hi = (offset + length) < hi_seg ? (offset + length) : hi_seg;
+        if (lo >= hi)
+            continue;
+        memcpy(s->data + (lo - s->offset), buffer + (lo - offset), hi - lo);
+    }
+    return 0;
+}
+
+static void SEG_free(struct memory_access_obj *this)
+{
+    struct segments_data *private_data = (struct segments_data *)this->private_data;
+
+    free(this->errstring);
+    this->errstring = 0;
+
+    if (private_data)
+    {
+        for (size_t i=0; i<private_data->num_segs && !private_data->borrowed; ++i)
+            free(private_data->segs[i].data);
+        free(private_data->segs);
+        free(private_data);
+    }
+    this->private_data = 0;
+    this->initialized = 0;
+}
+
+static char *join_path(const char *dir, const char *fn)
+{
+    char *path = calloc(1, strlen(dir) + strlen(fn) + 2);
+    if (path)
+    {
+        strcat(path, dir);
+        strcat(path, "/");
+        strcat(path, fn);
+    }
+    return path;
+}
+
+// returns 0 on success, 1 if the file does not exist, -1 on error
+static int add_segment(struct segments_data *private_data, const char *path, u64 offset)
+{
+    struct segment *segs = 0;
+    struct segment s = { offset, 0, 0 };
+    int retval = -1;
+    long len;
+
+    FILE *fd = fopen(path, "rb");
+    if (!fd)
+        return errno == ENOENT ? 1 : -1;
+
+    if (fseek(fd, 0, SEEK_END) || (len = ftell(fd)) < 0 || fseek(fd, 0, SEEK_SET))
+        goto out;
+
+    s.length = len;
+    s.data = malloc(s.length ? s.length : 1);
+    if (!s.data)
+        goto out;
+
+    if (s.length && fread(s.data, s.length, 1, fd) != 1)
+        goto out_free;
+
+    segs = realloc(private_data->segs, (private_data->num_segs + 1) * sizeof(*segs));
+    if (!segs)
+        goto out_free;
+
+    segs[private_data->num_segs++] = s;
+    private_data->segs = segs;
+    retval = 0;
+    goto out;
+
+out_free:
+    free(s.data);
+out:
+    fclose(fd);
+    return retval;
+}
+
+static int load_manifest(struct segments_data *private_data, const char *manifest)
+{
+    char line[1024];
+    char *dir = 0;
+    char *slash;
+    int retval = -1;
+
+    FILE *fd = fopen(manifest, "r");
+    if (!fd)
+        return -1;
+
+    dir = strdup(manifest);
+    if (!dir)
+        goto out;
+    slash = strrchr(dir, '/');
+    if (slash)
+        *slash = '\0';
+    else
+        strcpy(dir, ".");
+
+    while (fgets(line, sizeof(line), fd))
+    {
+        char *p = line, *fn, *end;
+        u64 offset;
+
+        line[strcspn(line, "#\r\n")] = '\0';
+        offset = strtoull(p, &end, 0);
+        if (end == p)
+        {
+            // blank line or comment
+            if (p[strspn(p, " \t")] == '\0')
+                continue;
+            goto out;
+        }
+
+        fn = end + strspn(end, " \t");
+        fn[strcspn(fn, " \t")] = '\0';
+        if (!*fn)
+            goto out;
+
+        int ret;
+        if (*fn == '/')
+            ret = add_segment(private_data, fn, offset);
+        else {
+            char *path = join_path(dir, fn);
+            ret = path ? add_segment(private_data, path, offset) : -1;
+            free(path);
+        }
+        if (ret)
+            goto out;
+    }
+    retval = 0;
+
+out:
+    free(dir);
+    fclose(fd);
+    return retval;
+}
+
+// offset-<offset>.dat
+__hidden bool memory_is_offset_dump(const char *name)
+{
+    size_t len = strlen(name);
+    char *end;
+
+    if (strncmp(name, OFFSET_PREFIX, strlen(OFFSET_PREFIX)) || len < 4 || strcmp(name + len - 4, ".dat"))
+        return false;
+
+    strtoull(name + strlen(OFFSET_PREFIX), &end, 0);
+    return !strcmp(end, ".dat");
+}
+
+static int load_dump_dir(struct segments_data *private_data, const char *dirname)
+{
+    char *path;
+    char **names;
+    int num;
+    int ret;
+
+    // an already reconstructed image takes precedence, as in runtests.sh
+    path = join_path(dirname, DIR_FULL_DUMP);
+    ret = path ? add_segment(private_data, path, 0) : -1;
+    free(path);
+    if (ret <= 0)
+        return ret;
+
+    for (size_t i=0; i<sizeof(dump_layout)/sizeof(dump_layout[0]); ++i)
+    {
+        path = join_path(dirname, dump_layout[i].fn);
+        ret = path ? add_segment(private_data, path, dump_layout[i].offset) : -1;
+        free(path);
+        if (ret < 0)
+            return -1;
+    }
+
+    // in name order, like the glob this replaces, so overlapping overlays
+    // resolve the same way on every filesystem
+    num = memory_list_offset_dumps(dirname, &names);
+    if (num < 0)
+        return -1;
+
+    ret = 0;
+    for (int i=0; i<num; ++i)
+    {
+        if (ret >= 0)
+        {
+            u64 offset = strtoull(names[i] + strlen(OFFSET_PREFIX), 0, 0);
+            path = join_path(dirname, names[i]);
+            ret = path ? add_segment(private_data, path, offset) : -1;
+            free(path);
+        }
+        free(names[i]);
+    }
+    free(names);
+    return ret < 0 ? -1 : 0;
+}
+
+__hidden bool memory_is_segment_source(const char *fn)
+{
+    struct stat st;
+    size_t len = strlen(fn);
+
+    if (len > strlen(MANIFEST_SUFFIX) && !strcmp(fn + len - strlen(MANIFEST_SUFFIX), MANIFEST_SUFFIX))
+        return true;
+
+    return stat(fn, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+__hidden int init_mem_struct_segments(struct memory_access_obj *m, const char *fn)
+{
+    char *errbuf;
+    char *manifest = 0;
+    struct segments_data *private_data;
+    struct stat st;
+    const char *error = _("There was an allocation failure while trying to construct the memory object. Path: ");
+    int ret;
+
+    fnprintf("\n");
+
+    m->private_data = private_data = calloc(1, sizeof(struct segments_data));
+    m->errstring = calloc(1, ERROR_BUFSIZE);
+    if (!private_data || !m->errstring)
+        goto out_fail;
+
+    m->free = SEG_free;
+    m->read_fn = SEG_read_fn;
+    m->write_fn = SEG_write_fn;
+    m->cleanup = 0;
+
+    error = _("Could not load memory dump segments. Path: ");
+    if (stat(fn, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        manifest = join_path(fn, DIR_MANIFEST);
+        if (!manifest)
+            goto out_fail;
+        if (stat(manifest, &st) == 0)
+            ret = load_manifest(private_data, manifest);
+        else
+            ret = load_dump_dir(private_data, fn);
+        free(manifest);
+    }
+    else
+        ret = load_manifest(private_data, fn);
+
+    if (ret)
+        goto out_fail;
+
+    m->initialized = 1;
+    return 0;
+
+out_fail:
+    fnprintf("out_fail:\n");
+    errbuf = memory_get_module_error_buf();
+    if (errbuf){
+        strlcpy(errbuf, error, ERROR_BUFSIZE);
+        strlcat(errbuf, fn, ERROR_BUFSIZE);
+        strlcat(errbuf, _("\nThe OS Error string was: "), ERROR_BUFSIZE);
+        strlcat(errbuf, strerror(errno), ERROR_BUFSIZE);
+    }
+    if (private_data)
+        SEG_free(m);
+    else {
+        free(m->errstring);
+        m->errstring = 0;
+    }
+    return -1;
+}
+
+// zero-copy view of a caller-owned buffer mapped at 'base'. The caller must
+// keep the buffer alive until the object is freed.
+__hidden int init_mem_struct_buffer(struct memory_access_obj *m, u64 base, void *buf, size_t len)
+{
+    char *errbuf;
+    struct segments_data *private_data;
+
+    fnprintf("\n");
+
+    m->private_data = private_data = calloc(1, sizeof(struct segments_data));
+    m->errstring = calloc(1, ERROR_BUFSIZE);
+    if (!private_data || !m->errstring || !buf)
+        goto out_fail;
+
+    private_data->segs = calloc(1, sizeof(struct segment));
+    if (!private_data->segs)
+        goto out_fail;
+
+    private_data->borrowed = true;
+    private_data->num_segs = 1;
+    private_data->segs[0].offset = base;
+    private_data->segs[0].length = len;
+    private_data->segs[0].data = buf;
+
+    m->free = SEG_free;
+    m->read_fn = SEG_read_fn;
+    m->write_fn = SEG_write_fn;
+    m->cleanup = 0;
+    m->initialized = 1;
+    return 0;
+
+out_fail:
+    errbuf = memory_get_module_error_buf();
+    if (errbuf)
+        strlcpy(errbuf, buf ? _("There was an allocation failure while trying to construct the memory object.")
+                            : _("NULL buffer passed to memory object constructor."), ERROR_BUFSIZE);
+    if (private_data)
+    {
+        private_data->borrowed = true;
+        SEG_free(m);
+    } else {
+        free(m->errstring);
+        m->errstring = 0;
+    }
+    return -1;
+}
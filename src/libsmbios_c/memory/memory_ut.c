@@ -176,7 +176,6 @@ int init_mem_struct_filename(struct memory_access_obj *m, const char *fn)
     m->read_fn = UT_read_fn;
     m->write_fn = UT_write_fn;
     m->cleanup = UT_cleanup;
-    m->close = 1;
     m->initialized = 1;
 
     return 0;
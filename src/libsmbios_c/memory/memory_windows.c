@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "smbios_c/obj/memory.h"
 #include "smbios_c/types.h"
@@ -311,3 +312,55 @@ out:
     return retval;
 }
 
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+__hidden int memory_list_offset_dumps(const char *dirname, char ***names)
+{
+    WIN32_FIND_DATAA found;
+    HANDLE find;
+    char *pattern;
+    char **list = 0, **bigger;
+    int num = 0;
+
+    *names = 0;
+    pattern = calloc(1, strlen(dirname) + 3);
+    if (!pattern)
+        return -1;
+    strcat(pattern, dirname);
+    strcat(pattern, "\\*");
+
+    find = FindFirstFileA(pattern, &found);
+    free(pattern);
+    if (find == INVALID_HANDLE_VALUE)
+        return GetLastError() == ERROR_FILE_NOT_FOUND ? 0 : -1;
+
+    do {
+        if (!memory_is_offset_dump(found.cFileName))
+            continue;
+        bigger = realloc(list, (num + 1) * sizeof(char *));
+        if (!bigger || !(bigger[num] = strdup(found.cFileName)))
+        {
+            list = bigger ? bigger : list;
+            goto out_fail;
+        }
+        list = bigger;
+        num++;
+    } while (FindNextFileA(find, &found));
+    FindClose(find);
+
+    // same order as alphasort() gives on linux
+    if (num)
+        qsort(list, num, sizeof(char *), compare_names);
+    *names = list;
+    return num;
+
+out_fail:
+    FindClose(find);
+    for (int i=0; i<num; ++i)
+        free(list[i]);
+    free(list);
+    return -1;
+}
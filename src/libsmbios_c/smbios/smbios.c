@@ -69,6 +69,22 @@ struct smbios_struct *smbios_get_next_struct_by_handle(const struct smbios_struc
     return ret;
 }
 
+const char *smbios_get_dell_oem_tag(int tag)
+{
+    struct smbios_table *table = smbios_table_factory(SMBIOS_DEFAULTS);
+    const char *ret = smbios_table_get_dell_oem_tag(table, tag);
+    smbios_table_free(table);
+    return ret;
+}
+
+size_t smbios_get_dell_oem_tags(const struct smbios_oem_tag **tags)
+{
+    struct smbios_table *table = smbios_table_factory(SMBIOS_DEFAULTS);
+    size_t ret = smbios_table_get_dell_oem_tags(table, tags);
+    smbios_table_free(table);
+    return ret;
+}
+
 char *smbios_strerror()
 {
     char *ret;
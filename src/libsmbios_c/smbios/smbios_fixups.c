@@ -56,7 +56,7 @@ static bool system_affected(u16 *id_list, int num, u16 sysid)
 }
 
 // define
-__hidden u16 get_id_byte_from_mem();
+__hidden u16 get_id_byte_from_mem_cached(u64 table_hash);
 
 #define DELL_CHECK_FIXUP_BAD_HANDLE 0xd402
 static void do_dell_check_type_fixup(struct smbios_table *table)
@@ -67,7 +67,7 @@ static void do_dell_check_type_fixup(struct smbios_table *table)
     struct indexed_io_access_structure *broken = 0;
 
     dbg_printf ("%s\n", __PRETTY_FUNCTION__);
-    u16 sysid = get_id_byte_from_mem();
+    u16 sysid = get_id_byte_from_mem_cached(smbios_table_get_hash(table));
     if (!system_affected(affected, num_affected, sysid))
         goto out;
 
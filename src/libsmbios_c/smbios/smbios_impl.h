@@ -86,6 +86,8 @@ struct smbios_table_entry_point_64
 #pragma pack(pop)
 #endif
 
+struct memory_access_obj;
+
 struct smbios_table
 {
     int initialized;
@@ -94,17 +96,32 @@ struct smbios_table
     long table_length;
     int last_errno;
     char *errstring;
+    int borrowed;   // SMBIOS_FROM_BUFFER: table memory belongs to the caller
+    u64 hash;       // of the table before fixups, see smbios_table_get_hash()
+    struct smbios_oem_tag *oem_tags;    // see smbios_oem_tags.c
+    size_t num_oem_tags;
+    struct memory_access_obj *memory;   // SMBIOS_FROM_MEMORY: borrowed. 0: the memory singleton
+    int from_firmware;  // read from this machine's firmware, not a unit test image
 };
 
 int __hidden init_smbios_struct(struct smbios_table *m);
+int __hidden init_smbios_struct_buffer(struct smbios_table *m, const void *buf, size_t len);
 void __hidden _smbios_table_free(struct smbios_table *this);
 void __hidden do_smbios_fixups(struct smbios_table *);
+u64 __hidden smbios_table_get_hash(const struct smbios_table *);
+u64 __hidden smbios_singleton_get_hash(void);
+bool __hidden smbios_singleton_get_path(const char **path);
+__hidden const void *smbios_table_get_buffer(const struct smbios_table *, size_t *len);
+void __hidden smbios_build_oem_tag_index(struct smbios_table *);
 bool __hidden validate_dmi_tep(const struct dmi_table_entry_point *dmiTEP);
 bool __hidden smbios_verify_smbios(const char *buf, long length, long *dmi_length_out);
 bool __hidden smbios_verify_smbios3(const char *buf, long length, long *dmi_length_out);
 int __hidden smbios_get_table_firm_tables(struct smbios_table *m);
 int __hidden smbios_get_table_memory(struct smbios_table *m);
 
+// memory layer
+bool __hidden memory_singleton_is_emulated(void);
+
 
 EXTERN_C_END;
 
@@ -26,7 +26,7 @@
 #include <string.h>
 
 // public
-#include "smbios_c/memory.h"
+#include "smbios_c/obj/memory.h"
 #include "smbios_c/types.h"
 #include "smbios_impl.h"
 #include "internal_strl.h"
@@ -160,6 +160,18 @@ out:
     return retval;
 }
 
+// the caller's memory image for SMBIOS_FROM_MEMORY tables, else the singleton
+static struct memory_access_obj *table_memory(const struct smbios_table *m)
+{
+    return m->memory ? m->memory : memory_obj_factory(MEMORY_GET_SINGLETON);
+}
+
+static void table_memory_done(const struct smbios_table *m, struct memory_access_obj *mem)
+{
+    if (mem != m->memory)
+        memory_obj_free(mem);
+}
+
 /* this method is only designed to work with SMBIOS 2.0
    - it is also what pythong unit tests will use.
    - when the unit tests are changed over to use sysfs files
@@ -170,6 +182,7 @@ int __hidden smbios_get_tep_memory(struct smbios_table *table, u64 *address, lon
     int retval = 0;
     unsigned long fp = E_BLOCK_START;
     const char *errstring;
+    struct memory_access_obj *mem;
     u8 *block = malloc(sizeof(struct smbios_table_entry_point));
     if (!block)
         goto out_block;
@@ -179,11 +192,12 @@ int __hidden smbios_get_tep_memory(struct smbios_table *table, u64 *address, lon
     // tell the memory subsystem that it can optimize here and
     // keep memory open while we scan rather than open/close/open/close/...
     // for each fillBuffer() call
-    memory_suggest_leave_open();
+    mem = table_memory(table);
+    memory_obj_suggest_leave_open(mem);
     errstring = _("Could not read physical memory. Lowlevel error was:\n");
     while ( (fp + sizeof(struct smbios_table_entry_point)) < F_BLOCK_END)
     {
-        int ret = memory_read(block, fp, sizeof(struct smbios_table_entry_point));
+        int ret = memory_obj_read(mem, block, fp, sizeof(struct smbios_table_entry_point));
         if (ret)
             goto out_memerr;
 
@@ -203,7 +217,7 @@ int __hidden smbios_get_tep_memory(struct smbios_table *table, u64 *address, lon
     }
 
     // dont need memory optimization anymore
-    memory_suggest_close();
+    memory_obj_suggest_close(mem);
 
     // bad stuff happened if we got to here and fp > 0xFFFFFL
     errstring = _("Did not find smbios table entry point in memory.");
@@ -216,8 +230,9 @@ int __hidden smbios_get_tep_memory(struct smbios_table *table, u64 *address, lon
 out_memerr:
     fnprintf("out_memerr: %s\n", errstring);
     strlcat (table->errstring, errstring, ERROR_BUFSIZE);
-    fnprintf(" ->memory_strerror()\n");
-    strlcat (table->errstring, memory_strerror(), ERROR_BUFSIZE);
+    fnprintf(" ->memory_obj_strerror()\n");
+    strlcat (table->errstring, memory_obj_strerror(mem), ERROR_BUFSIZE);
+    memory_obj_suggest_close(mem);
     goto out;
 
 out_notfound:
@@ -230,6 +245,7 @@ out_block:
     return retval;
 
 out:
+    table_memory_done(table, mem);
     free(block);
     fnprintf("out\n");
     return retval;
@@ -248,7 +264,9 @@ int __hidden smbios_get_table_memory(struct smbios_table *m)
 
     error = _("Found table entry point but could not read table from memory. ");
     m->table = (struct table*)calloc(1, m->table_length);
-    retval = memory_read(m->table, address, m->table_length);
+    struct memory_access_obj *mem = table_memory(m);
+    retval = memory_obj_read(mem, m->table, address, m->table_length);
+    table_memory_done(m, mem);
     if (retval != 0)
         goto out_free_table;
 
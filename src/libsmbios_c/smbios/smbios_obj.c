@@ -42,20 +42,12 @@
 
 // static vars
 static struct smbios_table singleton; // auto-init to 0
-static char *module_error_buf; // auto-init to 0
-
-__attribute__((destructor)) static void return_mem(void)
-{
-    fnprintf("\n");
-    free(module_error_buf);
-    module_error_buf = 0;
-}
+// per thread, like errno: objects are used from many threads at once
+static __thread char module_error_buf[ERROR_BUFSIZE];
 
 static char *smbios_get_module_error_buf()
 {
     fnprintf("\n");
-    if (!module_error_buf)
-        module_error_buf = calloc(1, ERROR_BUFSIZE);
     return module_error_buf;
 }
 
@@ -63,8 +55,66 @@ static void clear_err(const struct smbios_table *this)
 {
     if (this && this->errstring)
         memset(this->errstring, 0, ERROR_BUFSIZE);
-    if(module_error_buf)
-        memset(module_error_buf, 0, ERROR_BUFSIZE);
+    memset(module_error_buf, 0, ERROR_BUFSIZE);
+}
+
+// FNV-1a over the raw table: identifies a table, not a security measure
+static u64 hash_table(const struct smbios_table *this)
+{
+    u64 hash = 0xcbf29ce484222325ULL;
+    const u8 *p = (const u8 *)this->table;
+    for (long i=0; p && i<this->table_length; ++i)
+        hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+u64 __hidden smbios_table_get_hash(const struct smbios_table *this)
+{
+    return this ? this->hash : 0;
+}
+
+// the singleton's hash without setting the singleton up if it is not yet:
+// only the raw table is read, no fixups and no oem tag index. 0 on error
+u64 __hidden smbios_singleton_get_hash(void)
+{
+    struct smbios_table *raw;
+    u64 hash;
+
+    if (singleton.initialized)
+        return singleton.hash;
+
+    raw = (struct smbios_table *)calloc(1, sizeof(struct smbios_table));
+    if (!raw)
+        return 0;
+    // frees raw on failure
+    if (init_smbios_struct(raw))
+        return 0;
+    hash = hash_table(raw);
+    smbios_table_free(raw);
+    return hash;
+}
+
+// false if the singleton table is not this machine's: handed in by the
+// caller, or built from a unit test memory image. otherwise *path is its unit
+// test directory, or 0 if it comes from this machine's firmware
+bool __hidden smbios_singleton_get_path(const char **path)
+{
+    *path = singleton.table_path;
+    if (singleton.borrowed)
+        return false;
+    if (singleton.table_path)
+        return true;
+    // not loaded yet: it will come from firmware unless memory is a test image
+    if (!singleton.initialized)
+        return !memory_singleton_is_emulated();
+    return singleton.from_firmware;
+}
+
+// the raw structure table, after fixups
+__hidden const void *smbios_table_get_buffer(const struct smbios_table *this, size_t *len)
+{
+    *len = this ? this->table_length : 0;
+    return this ? this->table : 0;
 }
 
 struct smbios_table *smbios_table_factory(int flags, ...)
@@ -86,7 +136,27 @@ struct smbios_table *smbios_table_factory(int flags, ...)
     if (toReturn->initialized)
         goto out;
 
-    if (flags & SMBIOS_UNIT_TEST_MODE) {
+    if (flags & SMBIOS_FROM_BUFFER) {
+        va_start(ap, flags);
+        const void *buf = va_arg(ap, const void *);
+        size_t len = va_arg(ap, size_t);
+        va_end(ap);
+        // fixups are never applied to a borrowed table: they would write into
+        // caller memory and probe the ID byte of the machine we are running on
+        if (init_smbios_struct_buffer(toReturn, buf, len))
+            goto out_init_fail;
+        toReturn->hash = hash_table(toReturn);
+        smbios_build_oem_tag_index(toReturn);
+        goto out;
+    }
+
+    if (flags & SMBIOS_FROM_MEMORY) {
+        va_start(ap, flags);
+        toReturn->memory = va_arg(ap, struct memory_access_obj *);
+        va_end(ap);
+        // the image is usually another machine's: fixups key off our ID byte
+        flags |= SMBIOS_NO_FIXUPS;
+    } else if (flags & SMBIOS_UNIT_TEST_MODE) {
         va_start(ap, flags);
         const char *filename = va_arg(ap, const char *);
         long len = strlen(filename);
@@ -104,6 +174,10 @@ struct smbios_table *smbios_table_factory(int flags, ...)
     if (ret)
         goto out_init_fail;
 
+    // of the table as the bios gave it, so it does not depend on fixups
+    toReturn->hash = hash_table(toReturn);
+    smbios_build_oem_tag_index(toReturn);
+
     if (!(flags & SMBIOS_NO_FIXUPS))
         do_smbios_fixups(toReturn);
 
@@ -133,7 +207,11 @@ void smbios_table_free(struct smbios_table *this)
     free(this->errstring);
     this->errstring = 0;
 
-    free(this->table);
+    free(this->oem_tags);
+    this->oem_tags = 0;
+
+    if (!this->borrowed)
+        free(this->table);
     this->table = 0;
 
     this->initialized=0;
@@ -354,13 +432,19 @@ int __hidden init_smbios_struct(struct smbios_table *m)
     fnprintf("\n");
     error = _("Could not instantiate SMBIOS table. The errors from the low-level modules were:\n");
 
-    // smbios firmware tables strategy
-    if (smbios_get_table_firm_tables(m) >= 0)
+    // smbios firmware tables strategy. not for SMBIOS_FROM_MEMORY tables
+    if (!m->memory && smbios_get_table_firm_tables(m) >= 0)
+    {
+        m->from_firmware = !m->table_path;
         return 0;
+    }
 
     // smbios memory strategy
     if (smbios_get_table_memory(m) >= 0)
+    {
+        m->from_firmware = !m->table_path && !m->memory && !memory_singleton_is_emulated();
         return 0;
+    }
 
     // fall through to failure...
 
@@ -376,6 +460,34 @@ out_fail:
 }
 
 
+// zero-copy: table points at the caller's buffer, which must outlive us.
+int __hidden init_smbios_struct_buffer(struct smbios_table *m, const void *buf, size_t len)
+{
+    char *errbuf;
+    const char *error = _("Allocation error trying to allocate memory for error string. (ironic, yes?) \n");
+
+    fnprintf("\n");
+    m->errstring = calloc(1, ERROR_BUFSIZE);
+    if (!m->errstring)
+        goto out_fail;
+
+    error = _("Invalid SMBIOS table buffer passed in.");
+    if (!buf || len < sizeof(struct smbios_struct))
+        goto out_fail;
+
+    m->table = (struct table *)buf;
+    m->table_length = len;
+    m->borrowed = 1;
+    m->initialized = 1;
+    return 0;
+
+out_fail:
+    errbuf = smbios_get_module_error_buf();
+    if (errbuf)
+        strlcpy(errbuf, error, ERROR_BUFSIZE);
+    smbios_table_free(m);
+    return -1;
+}
 
 // validate the smbios table entry point
 bool __hidden validate_dmi_tep(const struct dmi_table_entry_point *dmiTEP)
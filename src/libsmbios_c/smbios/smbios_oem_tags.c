@@ -0,0 +1,133 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+
+// Include compat.h first, then system headers, then public, then private
+#include "smbios_c/compat.h"
+
+// system
+#include <stdlib.h>
+#include <string.h>
+
+// public
+#include "smbios_c/obj/smbios.h"
+#include "smbios_c/smbios.h"
+#include "smbios_c/types.h"
+
+// private
+#include "smbios_impl.h"
+
+/*
+ * Index of the "N[value]" items in Dell OEM strings (type 0x0B) structures,
+ * built once when a table is set up. Only structures whose first string is
+ * "Dell System" count. Tags and values are parsed with one linear pass over
+ * each string set; the index and copies of all values are one allocation.
+ */
+
+#define OEM_STRINGS_TYPE    0x0B
+#define DELL_SYSTEM_STRING  "Dell System"
+
+// calls fn for each tagged item. returns the number of items
+static size_t for_each_oem_tag(const struct smbios_table *table,
+        void (*fn)(int tag, const char *value, size_t len, void *userdata), void *userdata)
+{
+    size_t count = 0;
+    smbios_table_for_each_struct_type(table, s, OEM_STRINGS_TYPE) {
+        const char *str = (const char *)s + smbios_struct_get_length(s);
+        if (strncmp(str, DELL_SYSTEM_STRING, strlen(DELL_SYSTEM_STRING)))
+            continue;
+
+        // string set ends with an empty string
+        for (str += strlen(str) + 1; *str; str += strlen(str) + 1) {
+            char *endptr = 0;
+            long tag = strtol(str, &endptr, 10);
+            if (strlen(str) <= 3 || endptr == str || endptr[0] != '[')
+                continue;
+
+            // value runs to the closing bracket; some BIOSes pad after it
+            const char *value = endptr + 1;
+            const char *close = strchr(value, ']');
+            size_t len = close ? (size_t)(close - value) : strlen(value);
+            if (fn)
+                fn((int)tag, value, len, userdata);
+            ++count;
+        }
+    }
+    return count;
+}
+
+struct fill_state
+{
+    struct smbios_oem_tag *next;
+    char *strings;
+};
+
+static void size_tag(int tag, const char *value, size_t len, void *userdata)
+{
+    *(size_t *)userdata += len + 1;
+}
+
+static void fill_tag(int tag, const char *value, size_t len, void *userdata)
+{
+    struct fill_state *st = userdata;
+    memcpy(st->strings, value, len);
+    st->strings[len] = '\0';
+    st->next->tag = tag;
+    st->next->value = st->strings;
+    st->next++;
+    st->strings += len + 1;
+}
+
+void __hidden smbios_build_oem_tag_index(struct smbios_table *table)
+{
+    size_t bytes = 0;
+    size_t count = for_each_oem_tag(table, size_tag, &bytes);
+
+    fnprintf(" %zd tags\n", count);
+    table->oem_tags = 0;
+    table->num_oem_tags = 0;
+    if (!count)
+        return;
+
+    table->oem_tags = calloc(1, count * sizeof(struct smbios_oem_tag) + bytes);
+    if (!table->oem_tags)
+        return;
+
+    struct fill_state st = { table->oem_tags, (char *)(table->oem_tags + count) };
+    for_each_oem_tag(table, fill_tag, &st);
+    table->num_oem_tags = count;
+}
+
+const char *smbios_table_get_dell_oem_tag(const struct smbios_table *table, int tag)
+{
+    if (!table)
+        return 0;
+
+    for (size_t i=0; i<table->num_oem_tags; ++i)
+        if (table->oem_tags[i].tag == tag)
+            return table->oem_tags[i].value;
+    return 0;
+}
+
+size_t smbios_table_get_dell_oem_tags(const struct smbios_table *table, const struct smbios_oem_tag **tags)
+{
+    if (tags)
+        *tags = table ? table->oem_tags : 0;
+    return table ? table->num_oem_tags : 0;
+}
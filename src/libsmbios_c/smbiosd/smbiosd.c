@@ -0,0 +1,352 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+
+// Include compat.h first, then system headers, then public, then private
+#include "smbios_c/compat.h"
+
+// system
+#include <stdlib.h>
+#include <string.h>
+
+// public
+#include "smbios_c/obj/token.h"
+#include "smbios_c/token.h"
+#include "smbios_c/smbiosd.h"
+#include "smbios_c/system_info.h"
+
+// private
+#include "smbiosd_impl.h"
+#include "internal_strl.h"
+
+static char *module_error_buf; // auto-init to 0
+
+__attribute__((destructor)) static void return_mem(void)
+{
+    fnprintf("\n");
+    free(module_error_buf);
+    module_error_buf = 0;
+}
+
+__hidden char *smbiosd_get_module_error_buf()
+{
+    if (!module_error_buf)
+        module_error_buf = calloc(1, ERROR_BUFSIZE);
+    return module_error_buf;
+}
+
+__hidden void smbiosd_clearerr()
+{
+    if (module_error_buf)
+        memset(module_error_buf, 0, ERROR_BUFSIZE);
+}
+
+__hidden void smbiosd_seterr(const char *msg)
+{
+    char *errbuf = smbiosd_get_module_error_buf();
+    if (errbuf)
+        strlcpy(errbuf, msg, ERROR_BUFSIZE);
+}
+
+LIBSMBIOS_C_DLL_SPEC const char *smbiosd_strerror()
+{
+    return module_error_buf;
+}
+
+
+/**************************************************
+ *
+ * payload codecs
+ *
+ **************************************************/
+
+#define SNAPSHOT_STRINGS 5
+
+static void snapshot_strings(const struct sysinfo_snapshot *snap, const char **str)
+{
+    str[0] = snap->vendor_name;
+    str[1] = snap->system_name;
+    str[2] = snap->bios_version;
+    str[3] = snap->service_tag;
+    str[4] = snap->asset_tag;
+}
+
+__hidden u8 *smbiosd_pack_snapshot(const struct sysinfo_snapshot *snap, size_t *len)
+{
+    const char *str[SNAPSHOT_STRINGS];
+    struct smbiosd_wire_snapshot w;
+    u8 *payload, *p;
+
+    snapshot_strings(snap, str);
+    memset(&w, 0, sizeof(w));
+    w.dell_system_id = snap->dell_system_id;
+    w.dell_oem_system_id = snap->dell_oem_system_id;
+    w.src[0] = snap->vendor_name_src;
+    w.src[1] = snap->system_name_src;
+    w.src[2] = snap->bios_version_src;
+    w.src[3] = snap->service_tag_src;
+    w.src[4] = snap->asset_tag_src;
+    w.src[5] = snap->dell_system_id_src;
+    w.src[6] = snap->dell_oem_system_id_src;
+
+    *len = sizeof(w);
+    for (int i=0; i<SNAPSHOT_STRINGS; ++i)
+        if (str[i])
+        {
+            w.present |= 1 << i;
+            *len += strlen(str[i]) + 1;
+        }
+
+    payload = malloc(*len);
+    if (!payload)
+        return 0;
+
+    memcpy(payload, &w, sizeof(w));
+    p = payload + sizeof(w);
+    for (int i=0; i<SNAPSHOT_STRINGS; ++i)
+        if (str[i])
+        {
+            size_t n = strlen(str[i]) + 1;
+            memcpy(p, str[i], n);
+            p += n;
+        }
+    return payload;
+}
+
+// laid out like sysinfo_snapshot() does, so sysinfo_snapshot_free() works
+__hidden struct sysinfo_snapshot *smbiosd_unpack_snapshot(const u8 *payload, size_t len)
+{
+    struct smbiosd_wire_snapshot w;
+    struct sysinfo_snapshot *snap;
+    const char *str[SNAPSHOT_STRINGS];
+    const char *p, *end;
+
+    if (len < sizeof(w))
+        return 0;
+    memcpy(&w, payload, sizeof(w));
+
+    // every present string must be terminated inside the payload
+    p = (const char *)payload + sizeof(w);
+    end = (const char *)payload + len;
+    for (int i=0; i<SNAPSHOT_STRINGS; ++i)
+    {
+        str[i] = 0;
+        if (!(w.present & (1 << i)))
+            continue;
+        const char *nul = memchr(p, 0, end - p);
+        if (!nul)
+            return 0;
+        str[i] = p;
+        p = nul + 1;
+    }
+
+    snap = calloc(1, sizeof(*snap) + (p - ((const char *)payload + sizeof(w))));
+    if (!snap)
+        return 0;
+
+    const char **dest[SNAPSHOT_STRINGS] = {
+        &snap->vendor_name, &snap->system_name, &snap->bios_version,
+        &snap->service_tag, &snap->asset_tag,
+    };
+    char *strings = (char *)(snap + 1);
+    for (int i=0; i<SNAPSHOT_STRINGS; ++i)
+    {
+        if (!str[i])
+            continue;
+        strcpy(strings, str[i]);
+        *dest[i] = strings;
+        strings += strlen(strings) + 1;
+    }
+
+    snap->dell_system_id = w.dell_system_id;
+    snap->dell_oem_system_id = w.dell_oem_system_id;
+    snap->vendor_name_src = w.src[0];
+    snap->system_name_src = w.src[1];
+    snap->bios_version_src = w.src[2];
+    snap->service_tag_src = w.src[3];
+    snap->asset_tag_src = w.src[4];
+    snap->dell_system_id_src = w.src[5];
+    snap->dell_oem_system_id_src = w.src[6];
+    return snap;
+}
+
+struct growbuf
+{
+    u8 *data;
+    size_t len, size;
+};
+
+static int growbuf_append(struct growbuf *b, const void *data, size_t len)
+{
+    if (b->len + len > b->size)
+    {
+        size_t size = b->size ? b->size : 4096;
+        while (size < b->len + len)
+            size *= 2;
+        u8 *n = realloc(b->data, size);
+        if (!n)
+            return -1;
+        b->data = n;
+        b->size = size;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+// reads every token value now: CMOS for D4 tokens, SMI for DA tokens
+__hidden u8 *smbiosd_pack_tokens(const struct token_table *table, size_t *len)
+{
+    struct growbuf b;
+    u32 count = 0;
+
+    memset(&b, 0, sizeof(b));
+    if (growbuf_append(&b, &count, sizeof(count)))
+        goto out_fail;
+
+    token_table_for_each(table, token) {
+        struct smbiosd_wire_token w;
+        char *value = 0;
+        size_t value_len = 0;
+
+        memset(&w, 0, sizeof(w));
+        w.id = token_obj_get_id(token);
+        w.type = token_obj_get_type(token);
+        if (token_obj_is_bool(token))
+        {
+            int active = token_obj_is_active(token);
+            w.flags |= SMBIOSD_TOKEN_BOOL;
+            if (active > 0)
+                w.flags |= SMBIOSD_TOKEN_ACTIVE;
+            else if (active < 0)
+                w.flags |= SMBIOSD_TOKEN_ERROR;
+        }
+        if (token_obj_is_string(token))
+        {
+            w.flags |= SMBIOSD_TOKEN_STRING;
+            value = token_obj_get_string(token, &value_len);
+            if (!value)
+                w.flags |= SMBIOSD_TOKEN_ERROR;
+            else
+                w.value_len = value_len > 0xFFFF ? 0xFFFF : value_len;
+        }
+
+        int ret = growbuf_append(&b, &w, sizeof(w));
+        if (!ret && value)
+            ret = growbuf_append(&b, value, w.value_len);
+        token_string_free(value);
+        if (ret)
+            goto out_fail;
+        count++;
+    }
+
+    memcpy(b.data, &count, sizeof(count));
+    *len = b.len;
+    return b.data;
+
+out_fail:
+    free(b.data);
+    return 0;
+}
+
+// walks 'count' wire tokens. returns the number of valid ones
+static size_t walk_tokens(const u8 *p, size_t len, u32 count, size_t *values_len, const u8 **found, u16 id, size_t *found_len)
+{
+    size_t n = 0;
+    const u8 *end = p + len;
+
+    while (n < count && (size_t)(end - p) >= sizeof(struct smbiosd_wire_token))
+    {
+        struct smbiosd_wire_token w;
+        memcpy(&w, p, sizeof(w));
+        size_t size = sizeof(w) + w.value_len;
+        if ((size_t)(end - p) < size)
+            break;
+        if (found && w.id == id)
+        {
+            *found = p;
+            *found_len = size;
+            return n + 1;
+        }
+        if (values_len)
+            *values_len += w.value_len + 1;
+        p += size;
+        n++;
+    }
+    return n;
+}
+
+__hidden const u8 *smbiosd_find_packed_token(const u8 *payload, size_t len, u16 id, size_t *token_len)
+{
+    const u8 *found = 0;
+    u32 count;
+
+    if (len < sizeof(count))
+        return 0;
+    memcpy(&count, payload, sizeof(count));
+    walk_tokens(payload + sizeof(count), len - sizeof(count), count, 0, &found, id, token_len);
+    return found;
+}
+
+// 'list' payloads start with a count, single token replies do not
+__hidden struct smbiosd_token *smbiosd_unpack_tokens(const u8 *payload, size_t len, bool list, size_t *count)
+{
+    struct smbiosd_token *tokens;
+    size_t values_len = 0;
+    u32 wanted = 1;
+
+    *count = 0;
+    if (list)
+    {
+        if (len < sizeof(wanted))
+            return 0;
+        memcpy(&wanted, payload, sizeof(wanted));
+        payload += sizeof(wanted);
+        len -= sizeof(wanted);
+    }
+    if (walk_tokens(payload, len, wanted, &values_len, 0, 0, 0) != wanted)
+        return 0;
+
+    // never a 0 sized allocation, so an empty list is not an error
+    tokens = calloc(1, wanted * sizeof(*tokens) + values_len + 1);
+    if (!tokens)
+        return 0;
+
+    char *values = (char *)(tokens + wanted);
+    for (u32 i=0; i<wanted; ++i)
+    {
+        struct smbiosd_wire_token w;
+        memcpy(&w, payload, sizeof(w));
+        payload += sizeof(w);
+
+        tokens[i].id = w.id;
+        tokens[i].type = w.type;
+        tokens[i].flags = w.flags;
+        tokens[i].value_len = w.value_len;
+        if (w.flags & SMBIOSD_TOKEN_STRING && !(w.flags & SMBIOSD_TOKEN_ERROR))
+        {
+            memcpy(values, payload, w.value_len);
+            tokens[i].value = values;
+            values += w.value_len + 1;
+        }
+        payload += w.value_len;
+    }
+    *count = wanted;
+    return tokens;
+}
@@ -0,0 +1,127 @@
+// vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:
+/*
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef SMBIOSD_IMPL_H
+#define SMBIOSD_IMPL_H
+
+#include "smbios_c/compat.h"
+#include "smbios_c/smbiosd.h"
+#include "smbios_c/types.h"
+
+EXTERN_C_BEGIN;
+
+#undef DEBUG_MODULE_NAME
+#define DEBUG_MODULE_NAME "DEBUG_SMBIOSD_C"
+
+#define ERROR_BUFSIZE 1024
+
+/*
+ * Wire protocol. Both ends are on the same machine, so everything is in host
+ * byte order. A client sends a request and reads one reply: the header,
+ * then 'length' bytes of payload. Requests on one connection are answered
+ * in order.
+ */
+#define SMBIOSD_MAGIC           0x44424d53  // "SMBD"
+#define SMBIOSD_PROTO_VERSION   1
+#define SMBIOSD_MAX_PAYLOAD     (16 << 20)  // sanity limit for clients
+
+enum smbiosd_op
+{
+    SMBIOSD_OP_PING = 1,
+    SMBIOSD_OP_GET_TABLE,       // payload: raw structure table
+    SMBIOSD_OP_GET_SNAPSHOT,    // payload: struct smbiosd_wire_snapshot + strings
+    SMBIOSD_OP_GET_TOKENS,      // payload: u32 count + count wire tokens
+    SMBIOSD_OP_GET_TOKEN,       // arg: token id. payload: one wire token
+    SMBIOSD_OP_RELOAD,          // root only
+};
+
+// reply status
+#define SMBIOSD_OK              0
+#define SMBIOSD_E_BAD_REQUEST   -1
+#define SMBIOSD_E_NOT_FOUND     -2
+#define SMBIOSD_E_PERMISSION    -3
+#define SMBIOSD_E_UNAVAILABLE   -4
+
+#if defined(_MSC_VER)
+#pragma pack(push,1)
+#endif
+struct smbiosd_request
+{
+    u32 magic;
+    u16 version;
+    u16 op;
+    u32 arg;
+}
+LIBSMBIOS_C_PACKED_ATTR;
+
+struct smbiosd_reply
+{
+    u32 magic;
+    u16 version;
+    u16 op;
+    s32 status;
+    u32 length;
+}
+LIBSMBIOS_C_PACKED_ATTR;
+
+// the five snapshot strings follow in struct order, 0 terminated, for each
+// bit set in 'present'
+struct smbiosd_wire_snapshot
+{
+    s32 dell_system_id;
+    s32 dell_oem_system_id;
+    u8 src[7];          // *_src members in struct order
+    u8 present;
+}
+LIBSMBIOS_C_PACKED_ATTR;
+
+// value_len bytes of string value follow
+struct smbiosd_wire_token
+{
+    u16 id;
+    u8 type;
+    u8 flags;
+    u16 value_len;
+}
+LIBSMBIOS_C_PACKED_ATTR;
+#if defined(_MSC_VER)
+#pragma pack(pop)
+#endif
+
+struct smbios_table;
+struct sysinfo_snapshot;
+struct token_table;
+
+__hidden char *smbiosd_get_module_error_buf();
+__hidden void smbiosd_clearerr();
+__hidden void smbiosd_seterr(const char *msg);
+
+// payload codecs, smbiosd.c. pack functions return malloc()ed payloads
+__hidden u8 *smbiosd_pack_snapshot(const struct sysinfo_snapshot *snap, size_t *len);
+__hidden struct sysinfo_snapshot *smbiosd_unpack_snapshot(const u8 *payload, size_t len);
+__hidden u8 *smbiosd_pack_tokens(const struct token_table *table, size_t *len);
+// the wire token with this id inside a packed token list, or 0
+__hidden const u8 *smbiosd_find_packed_token(const u8 *payload, size_t len, u16 id, size_t *token_len);
+// one allocation holding the array and the values
+__hidden struct smbiosd_token *smbiosd_unpack_tokens(const u8 *payload, size_t len, bool list, size_t *count);
+
+// smbios layer
+__hidden const void *smbios_table_get_buffer(const struct smbios_table *, size_t *len);
+
+EXTERN_C_END;
+
+#endif /* SMBIOSD_IMPL_H */
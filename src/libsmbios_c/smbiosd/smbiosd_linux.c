@@ -0,0 +1,875 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+
+// Include compat.h first, then system headers, then public, then private
+#include "smbios_c/compat.h"
+
+// system
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>     // PATH_MAX
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// public
+#include "smbios_c/obj/smbios.h"
+#include "smbios_c/obj/token.h"
+#include "smbios_c/smbiosd.h"
+#include "smbios_c/system_info.h"
+
+// private
+#include "smbiosd_impl.h"
+#include "internal_strl.h"
+#include "libsmbios_c_intlize.h"
+
+#define MAX_CONNECTIONS     64
+#define MAX_CONNECTIONS_UID 8   // the socket is world writable: no one user may fill it
+#define LISTEN_BACKLOG      16
+#define CONNECTION_TIMEOUT  30  // seconds a connection may go without completing a request
+#define CLIENT_TIMEOUT      5
+
+static void seterr_os(const char *msg)
+{
+    int err = errno;
+    char *errbuf = smbiosd_get_module_error_buf();
+    if (!errbuf)
+        return;
+    strlcpy(errbuf, msg, ERROR_BUFSIZE);
+    strlcat(errbuf, _("\nThe OS Error string was: "), ERROR_BUFSIZE);
+    strlcat(errbuf, strerror(err), ERROR_BUFSIZE);
+}
+
+static const char *socket_path(const char *path)
+{
+    if (!path)
+        path = getenv(SMBIOSD_SOCKET_ENV);
+    if (!path || !*path)
+        path = SMBIOSD_DEFAULT_SOCKET;
+    return path;
+}
+
+static int fill_sockaddr(struct sockaddr_un *addr, const char *path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path))
+    {
+        smbiosd_seterr(_("Socket path is too long."));
+        return -1;
+    }
+    strlcpy(addr->sun_path, path, sizeof(addr->sun_path));
+    return 0;
+}
+
+static void set_timeout(int fd, int which, int seconds)
+{
+    struct timeval tv = { seconds, 0 };
+    setsockopt(fd, SOL_SOCKET, which, &tv, sizeof(tv));
+}
+
+// header and payload in one go where the socket takes it
+static int send_all(int fd, const void *hdr, size_t hdr_len, const void *payload, size_t len)
+{
+    struct iovec iov[2] = { { (void *)hdr, hdr_len }, { (void *)payload, len } };
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    while (msg.msg_iovlen)
+    {
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        while (msg.msg_iovlen && (size_t)n >= msg.msg_iov->iov_len)
+        {
+            n -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen)
+        {
+            msg.msg_iov->iov_base = (u8 *)msg.msg_iov->iov_base + n;
+            msg.msg_iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+static int recv_all(int fd, void *buf, size_t len)
+{
+    u8 *p = buf;
+    while (len)
+    {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0)
+            errno = ECONNRESET;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+
+/**************************************************
+ *
+ * server
+ *
+ **************************************************/
+
+struct connection
+{
+    int fd;
+    uid_t uid;
+    u64 deadline;               // monotonic ms, see CONNECTION_TIMEOUT
+    size_t have;                // bytes of req received so far
+    struct smbiosd_request req;
+    u8 *out;                    // reply the socket did not take yet
+    size_t out_len;
+    size_t out_sent;
+    bool close_after;           // drop once 'out' is sent
+};
+
+struct smbiosd_server
+{
+    int listen_fd;
+    int stop_pipe[2];
+    char *path;
+    bool bound;
+
+    u8 *table;
+    size_t table_len;
+    u8 *snapshot;
+    size_t snapshot_len;
+    u8 *tokens;
+    size_t tokens_len;
+
+    size_t nconn;
+    struct connection conn[MAX_CONNECTIONS];
+};
+
+LIBSMBIOS_C_DLL_SPEC int smbiosd_server_reload(struct smbiosd_server *s)
+{
+    const char *error = _("Failed to allocate memory for the daemon data.");
+    struct sysinfo_snapshot *snap;
+    u8 *snapshot = 0, *tokens = 0;
+    size_t snapshot_len = 0, tokens_len = 0;
+
+    fnprintf("\n");
+    smbiosd_clearerr();
+
+    // token values and tags can change at runtime, force them to be re-read
+    sysinfo_tag_cache_invalidate();
+    snap = sysinfo_snapshot();
+    if (snap)
+        snapshot = smbiosd_pack_snapshot(snap, &snapshot_len);
+    sysinfo_snapshot_free(snap);
+    if (!snapshot)
+        goto out_fail;
+
+    // no token table is not an error: the list is just empty
+    struct token_table *table = token_table_factory(TOKEN_GET_SINGLETON);
+    if (table)
+        tokens = smbiosd_pack_tokens(table, &tokens_len);
+    else if ((tokens = calloc(1, sizeof(u32))))
+        tokens_len = sizeof(u32);
+    if (!tokens)
+        goto out_fail;
+
+    free(s->snapshot);
+    free(s->tokens);
+    s->snapshot = snapshot;
+    s->snapshot_len = snapshot_len;
+    s->tokens = tokens;
+    s->tokens_len = tokens_len;
+    return 0;
+
+out_fail:
+    smbiosd_seterr(error);
+    free(snapshot);
+    free(tokens);
+    return -1;
+}
+
+LIBSMBIOS_C_DLL_SPEC struct smbiosd_server *smbiosd_server_create(const char *path)
+{
+    const char *error = _("Failed to allocate memory for the daemon data.");
+    struct smbiosd_server *s;
+    struct sockaddr_un addr;
+    struct stat st;
+
+    fnprintf("\n");
+    smbiosd_clearerr();
+
+    s = calloc(1, sizeof(*s));
+    if (!s)
+        goto out_fail;
+    s->listen_fd = s->stop_pipe[0] = s->stop_pipe[1] = -1;
+    s->path = strdup(socket_path(path));
+    if (!s->path)
+        goto out_fail;
+    if (fill_sockaddr(&addr, s->path))
+        goto out_fail_err_set;
+
+    // everything is read before the socket appears
+    error = _("Could not instantiate SMBIOS table.");
+    size_t len;
+    const void *table = smbios_table_get_buffer(smbios_table_factory(SMBIOS_GET_SINGLETON), &len);
+    if (!table)
+        goto out_fail;
+    error = _("Failed to allocate memory for the daemon data.");
+    s->table = malloc(len);
+    if (!s->table)
+        goto out_fail;
+    memcpy(s->table, table, len);
+    s->table_len = len;
+
+    if (smbiosd_server_reload(s))
+        goto out_fail_err_set;
+
+    error = _("Could not create the daemon socket.");
+    if (pipe2(s->stop_pipe, O_CLOEXEC | O_NONBLOCK))
+        goto out_fail_os;
+    s->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s->listen_fd < 0)
+        goto out_fail_os;
+
+    // the run directory may not exist yet. a stale socket from an earlier
+    // run is replaced, anything else is left alone and bind() fails
+    char dir[PATH_MAX];
+    strlcpy(dir, s->path, sizeof(dir));
+    char *slash = strrchr(dir, '/');
+    if (slash && slash != dir)
+    {
+        *slash = 0;
+        if (mkdir(dir, 0755) && errno != EEXIST)
+            goto out_fail_os;
+    }
+    if (!lstat(s->path, &st) && S_ISSOCK(st.st_mode))
+    {
+        // a running daemon still accepts (or has a full backlog)
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        bool live = probe >= 0 && (!connect(probe, (struct sockaddr *)&addr, sizeof(addr)) || errno == EAGAIN);
+        if (probe >= 0)
+            close(probe);
+        error = _("Another smbiosd daemon is already listening on the socket.");
+        if (live)
+            goto out_fail;
+        unlink(s->path);
+    }
+
+    error = _("Could not bind the daemon socket.");
+    if (bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr)))
+        goto out_fail_os;
+    s->bound = true;
+    // reads are what it is for, anyone may connect
+    if (chmod(s->path, 0666) || listen(s->listen_fd, LISTEN_BACKLOG))
+        goto out_fail_os;
+
+    fnprintf(" listening on %s\n", s->path);
+    return s;
+
+out_fail_os:
+    seterr_os(error);
+    goto out_fail_err_set;
+
+out_fail:
+    smbiosd_seterr(error);
+out_fail_err_set:
+    smbiosd_server_free(s);
+    return 0;
+}
+
+static u64 now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void drop_connection(struct smbiosd_server *s, size_t i)
+{
+    fnprintf(" fd %d\n", s->conn[i].fd);
+    close(s->conn[i].fd);
+    free(s->conn[i].out);
+    s->conn[i] = s->conn[--s->nconn];
+}
+
+static uid_t peer_uid(int fd)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len))
+        return (uid_t)-1;
+    return cred.uid;
+}
+
+static void accept_connection(struct smbiosd_server *s)
+{
+    size_t same_uid = 0;
+    int fd = accept4(s->listen_fd, 0, 0, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (fd < 0)
+        return;
+
+    uid_t uid = peer_uid(fd);
+    for (size_t i=0; i<s->nconn; ++i)
+        if (s->conn[i].uid == uid)
+            same_uid++;
+    if (s->nconn == MAX_CONNECTIONS || same_uid >= MAX_CONNECTIONS_UID)
+    {
+        fnprintf(" refused uid %d\n", (int)uid);
+        close(fd);
+        return;
+    }
+
+    struct connection *c = &s->conn[s->nconn++];
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    c->uid = uid;
+    c->deadline = now_ms() + CONNECTION_TIMEOUT * 1000;
+}
+
+// sends what the socket takes without blocking. returns bytes sent, < 0 on error
+static ssize_t send_some(int fd, const void *hdr, size_t hdr_len, const void *payload, size_t len)
+{
+    struct iovec iov[2] = { { (void *)hdr, hdr_len }, { (void *)payload, len } };
+    struct msghdr msg;
+    ssize_t n;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = len ? 2 : 1;
+    do {
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return 0;
+    return n;
+}
+
+// a reply is done: the next request gets a fresh deadline
+static int reply_sent(struct connection *c)
+{
+    free(c->out);
+    c->out = 0;
+    c->out_len = c->out_sent = 0;
+    c->have = 0;
+    c->deadline = now_ms() + CONNECTION_TIMEOUT * 1000;
+    return c->close_after ? -1 : 0;
+}
+
+// continue a reply the socket did not take at once
+static int flush_connection(struct connection *c)
+{
+    ssize_t n = send_some(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, 0, 0);
+    if (n < 0)
+        return -1;
+    c->out_sent += n;
+    if (c->out_sent < c->out_len)
+        return 0;
+    return reply_sent(c);
+}
+
+// a client that stops reading is not waited for: the rest of the reply is
+// kept and sent as the socket drains
+static int queue_reply(struct connection *c, const struct smbiosd_reply *reply, const void *payload, size_t len)
+{
+    size_t total = sizeof(*reply) + len;
+    ssize_t n = send_some(c->fd, reply, sizeof(*reply), payload, len);
+    if (n < 0)
+        return -1;
+    if ((size_t)n == total)
+        return reply_sent(c);
+
+    c->out = malloc(total - n);
+    if (!c->out)
+        return -1;
+    c->out_len = total - n;
+    c->out_sent = 0;
+
+    size_t skip = n, copied = 0;
+    if (skip < sizeof(*reply))
+    {
+        copied = sizeof(*reply) - skip;
+        memcpy(c->out, (const u8 *)reply + skip, copied);
+        skip = 0;
+    } else
+        skip -= sizeof(*reply);
+    memcpy(c->out + copied, (const u8 *)payload + skip, len - skip);
+    return 0;
+}
+
+// answers a complete request from the loaded copies
+static int answer(struct smbiosd_server *s, struct connection *c)
+{
+    const struct smbiosd_request *req = &c->req;
+    struct smbiosd_reply reply;
+    const void *payload = 0;
+    size_t len = 0;
+    s32 status = SMBIOSD_OK;
+
+    fnprintf(" op %d arg %d\n", req->op, req->arg);
+    bool in_sync = req->magic == SMBIOSD_MAGIC && req->version == SMBIOSD_PROTO_VERSION;
+    if (!in_sync)
+        status = SMBIOSD_E_BAD_REQUEST;
+    else switch (req->op)
+    {
+    case SMBIOSD_OP_PING:
+        break;
+    case SMBIOSD_OP_GET_TABLE:
+        payload = s->table;
+        len = s->table_len;
+        break;
+    case SMBIOSD_OP_GET_SNAPSHOT:
+        payload = s->snapshot;
+        len = s->snapshot_len;
+        break;
+    case SMBIOSD_OP_GET_TOKENS:
+        payload = s->tokens;
+        len = s->tokens_len;
+        break;
+    case SMBIOSD_OP_GET_TOKEN:
+        if (req->arg <= 0xFFFF)
+            payload = smbiosd_find_packed_token(s->tokens, s->tokens_len, req->arg, &len);
+        if (!payload)
+            status = SMBIOSD_E_NOT_FOUND;
+        break;
+    case SMBIOSD_OP_RELOAD:
+        if (c->uid != 0)
+            status = SMBIOSD_E_PERMISSION;
+        else if (smbiosd_server_reload(s))
+            status = SMBIOSD_E_UNAVAILABLE;
+        break;
+    default:
+        status = SMBIOSD_E_BAD_REQUEST;
+        break;
+    }
+    if (status != SMBIOSD_OK)
+        len = 0;
+
+    memset(&reply, 0, sizeof(reply));
+    reply.magic = SMBIOSD_MAGIC;
+    reply.version = SMBIOSD_PROTO_VERSION;
+    reply.op = req->op;
+    reply.status = status;
+    reply.length = len;
+    // after a bad header the byte stream cannot be trusted any more
+    c->close_after = !in_sync;
+    return queue_reply(c, &reply, payload, len);
+}
+
+// one read per wakeup, requests may arrive in pieces
+static int serve_connection(struct smbiosd_server *s, struct connection *c)
+{
+    ssize_t n = recv(c->fd, (u8 *)&c->req + c->have, sizeof(c->req) - c->have, MSG_DONTWAIT);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN))
+        return 0;
+    if (n <= 0)
+        return -1;
+    c->have += n;
+    if (c->have < sizeof(c->req))
+        return 0;
+    return answer(s, c);
+}
+
+LIBSMBIOS_C_DLL_SPEC int smbiosd_server_run(struct smbiosd_server *s)
+{
+    struct pollfd fds[2 + MAX_CONNECTIONS];
+    char drain[16];
+
+    fnprintf("\n");
+    smbiosd_clearerr();
+    if (!s)
+        return -1;
+
+    for (;;)
+    {
+        size_t nconn = s->nconn;
+        u64 now = now_ms();
+        int timeout = -1;
+
+        fds[0].fd = s->stop_pipe[0];
+        fds[1].fd = s->listen_fd;
+        fds[0].events = fds[1].events = POLLIN;
+        for (size_t i=0; i<nconn; ++i)
+        {
+            const struct connection *c = &s->conn[i];
+            fds[2 + i].fd = c->fd;
+            // one request at a time: no reading while a reply is pending
+            fds[2 + i].events = c->out ? POLLOUT : POLLIN;
+            u64 left = c->deadline > now ? c->deadline - now : 0;
+            if (timeout < 0 || left < (u64)timeout)
+                timeout = (int)left;
+        }
+        for (size_t i=0; i<2 + nconn; ++i)
+            fds[i].revents = 0;
+
+        if (poll(fds, 2 + nconn, timeout) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            seterr_os(_("Waiting for daemon clients failed."));
+            return -1;
+        }
+
+        if (fds[0].revents)
+        {
+            while (read(s->stop_pipe[0], drain, sizeof(drain)) > 0)
+                /* nothing */;
+            return 0;
+        }
+
+        // backwards, so dropping one only moves an already served entry
+        now = now_ms();
+        for (size_t i=nconn; i-- > 0;)
+        {
+            struct connection *c = &s->conn[i];
+            int ret = 0;
+            if (fds[2 + i].revents)
+                ret = c->out ? flush_connection(c) : serve_connection(s, c);
+            if (ret || now >= c->deadline)
+                drop_connection(s, i);
+        }
+
+        if (fds[1].revents & POLLIN)
+            accept_connection(s);
+    }
+}
+
+LIBSMBIOS_C_DLL_SPEC void smbiosd_server_stop(struct smbiosd_server *s)
+{
+    if (s && s->stop_pipe[1] >= 0)
+    {
+        ssize_t ret = write(s->stop_pipe[1], "x", 1);
+        (void)ret;  // a full pipe already has a stop pending
+    }
+}
+
+LIBSMBIOS_C_DLL_SPEC void smbiosd_server_free(struct smbiosd_server *s)
+{
+    fnprintf("\n");
+    if (!s)
+        return;
+
+    while (s->nconn)
+        drop_connection(s, s->nconn - 1);
+    if (s->listen_fd >= 0)
+        close(s->listen_fd);
+    if (s->bound)
+        unlink(s->path);
+    for (int i=0; i<2; ++i)
+        if (s->stop_pipe[i] >= 0)
+            close(s->stop_pipe[i]);
+
+    free(s->path);
+    free(s->table);
+    free(s->snapshot);
+    free(s->tokens);
+    memset(s, 0, sizeof(*s)); // big hammer
+    free(s);
+}
+
+
+/**************************************************
+ *
+ * client
+ *
+ **************************************************/
+
+struct smbiosd_client
+{
+    int fd;
+    struct sockaddr_un addr;
+
+    u8 *table;
+    size_t table_len;
+    struct smbios_table *table_obj;
+
+    struct smbiosd_token *tokens;
+    size_t ntokens;
+    struct smbiosd_token *token;    // last smbiosd_client_get_token() answer
+};
+
+static int client_connect(struct smbiosd_client *c)
+{
+    if (c->fd >= 0)
+        close(c->fd);
+    c->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c->fd < 0)
+        return -1;
+    if (connect(c->fd, (struct sockaddr *)&c->addr, sizeof(c->addr)))
+    {
+        int err = errno;
+        close(c->fd);
+        c->fd = -1;
+        errno = err;
+        return -1;
+    }
+    set_timeout(c->fd, SO_RCVTIMEO, CLIENT_TIMEOUT);
+    set_timeout(c->fd, SO_SNDTIMEO, CLIENT_TIMEOUT);
+    return 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC struct smbiosd_client *smbiosd_client_open(const char *path)
+{
+    const char *error = _("Failed to allocate memory for the daemon client.");
+    struct smbiosd_client *c;
+
+    fnprintf("\n");
+    smbiosd_clearerr();
+
+    c = calloc(1, sizeof(*c));
+    if (!c)
+        goto out_fail;
+    c->fd = -1;
+    if (fill_sockaddr(&c->addr, socket_path(path)))
+        goto out_fail_err_set;
+
+    error = _("Could not connect to the smbiosd daemon. Is it running?");
+    if (client_connect(c))
+        goto out_fail_os;
+    return c;
+
+out_fail_os:
+    seterr_os(error);
+    goto out_fail_err_set;
+
+out_fail:
+    smbiosd_seterr(error);
+out_fail_err_set:
+    smbiosd_client_close(c);
+    return 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC void smbiosd_client_close(struct smbiosd_client *c)
+{
+    fnprintf("\n");
+    if (!c)
+        return;
+    if (c->fd >= 0)
+        close(c->fd);
+    smbios_table_free(c->table_obj);
+    free(c->table);
+    free(c->tokens);
+    free(c->token);
+    memset(c, 0, sizeof(*c)); // big hammer
+    free(c);
+}
+
+// one request and its reply. *payload is malloc()ed, and never 0 on success
+static int transact(struct smbiosd_client *c, u16 op, u32 arg, u8 **payload, size_t *len)
+{
+    const char *error = _("Lost the connection to the smbiosd daemon.");
+    struct smbiosd_request req;
+    struct smbiosd_reply reply;
+
+    smbiosd_clearerr();
+    if (payload)
+        *payload = 0;
+    if (!c || c->fd < 0)
+        goto out_fail;
+
+    memset(&req, 0, sizeof(req));
+    req.magic = SMBIOSD_MAGIC;
+    req.version = SMBIOSD_PROTO_VERSION;
+    req.op = op;
+    req.arg = arg;
+    int ret = send_all(c->fd, &req, sizeof(req), 0, 0) || recv_all(c->fd, &reply, sizeof(reply));
+    // the daemon drops connections that sit idle: connect again, once
+    if (ret && (errno == EPIPE || errno == ECONNRESET) && !client_connect(c))
+        ret = send_all(c->fd, &req, sizeof(req), 0, 0) || recv_all(c->fd, &reply, sizeof(reply));
+    if (ret)
+        goto out_fail_os;
+
+    error = _("Invalid reply from the smbiosd daemon.");
+    if (reply.magic != SMBIOSD_MAGIC || reply.version != SMBIOSD_PROTO_VERSION
+            || reply.op != op || reply.length > SMBIOSD_MAX_PAYLOAD)
+        goto out_fail_close;
+
+    u8 *buf = malloc(reply.length + 1);
+    if (!buf || recv_all(c->fd, buf, reply.length))
+    {
+        free(buf);
+        goto out_fail_close;
+    }
+
+    switch (reply.status)
+    {
+    case SMBIOSD_OK:
+        break;
+    case SMBIOSD_E_NOT_FOUND:
+        smbiosd_seterr(_("The smbiosd daemon has no such item."));
+        break;
+    case SMBIOSD_E_PERMISSION:
+        smbiosd_seterr(_("Only root may ask the smbiosd daemon to reload."));
+        break;
+    case SMBIOSD_E_UNAVAILABLE:
+        smbiosd_seterr(_("The smbiosd daemon could not read the data."));
+        break;
+    default:
+        smbiosd_seterr(_("The smbiosd daemon did not understand the request."));
+        break;
+    }
+    if (reply.status != SMBIOSD_OK || !payload)
+    {
+        free(buf);
+        return reply.status;
+    }
+
+    *payload = buf;
+    *len = reply.length;
+    return 0;
+
+out_fail_os:
+    seterr_os(error);
+    goto out_close;
+out_fail_close:
+    smbiosd_seterr(error);
+out_close:
+    // the stream is out of step, later requests fail right away
+    close(c->fd);
+    c->fd = -1;
+    return SMBIOSD_E_UNAVAILABLE;
+out_fail:
+    smbiosd_seterr(error);
+    return SMBIOSD_E_UNAVAILABLE;
+}
+
+LIBSMBIOS_C_DLL_SPEC int smbiosd_client_ping(struct smbiosd_client *c)
+{
+    fnprintf("\n");
+    return transact(c, SMBIOSD_OP_PING, 0, 0, 0);
+}
+
+LIBSMBIOS_C_DLL_SPEC const void *smbiosd_client_get_table_buffer(struct smbiosd_client *c, size_t *len)
+{
+    fnprintf("\n");
+    *len = 0;
+    if (!c || (!c->table && transact(c, SMBIOSD_OP_GET_TABLE, 0, &c->table, &c->table_len)))
+        return 0;
+    *len = c->table_len;
+    return c->table;
+}
+
+LIBSMBIOS_C_DLL_SPEC struct smbios_table *smbiosd_client_get_table(struct smbiosd_client *c)
+{
+    size_t len;
+    fnprintf("\n");
+    if (c && !c->table_obj)
+    {
+        const void *buf = smbiosd_client_get_table_buffer(c, &len);
+        if (buf)
+            c->table_obj = smbios_table_factory(SMBIOS_GET_NEW | SMBIOS_FROM_BUFFER, buf, len);
+    }
+    return c ? c->table_obj : 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC struct sysinfo_snapshot *smbiosd_client_get_snapshot(struct smbiosd_client *c)
+{
+    struct sysinfo_snapshot *snap = 0;
+    u8 *payload;
+    size_t len;
+
+    fnprintf("\n");
+    if (transact(c, SMBIOSD_OP_GET_SNAPSHOT, 0, &payload, &len))
+        return 0;
+    snap = smbiosd_unpack_snapshot(payload, len);
+    if (!snap)
+        smbiosd_seterr(_("Invalid reply from the smbiosd daemon."));
+    free(payload);
+    return snap;
+}
+
+LIBSMBIOS_C_DLL_SPEC size_t smbiosd_client_get_tokens(struct smbiosd_client *c, const struct smbiosd_token **tokens)
+{
+    u8 *payload;
+    size_t len;
+
+    fnprintf("\n");
+    *tokens = 0;
+    if (c && !c->tokens)
+    {
+        if (transact(c, SMBIOSD_OP_GET_TOKENS, 0, &payload, &len))
+            return 0;
+        c->tokens = smbiosd_unpack_tokens(payload, len, true, &c->ntokens);
+        free(payload);
+        if (!c->tokens)
+            smbiosd_seterr(_("Invalid reply from the smbiosd daemon."));
+    }
+    if (!c || !c->tokens)
+        return 0;
+    *tokens = c->tokens;
+    return c->ntokens;
+}
+
+LIBSMBIOS_C_DLL_SPEC const struct smbiosd_token *smbiosd_client_get_token(struct smbiosd_client *c, u16 id)
+{
+    u8 *payload;
+    size_t len, count;
+
+    fnprintf(" id 0x%04x\n", id);
+    if (!c)
+        return 0;
+    if (c->tokens)
+    {
+        for (size_t i=0; i<c->ntokens; ++i)
+            if (c->tokens[i].id == id)
+                return &c->tokens[i];
+        smbiosd_seterr(_("The smbiosd daemon has no such item."));
+        return 0;
+    }
+
+    free(c->token);
+    c->token = 0;
+    if (transact(c, SMBIOSD_OP_GET_TOKEN, id, &payload, &len))
+        return 0;
+    c->token = smbiosd_unpack_tokens(payload, len, false, &count);
+    free(payload);
+    if (!c->token)
+        smbiosd_seterr(_("Invalid reply from the smbiosd daemon."));
+    return c->token;
+}
+
+LIBSMBIOS_C_DLL_SPEC int smbiosd_client_reload(struct smbiosd_client *c)
+{
+    fnprintf("\n");
+    int ret = transact(c, SMBIOSD_OP_RELOAD, 0, 0, 0);
+    if (!ret)
+    {
+        free(c->tokens);
+        c->tokens = 0;
+        c->ntokens = 0;
+    }
+    return ret;
+}
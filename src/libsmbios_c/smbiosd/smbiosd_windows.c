@@ -0,0 +1,112 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+#include "smbios_c/compat.h"
+
+#include "smbios_c/smbiosd.h"
+#include "smbios_c/types.h"
+#include "smbiosd_impl.h"
+#include "libsmbios_c_intlize.h"
+
+// no unix sockets here: no daemon and no client
+
+static void not_supported()
+{
+    smbiosd_seterr(_("smbiosd is not supported on this platform."));
+}
+
+LIBSMBIOS_C_DLL_SPEC struct smbiosd_server *smbiosd_server_create(const char *path)
+{
+    not_supported();
+    return 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC int smbiosd_server_run(struct smbiosd_server *s)
+{
+    not_supported();
+    return -1;
+}
+
+LIBSMBIOS_C_DLL_SPEC int smbiosd_server_reload(struct smbiosd_server *s)
+{
+    not_supported();
+    return -1;
+}
+
+LIBSMBIOS_C_DLL_SPEC void smbiosd_server_stop(struct smbiosd_server *s)
+{
+}
+
+LIBSMBIOS_C_DLL_SPEC void smbiosd_server_free(struct smbiosd_server *s)
+{
+}
+
+LIBSMBIOS_C_DLL_SPEC struct smbiosd_client *smbiosd_client_open(const char *path)
+{
+    not_supported();
+    return 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC void smbiosd_client_close(struct smbiosd_client *c)
+{
+}
+
+LIBSMBIOS_C_DLL_SPEC int smbiosd_client_ping(struct smbiosd_client *c)
+{
+    not_supported();
+    return -1;
+}
+
+LIBSMBIOS_C_DLL_SPEC const void *smbiosd_client_get_table_buffer(struct smbiosd_client *c, size_t *len)
+{
+    not_supported();
+    *len = 0;
+    return 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC struct smbios_table *smbiosd_client_get_table(struct smbiosd_client *c)
+{
+    not_supported();
+    return 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC struct sysinfo_snapshot *smbiosd_client_get_snapshot(struct smbiosd_client *c)
+{
+    not_supported();
+    return 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC size_t smbiosd_client_get_tokens(struct smbiosd_client *c, const struct smbiosd_token **tokens)
+{
+    not_supported();
+    *tokens = 0;
+    return 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC const struct smbiosd_token *smbiosd_client_get_token(struct smbiosd_client *c, u16 id)
+{
+    not_supported();
+    return 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC int smbiosd_client_reload(struct smbiosd_client *c)
+{
+    not_supported();
+    return -1;
+}
@@ -33,7 +33,7 @@
 const char *dell_smi_strerror()
 {
     fnprintf("\n");
-    struct dell_smi_obj *smi = dell_smi_factory(DELL_SMI_DEFAULTS | DELL_SMI_NO_ERR_CLEAR);
+    struct dell_smi_obj *smi = dell_smi_factory(DELL_SMI_GET_PER_THREAD | DELL_SMI_NO_ERR_CLEAR);
     const char *retval = dell_smi_obj_strerror(smi);
     dell_smi_obj_free(smi);
     return retval;
@@ -73,6 +73,48 @@ out:
     return retval;
 }
 
+int dell_adv_ci_smi(u16 smiClass, u16 select, const u32 args[4], u32 res[4], u8 *buffer[4], const size_t buffer_size[4])
+{
+    int retval = -1;
+    fnprintf("\n");
+    struct dell_smi_obj *smi = dell_smi_factory(DELL_SMI_DEFAULTS);
+    if(!smi)
+        goto out;
+
+    dell_smi_obj_set_class(smi, smiClass);
+    dell_smi_obj_set_select(smi, select);
+    for (int i=0; i<4; i++)
+        if (buffer && buffer[i])
+            dell_smi_obj_set_buffer(smi, i, buffer[i], buffer_size[i]);
+        else
+            dell_smi_obj_set_arg(smi, i, args[i]);
+
+    retval = dell_smi_obj_execute(smi);
+
+    for (int i=0; i<4; i++)
+        res[i] = dell_smi_obj_get_res(smi, i);
+
+    // dont leave the shared object pointing at caller memory
+    for (int i=0; i<4; i++)
+        dell_smi_obj_set_arg(smi, i, 0);
+
+out:
+    dell_smi_obj_free(smi);
+    fnprintf("return retval: %d\n", retval);
+    return retval;
+}
+
+int dell_smi_batch(struct dell_smi_request *reqs, size_t count)
+{
+    int retval = -1;
+    fnprintf("\n");
+    struct dell_smi_obj *smi = dell_smi_factory(DELL_SMI_DEFAULTS);
+    if(smi)
+        retval = dell_smi_obj_execute_batch(smi, reqs, count);
+    dell_smi_obj_free(smi);
+    return retval;
+}
+
 static int read_setting(u16 select, u32 location, u32 *curValue, u32 *minValue, u32 *maxValue)
 {
     u32 args[4] = {location, 0,}, res[4] = {0,};
@@ -132,5 +174,32 @@ int dell_smi_write_ac_mode_setting     (u16 security_key, u32 location, u32 valu
     return write_setting(security_key, 2, location, value, smiret);
 }
 
+static int write_setting_security(struct dell_smi_security *sec, u16 select, u32 location, u32 value, u32 *smiret)
+{
+    u16 security_key = 0;
+    int retval = dell_smi_security_get_key(sec, &security_key);
+    if (retval)
+        return retval;
+    return write_setting(security_key, select, location, value, smiret);
+}
+
+int dell_smi_security_write_nv_storage         (struct dell_smi_security *sec, u32 location, u32 value, u32 *smiret)
+{
+    fnprintf("location(0x%04x)  value(0x%04x)\n", location, value);
+    return write_setting_security(sec, 0, location, value, smiret);
+}
+
+int dell_smi_security_write_battery_mode_setting(struct dell_smi_security *sec, u32 location, u32 value, u32 *smiret)
+{
+    fnprintf("location(0x%04x)  value(0x%04x)\n", location, value);
+    return write_setting_security(sec, 1, location, value, smiret);
+}
+
+int dell_smi_security_write_ac_mode_setting     (struct dell_smi_security *sec, u32 location, u32 value, u32 *smiret)
+{
+    fnprintf("location(0x%04x)  value(0x%04x)\n", location, value);
+    return write_setting_security(sec, 2, location, value, smiret);
+}
+
 
 
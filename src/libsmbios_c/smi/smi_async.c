@@ -0,0 +1,267 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+
+// Include compat.h first, then system headers, then public, then private
+#include "smbios_c/compat.h"
+
+// system
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// public
+#include "smbios_c/obj/smi.h"
+#include "smbios_c/types.h"
+#include "libsmbios_c_intlize.h"
+#include "internal_strl.h"
+#include "common_internal.h"
+
+// private
+#include "smi_impl.h"
+
+struct async_node
+{
+    struct dell_smi_request *req;
+    dell_smi_async_fn fn;
+    void *userdata;
+    struct async_node *next;
+};
+
+struct node_list
+{
+    struct async_node *head;
+    struct async_node *tail;
+};
+
+struct dell_smi_async
+{
+    struct dell_smi_obj *smi;
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    struct node_list pending;
+    struct node_list done;
+    int efd;        // counts completions not yet collected
+    bool stop;
+};
+
+static void list_append(struct node_list *l, struct async_node *n)
+{
+    n->next = 0;
+    if (l->tail)
+        l->tail->next = n;
+    else
+        l->head = n;
+    l->tail = n;
+}
+
+static struct async_node *list_pop(struct node_list *l)
+{
+    struct async_node *n = l->head;
+    if (n)
+    {
+        l->head = n->next;
+        if (!l->head)
+            l->tail = 0;
+    }
+    return n;
+}
+
+static void list_free(struct node_list *l)
+{
+    struct async_node *n;
+    while ((n = list_pop(l)))
+        free(n);
+}
+
+static void *worker_main(void *arg)
+{
+    struct dell_smi_async *a = (struct dell_smi_async *)arg;
+    const u64 one = 1;
+
+    pthread_mutex_lock(&a->lock);
+    for (;;)
+    {
+        struct async_node *n = list_pop(&a->pending);
+        if (!n)
+        {
+            // drain everything already queued before honouring stop
+            if (a->stop)
+                break;
+            pthread_cond_wait(&a->wake, &a->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&a->lock);
+
+        // one-entry batch: loads the request and takes the backend lock
+        // (flock on dcdbas) exactly as a synchronous caller would
+        fnprintf(" class %d select %d\n", n->req->smi_class, n->req->select);
+        dell_smi_obj_execute_batch(a->smi, n->req, 1);
+
+        pthread_mutex_lock(&a->lock);
+        list_append(&a->done, n);
+        if (write(a->efd, &one, sizeof(one)) != sizeof(one))
+            fnprintf(" eventfd write failed\n");
+    }
+    pthread_mutex_unlock(&a->lock);
+    return 0;
+}
+
+struct dell_smi_async *dell_smi_async_new(struct dell_smi_obj *smi)
+{
+    struct dell_smi_async *a = 0;
+    int err;
+    fnprintf("\n");
+
+    if (!smi)
+        goto out;
+
+    // the worker drives 'smi' from its own thread. Library-owned objects are
+    // also used by every other call made on the caller's thread, and a
+    // per-thread one is freed when that thread exits.
+    if (smi_obj_is_shared(smi))
+        goto err_shared;
+
+    a = calloc(1, sizeof(struct dell_smi_async));
+    if (!a)
+        goto err_nomem;
+
+    a->smi = smi;
+    a->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (a->efd < 0)
+        goto err_free;
+
+    pthread_mutex_init(&a->lock, 0);
+    pthread_cond_init(&a->wake, 0);
+    // pthread_create() returns its error rather than setting errno
+    err = pthread_create(&a->worker, 0, worker_main, a);
+    if (err)
+        goto err_close;
+    goto out;
+
+err_shared:
+    strlcpy(smi->errstring, _("The asynchronous smi worker needs an object of its own (DELL_SMI_GET_NEW)."), ERROR_BUFSIZE);
+    goto out;
+
+err_close:
+    pthread_cond_destroy(&a->wake);
+    pthread_mutex_destroy(&a->lock);
+    close(a->efd);
+    errno = err;
+err_free:
+    free(a);
+    a = 0;
+err_nomem:
+    strlcpy(smi->errstring, _("Could not start the asynchronous smi worker.\nThe OS Error string was: "), ERROR_BUFSIZE);
+    fixed_strerror(errno, smi->errstring, ERROR_BUFSIZE);
+out:
+    return a;
+}
+
+void dell_smi_async_free(struct dell_smi_async *a)
+{
+    fnprintf("\n");
+    if (!a)
+        return;
+
+    pthread_mutex_lock(&a->lock);
+    a->stop = true;
+    pthread_cond_signal(&a->wake);
+    pthread_mutex_unlock(&a->lock);
+    pthread_join(a->worker, 0);
+
+    list_free(&a->pending);
+    list_free(&a->done);
+    pthread_cond_destroy(&a->wake);
+    pthread_mutex_destroy(&a->lock);
+    close(a->efd);
+    free(a);
+}
+
+int dell_smi_async_submit(struct dell_smi_async *a, struct dell_smi_request *req, dell_smi_async_fn fn, void *userdata)
+{
+    struct async_node *n = 0;
+    fnprintf("\n");
+
+    if (!a || !req)
+        return -1;
+
+    n = calloc(1, sizeof(struct async_node));
+    if (!n)
+        return -1;
+
+    n->req = req;
+    n->fn = fn;
+    n->userdata = userdata;
+    req->retval = -3; // not handled yet
+
+    pthread_mutex_lock(&a->lock);
+    list_append(&a->pending, n);
+    pthread_cond_signal(&a->wake);
+    pthread_mutex_unlock(&a->lock);
+    return 0;
+}
+
+int dell_smi_async_fd(const struct dell_smi_async *a)
+{
+    return a ? a->efd : -1;
+}
+
+int dell_smi_async_complete(struct dell_smi_async *a, int timeout_ms)
+{
+    struct node_list done;
+    struct async_node *n;
+    u64 count;
+    int completed = 0;
+
+    if (!a)
+        return -1;
+
+    if (timeout_ms != 0)
+    {
+        struct pollfd p = { .fd = a->efd, .events = POLLIN };
+        if (poll(&p, 1, timeout_ms) < 0 && errno != EINTR)
+            return -1;
+    }
+
+    // reset the counter first so a completion racing with us re-arms it
+    if (read(a->efd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        return -1;
+
+    pthread_mutex_lock(&a->lock);
+    done = a->done;
+    a->done.head = a->done.tail = 0;
+    pthread_mutex_unlock(&a->lock);
+
+    // callbacks run in the caller's thread, in submission order
+    while ((n = list_pop(&done)))
+    {
+        if (n->fn)
+            n->fn(n->req, n->userdata);
+        free(n);
+        completed++;
+    }
+    return completed;
+}
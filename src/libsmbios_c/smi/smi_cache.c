@@ -0,0 +1,232 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+
+// Include compat.h first, then system headers, then public, then private
+#include "smbios_c/compat.h"
+
+// system
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// public
+#include "smbios_c/obj/smi.h"
+#include "smbios_c/types.h"
+
+// private
+#include "smi_impl.h"
+
+#define SMI_CACHE_ENTRIES  32
+#define SMI_CACHE_POLICIES 32
+
+struct smi_cache_policy
+{
+    u16 smi_class;
+    u16 smi_select;
+    u32 ttl_ms;     // 0: read-only, but not cached
+    bool match_arg0;
+    u32 arg0;       // with match_arg0: only this cbARG1 sub-function is read-only
+};
+
+struct smi_cache_entry
+{
+    u16 smi_class;
+    u16 smi_select;
+    u32 arg[4];
+    u32 res[4];
+    u64 expires;    // monotonic ns, 0 == empty slot
+};
+
+struct smi_cache
+{
+    struct smi_cache_policy policy[SMI_CACHE_POLICIES];
+    int num_policies;
+    struct smi_cache_entry entry[SMI_CACHE_ENTRIES];
+    int next_victim;
+};
+
+// read-only selectors cached by default. Anything not listed here is
+// assumed to change state and flushes the cache when it runs.
+static const struct smi_cache_policy default_policy[] = {
+    { 0, 0, 1000 },     // token read: nv storage
+    { 0, 1, 1000 },     //             battery mode
+    { 0, 2, 1000 },     //             ac mode
+    { 4, 11, 60000, true, 0 },  // keyboard backlight capability. other
+                                //   sub-functions get or set the state
+    { 9, 0, 5000 },     // user password installed
+    { 9, 3, 5000 },     //               properties
+    { 10, 0, 5000 },    // admin password installed
+    { 10, 3, 5000 },    //                properties
+    { 11, 0, 60000 },   // asset tag read
+    { 11, 2, 60000 },   // service tag read
+    { 12, 0, 5000 },    // owner password installed
+    { 12, 3, 5000 },    //                properties
+};
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static struct smi_cache_policy *find_policy(struct smi_cache *c, u16 smi_class, u16 smi_select)
+{
+    for (int i=0; i<c->num_policies; i++)
+        if (c->policy[i].smi_class == smi_class && c->policy[i].smi_select == smi_select)
+            return &c->policy[i];
+    return 0;
+}
+
+// policy covering this request, if any
+static struct smi_cache_policy *match_policy(struct smi_cache *c, const struct smi_cmd_buffer *b)
+{
+    struct smi_cache_policy *p = find_policy(c, b->smi_class, b->smi_select);
+    if (p && p->match_arg0 && p->arg0 != b->arg[0])
+        return 0;
+    return p;
+}
+
+// buffer arguments are passed by address, so only plain args are cacheable
+static bool has_buffers(const struct dell_smi_obj *this)
+{
+    for (int i=0; i<4; i++)
+        if (this->physical_buffer[i])
+            return true;
+    return false;
+}
+
+static struct smi_cache_entry *find_entry(struct smi_cache *c, const struct smi_cmd_buffer *b)
+{
+    for (int i=0; i<SMI_CACHE_ENTRIES; i++)
+    {
+        struct smi_cache_entry *e = &c->entry[i];
+        if (e->expires && e->smi_class == b->smi_class && e->smi_select == b->smi_select
+                && !memcmp(e->arg, b->arg, sizeof(e->arg)))
+            return e;
+    }
+    return 0;
+}
+
+int dell_smi_obj_cache_enable(struct dell_smi_obj *this, bool enable)
+{
+    fnprintf(" %d\n", enable);
+    if (!this)
+        return -1;
+
+    if (!enable)
+    {
+        free(this->cache);
+        this->cache = 0;
+        return 0;
+    }
+
+    if (this->cache)
+        return 0;
+
+    this->cache = calloc(1, sizeof(struct smi_cache));
+    if (!this->cache)
+        return -1;
+
+    memcpy(this->cache->policy, default_policy, sizeof(default_policy));
+    this->cache->num_policies = sizeof(default_policy) / sizeof(default_policy[0]);
+    return 0;
+}
+
+int dell_smi_obj_cache_set_ttl(struct dell_smi_obj *this, u16 smi_class, u16 smi_select, u32 ttl_ms)
+{
+    struct smi_cache_policy *p;
+    fnprintf(" %d/%d %d ms\n", smi_class, smi_select, ttl_ms);
+
+    if (dell_smi_obj_cache_enable(this, true))
+        return -1;
+
+    p = find_policy(this->cache, smi_class, smi_select);
+    if (!p)
+    {
+        if (this->cache->num_policies >= SMI_CACHE_POLICIES)
+            return -1;
+        p = &this->cache->policy[this->cache->num_policies++];
+        p->smi_class = smi_class;
+        p->smi_select = smi_select;
+    }
+    p->ttl_ms = ttl_ms;
+    dell_smi_obj_cache_invalidate(this);
+    return 0;
+}
+
+void dell_smi_obj_cache_invalidate(struct dell_smi_obj *this)
+{
+    fnprintf("\n");
+    if (this && this->cache)
+        memset(this->cache->entry, 0, sizeof(this->cache->entry));
+}
+
+bool __hidden smi_cache_lookup(struct dell_smi_obj *this)
+{
+    struct smi_cache_entry *e;
+
+    if (has_buffers(this))
+        return false;
+
+    e = find_entry(this->cache, &this->smi_buf);
+    if (!e)
+        return false;
+
+    if (now_ns() >= e->expires)
+    {
+        e->expires = 0;
+        return false;
+    }
+
+    fnprintf(" hit %d/%d\n", e->smi_class, e->smi_select);
+    memcpy(this->smi_buf.res, e->res, sizeof(e->res));
+    return true;
+}
+
+// 'request' is smi_buf as it was before execute(): the BIOS may rewrite args
+void __hidden smi_cache_update(struct dell_smi_obj *this, const struct smi_cmd_buffer *request, int retval)
+{
+    struct smi_cache *c = this->cache;
+    struct smi_cache_policy *p = match_policy(c, request);
+    struct smi_cache_entry *e;
+
+    if (!p)
+    {
+        dell_smi_obj_cache_invalidate(this);
+        return;
+    }
+
+    if (!p->ttl_ms || retval || has_buffers(this))
+        return;
+
+    e = find_entry(c, request);
+    if (!e)
+    {
+        e = &c->entry[c->next_victim];
+        c->next_victim = (c->next_victim + 1) % SMI_CACHE_ENTRIES;
+    }
+
+    e->smi_class = request->smi_class;
+    e->smi_select = request->smi_select;
+    memcpy(e->arg, request->arg, sizeof(e->arg));
+    memcpy(e->res, this->smi_buf.res, sizeof(e->res));
+    e->expires = now_ns() + (u64)p->ttl_ms * 1000000ULL;
+}
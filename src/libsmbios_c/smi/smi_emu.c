@@ -0,0 +1,449 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+
+// Include compat.h first, then system headers, then public, then private
+#include "smbios_c/compat.h"
+
+// system
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>    // offsetof
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// public
+#include "smbios_c/obj/smi.h"
+#include "smbios_c/types.h"
+#include "libsmbios_c_intlize.h"
+#include "internal_strl.h"
+
+// kernel
+#include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,15,0)
+#include <linux/wmi.h>
+#else
+#include "wmi.h"
+#endif
+
+// private
+#include "smi_impl.h"
+
+/*
+ * Firmware emulator.
+ *
+ * A real dcdbas write to smi_request only returns once the BIOS has run, and
+ * a regular file cannot block the writer like that. So instead of watching
+ * the files from another thread, the responder runs from the backend at the
+ * point where the kernel would run the SMI: the dcdbas backend calls it right
+ * after the trigger write and it answers through the smi_data file; the wmi
+ * backend calls it in place of the ioctl. Everything else (open, flock,
+ * buffer size and address files, buffer layout) is the real backend code.
+ */
+
+#define EMU_PHYS_ADDR   0x7f000000
+#define EMU_WMI_LENGTH  32768
+
+struct emu_selector
+{
+    u16 smi_class;
+    u16 select;
+    bool programmed;
+    u32 res[4];
+    u8 argno;
+    u8 *data;           // copied into the argno buffer, optional
+    size_t data_size;
+    u64 count;
+    struct emu_selector *next;
+};
+
+struct dell_smi_emu
+{
+    int interface;
+    char *basedir;      // with trailing '/', as set_basedir() wants it
+    char *data_path;
+    char *wmi_path;
+    const char *saved_basedir;
+    const char *saved_wmi_char;
+    unsigned int latency_us;
+    pthread_mutex_t lock;
+    struct emu_selector *selectors;
+    u64 total;
+    bool have_last;
+    struct smi_cmd_buffer last;
+};
+
+static struct dell_smi_emu *active;
+
+static char *join_path(const char *dir, const char *name)
+{
+    size_t len = strlen(dir) + strlen(name) + 1;
+    char *path = calloc(1, len);
+    if (path)
+        snprintf(path, len, "%s%s", dir, name);
+    return path;
+}
+
+static int write_file(const char *dir, const char *name, const void *data, size_t len)
+{
+    int retval = -1;
+    char *path = join_path(dir, name);
+    if (!path)
+        goto out;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        goto out;
+    if (write(fd, data, len) == (ssize_t)len)
+        retval = 0;
+    close(fd);
+
+out:
+    free(path);
+    return retval;
+}
+
+static struct emu_selector *find_selector(struct dell_smi_emu *emu, u16 smi_class, u16 select, bool create)
+{
+    struct emu_selector *s;
+    for (s = emu->selectors; s; s = s->next)
+        if (s->smi_class == smi_class && s->select == select)
+            return s;
+
+    if (!create)
+        return 0;
+
+    s = calloc(1, sizeof(struct emu_selector));
+    if (s)
+    {
+        s->smi_class = smi_class;
+        s->select = select;
+        s->next = emu->selectors;
+        emu->selectors = s;
+    }
+    return s;
+}
+
+// fill in cmd->res and any output buffer. Argument buffers are found at
+// cmd->arg[n] - bias within base[0..len).
+static void respond(struct dell_smi_emu *emu, struct smi_cmd_buffer *cmd, u8 *base, size_t len, u32 bias)
+{
+    unsigned int latency;
+
+    pthread_mutex_lock(&emu->lock);
+    fnprintf(" %d/%d\n", cmd->smi_class, cmd->smi_select);
+    emu->total++;
+    emu->last = *cmd;
+    emu->have_last = true;
+
+    struct emu_selector *s = find_selector(emu, cmd->smi_class, cmd->smi_select, true);
+    if (s)
+        s->count++;
+
+    memset(cmd->res, 0, sizeof(cmd->res));
+    if (!s || !s->programmed)
+        cmd->cbRES1 = -2;  // not supported
+    else
+    {
+        memcpy(cmd->res, s->res, sizeof(cmd->res));
+        u32 offset = cmd->arg[s->argno] - bias;
+        if (s->data && offset < len)
+        {
+            size_t n = s->data_size;
+            if (n > len - offset)
+                n = len - offset;
+            memcpy(base + offset, s->data, n);
+        }
+    }
+    latency = emu->latency_us;
+    pthread_mutex_unlock(&emu->lock);
+
+    if (latency)
+        usleep(latency);
+}
+
+static int emu_dcdbas_request(void)
+{
+    struct dell_smi_emu *emu = active;
+    struct smi_cmd_buffer cmd;
+    struct stat st;
+    u8 *buf = 0;
+    int retval = -1;
+    int fd = -1;
+
+    if (!emu)
+        goto out;
+
+    fd = open(emu->data_path, O_RDWR | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) < 0)
+        goto out;
+
+    errno = EIO;
+    if ((size_t)st.st_size < sizeof(struct callintf_cmd) + sizeof(cmd))
+        goto out;
+
+    buf = malloc(st.st_size);
+    if (!buf || pread(fd, buf, st.st_size, 0) != st.st_size)
+        goto out;
+
+    errno = EIO;
+    struct callintf_cmd *hdr = (struct callintf_cmd *)buf;
+    if (hdr->magic != KERNEL_SMI_MAGIC_NUMBER)
+        goto out;
+
+    memcpy(&cmd, hdr->command_buffer_start, sizeof(cmd));
+    respond(emu, &cmd, buf, st.st_size, EMU_PHYS_ADDR);
+    memcpy(hdr->command_buffer_start, &cmd, sizeof(cmd));
+
+    if (pwrite(fd, buf, st.st_size, 0) == st.st_size)
+        retval = 0;
+
+out:
+    if (fd >= 0)
+        close(fd);
+    free(buf);
+    return retval;
+}
+
+static int emu_wmi_request(void *wmi_buf)
+{
+    struct dell_wmi_smbios_buffer *buf = wmi_buf;
+    struct dell_smi_emu *emu = active;
+    struct smi_cmd_buffer cmd;
+
+    if (!emu)
+        return -EINVAL;
+
+    // argument buffer offsets are relative to the std block
+    memcpy(&cmd, &buf->std, sizeof(cmd));
+    respond(emu, &cmd, (u8 *)&buf->std, buf->length - offsetof(struct dell_wmi_smbios_buffer, std), 0);
+    memcpy(&buf->std, &cmd, sizeof(cmd));
+    return 0;
+}
+
+struct dell_smi_emu *dell_smi_emu_new(const char *dir, int interface)
+{
+    struct dell_smi_emu *emu = 0;
+    const char *error = _("Another SMI emulator is already active.");
+    char addr[32];
+    fnprintf("\n");
+
+    if (active)
+        goto out_fail;
+
+    error = _("Failed to allocate memory for the SMI emulator.");
+    emu = calloc(1, sizeof(struct dell_smi_emu));
+    if (!emu || !dir)
+        goto out_fail;
+
+    emu->interface = interface;
+    size_t len = strlen(dir);
+    emu->basedir = calloc(1, len + 2);
+    if (!emu->basedir)
+        goto out_fail;
+    strcpy(emu->basedir, dir);
+    if (len == 0 || dir[len-1] != '/')
+        emu->basedir[len] = '/';
+
+    emu->data_path = join_path(emu->basedir, "smi_data");
+    emu->wmi_path = join_path(emu->basedir, "dell-smbios");
+    if (!emu->data_path || !emu->wmi_path)
+        goto out_fail;
+
+    error = _("Could not create the emulated kernel interface files.");
+    snprintf(addr, sizeof(addr), "0x%08x\n", EMU_PHYS_ADDR);
+    if (write_file(emu->basedir, "smi_request", "", 0)
+            || write_file(emu->basedir, "smi_data", "", 0)
+            || write_file(emu->basedir, "smi_data_buf_size", "0\n", 2)
+            || write_file(emu->basedir, "smi_data_buf_phys_addr", addr, strlen(addr)))
+        goto out_fail;
+
+    if (interface == DELL_SMI_EMU_WMI)
+    {
+        u64 length = EMU_WMI_LENGTH;
+        if (write_file(emu->basedir, "dell-smbios", &length, sizeof(length)))
+            goto out_fail;
+    }
+    else
+        unlink(emu->wmi_path);  // a stale one would make objects pick wmi
+
+    pthread_mutex_init(&emu->lock, 0);
+    emu->saved_basedir = sysfs_basedir;
+    emu->saved_wmi_char = wmi_char;
+    set_basedir(emu->basedir);
+    wmi_char = emu->wmi_path;
+    smi_emu_dcdbas_hook = emu_dcdbas_request;
+    smi_emu_wmi_hook = emu_wmi_request;
+    active = emu;
+    goto out;
+
+out_fail:
+    {
+        char *errbuf = smi_get_module_error_buf();
+        if (errbuf)
+            strlcpy(errbuf, error, ERROR_BUFSIZE);
+    }
+    if (emu)
+    {
+        free(emu->basedir);
+        free(emu->data_path);
+        free(emu->wmi_path);
+        free(emu);
+    }
+    emu = 0;
+
+out:
+    return emu;
+}
+
+void dell_smi_emu_free(struct dell_smi_emu *emu)
+{
+    fnprintf("\n");
+    if (!emu)
+        return;
+
+    if (active == emu)
+    {
+        smi_emu_dcdbas_hook = 0;
+        smi_emu_wmi_hook = 0;
+        set_basedir(emu->saved_basedir);
+        wmi_char = emu->saved_wmi_char;
+        active = 0;
+    }
+
+    while (emu->selectors)
+    {
+        struct emu_selector *next = emu->selectors->next;
+        free(emu->selectors->data);
+        free(emu->selectors);
+        emu->selectors = next;
+    }
+    pthread_mutex_destroy(&emu->lock);
+    free(emu->basedir);
+    free(emu->data_path);
+    free(emu->wmi_path);
+    free(emu);
+}
+
+int dell_smi_emu_set_result(struct dell_smi_emu *emu, u16 smi_class, u16 select, const u32 res[4])
+{
+    int retval = -1;
+    if (!emu || !res)
+        return retval;
+
+    pthread_mutex_lock(&emu->lock);
+    struct emu_selector *s = find_selector(emu, smi_class, select, true);
+    if (s)
+    {
+        memcpy(s->res, res, sizeof(s->res));
+        s->programmed = true;
+        retval = 0;
+    }
+    pthread_mutex_unlock(&emu->lock);
+    return retval;
+}
+
+int dell_smi_emu_set_buffer(struct dell_smi_emu *emu, u16 smi_class, u16 select, u8 argno, const u8 *data, size_t size)
+{
+    int retval = -1;
+    u8 *copy = 0;
+    if (!emu || argno > cbARG4)
+        return retval;
+
+    if (data && size)
+    {
+        copy = malloc(size);
+        if (!copy)
+            return retval;
+        memcpy(copy, data, size);
+    }
+
+    pthread_mutex_lock(&emu->lock);
+    struct emu_selector *s = find_selector(emu, smi_class, select, true);
+    if (s)
+    {
+        free(s->data);
+        s->data = copy;
+        s->data_size = copy ? size : 0;
+        s->argno = argno;
+        s->programmed = true;
+        copy = 0;
+        retval = 0;
+    }
+    pthread_mutex_unlock(&emu->lock);
+    free(copy);
+    return retval;
+}
+
+void dell_smi_emu_set_latency(struct dell_smi_emu *emu, unsigned int usec)
+{
+    if (emu)
+        emu->latency_us = usec;
+}
+
+u64 dell_smi_emu_get_count(struct dell_smi_emu *emu, u16 smi_class, u16 select)
+{
+    u64 retval = 0;
+    if (!emu)
+        return retval;
+
+    pthread_mutex_lock(&emu->lock);
+    struct emu_selector *s = find_selector(emu, smi_class, select, false);
+    if (s)
+        retval = s->count;
+    pthread_mutex_unlock(&emu->lock);
+    return retval;
+}
+
+u64 dell_smi_emu_get_total(struct dell_smi_emu *emu)
+{
+    u64 retval = 0;
+    if (emu)
+    {
+        pthread_mutex_lock(&emu->lock);
+        retval = emu->total;
+        pthread_mutex_unlock(&emu->lock);
+    }
+    return retval;
+}
+
+int dell_smi_emu_get_last_request(struct dell_smi_emu *emu, u16 *smi_class, u16 *select, u32 args[4])
+{
+    int retval = -1;
+    if (!emu)
+        return retval;
+
+    pthread_mutex_lock(&emu->lock);
+    if (emu->have_last)
+    {
+        if (smi_class)
+            *smi_class = emu->last.smi_class;
+        if (select)
+            *select = emu->last.smi_select;
+        if (args)
+            memcpy(args, emu->last.arg, sizeof(emu->last.arg));
+        retval = 0;
+    }
+    pthread_mutex_unlock(&emu->lock);
+    return retval;
+}
@@ -20,6 +20,7 @@
 
 #include "smbios_c/compat.h"
 #include "smbios_c/smi.h"
+#include "smbios_c/stats.h"
 #include "smbios_c/types.h"
 
 #include "smbios_c/config/abi_prefix.h"
@@ -92,15 +93,60 @@ struct dell_smi_obj
     int initialized;
     u16 command_address;
     u8  command_code;
+    u32 supported_cmds; // 0xDA bitmap, 0 if the bios does not fill it in
+    u8  dell_smbios_ver; // 0xD0 major version, picks the frombios buffer format
     int (*execute)(struct dell_smi_obj *);
+    // optional: hold the OS interface across several execute() calls
+    int (*batch_begin)(struct dell_smi_obj *, size_t max_arg_buffers);
+    void (*batch_end)(struct dell_smi_obj *);
     struct smi_cmd_buffer smi_buf;
     u8 *physical_buffer[4];
     size_t physical_buffer_size[4];
+    bool physical_buffer_borrowed[4]; // caller owns it, see dell_smi_obj_set_buffer()
     char *errstring;
+    struct libsmbios_c_obj_stats stats;
+    void (*free)(struct dell_smi_obj *this);
+    void (*cleanup)(struct dell_smi_obj *this); // release OS handles, object stays usable
+    void *private_data;
+    int open_sessions;  // nesting depth of suggest_leave_open()/suggest_close()
+    int persistent;     // DELL_SMI_PERSISTENT: keep OS handles open for object lifetime
+    struct smi_cache *cache; // opt-in result cache, see smi_cache.c
+    bool per_thread;    // owned by the thread slot, dell_smi_obj_free() ignores it
 };
 
 int __hidden init_dell_smi_obj(struct dell_smi_obj *);
 int __hidden init_dell_smi_obj_std(struct dell_smi_obj *);
+int __hidden smi_read_smbios_info(struct dell_smi_obj *);
+__hidden char *smi_get_module_error_buf();
+void __hidden _smi_free(struct dell_smi_obj *);
+
+// loopback backend behind DELL_SMI_UNIT_TEST_MODE with a NULL init fn
+int __hidden init_dell_smi_obj_loopback(struct dell_smi_obj *);
+
+// emulated firmware (smi_emu.c). When set, the dcdbas backend calls the
+// first hook after triggering a request and the wmi backend calls the second
+// instead of its ioctl. Objects pick up redirected paths when they next open.
+__hidden extern int (*smi_emu_dcdbas_hook)(void);
+__hidden extern int (*smi_emu_wmi_hook)(void *wmi_buf);
+__hidden extern const char *sysfs_basedir;
+__hidden extern const char *wmi_char;
+__hidden void set_basedir(const char *newdir);
+
+// per-thread default objects, provided by the os layer. smi_thread_obj()
+// returns the (possibly not yet initialized) object of the calling thread,
+// or 0 if the platform has no thread support and the singleton is shared.
+__hidden struct dell_smi_obj *smi_thread_obj(void);
+// serializes object setup, which reads the shared smbios table
+__hidden void smi_setup_lock(void);
+__hidden void smi_setup_unlock(void);
+// the singleton and per-thread default objects are used by the library
+// itself from whatever thread calls it
+__hidden bool smi_obj_is_shared(const struct dell_smi_obj *this);
+
+// result cache: lookup fills smi_buf.res on a hit. update stores or, for
+// selectors not known to be read-only, flushes.
+__hidden bool smi_cache_lookup(struct dell_smi_obj *this);
+__hidden void smi_cache_update(struct dell_smi_obj *this, const struct smi_cmd_buffer *request, int retval);
 
 
 
@@ -23,12 +23,16 @@
 
 // system
 #include <alloca.h>
+#include <stddef.h>    // offsetof
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>  // flock
 #include <sys/ioctl.h> // ioctl
 #include <errno.h>
+#include <fcntl.h>     // open
+#include <pthread.h>
+#include <unistd.h>    // pread, pwrite, close
 
 // public
 #include "smbios_c/obj/smi.h"
@@ -59,7 +63,10 @@ const char *smi_request_fn            = "smi_request";
 
 #define bufsize 256
 
-// not in header file. for private use by unit tests.
+int (*smi_emu_dcdbas_hook)(void);
+int (*smi_emu_wmi_hook)(void *wmi_buf);
+
+// for private use by unit tests and the emulator.
 void set_basedir(const char *newdir)
 {
     sysfs_basedir = newdir;
@@ -78,163 +85,120 @@ void set_basedir(const char *newdir)
         fn_;                                                \
     })
 
-u32 __hidden get_phys_buf_addr()
+// kernel interface files, opened once per session rather than per call
+struct linux_smi_data
 {
-    char *fn = NULL;
-    FILE *fd = 0;
-    u32 physaddr = 0;
-    char linebuf[bufsize] = {0,};
-    int ret;
-
-    fnprintf("\n");
-
-    fn = allocate_path(sysfs_basedir, smi_data_buf_phys_addr_fn);
-    if (!fn)
-        goto out;
-
-    fd = fopen(fn, "rb");
-    if (!fd)
-        goto out;
-
-    ret = fseek(fd, 0L, 0);
-    if (ret < 0)
-        goto out_close;
-    size_t numBytes = fread(linebuf, 1, bufsize, fd);
-    if (!numBytes)
-        goto out_close;
-
-    physaddr = strtoll(linebuf, NULL, 16);
-
-out_close:
-    if (fd)
-        fclose(fd);
-    fflush(NULL);
-
-out:
-    return physaddr;
-}
-
-// returns physaddr
-u32 __hidden set_phys_buf_size(u32 newsize)
+    int request_fd;
+    int size_fd;
+    int addr_fd;
+    int data_fd;
+    size_t kernel_buf_size; // last size written to smi_data_buf_size
+    bool locked;            // holding the request file lock (single call or batch)
+    u32 physaddr;           // kernel buffer address, valid while locked
+    u8 *buffer;             // staging buffer, grown on demand
+    size_t buffer_size;
+    // dell-smbios WMI: one fd and one buffer of the size the driver asked
+    // for, both kept until the object is freed
+    int wmi_fd;
+    struct dell_wmi_smbios_buffer *wmi_buf;
+};
+
+static int open_sysfs(const char *name, int flags)
 {
-    char *fn;
-    FILE *fd = NULL;
-    char linebuf[bufsize] = {0,};
-    u32 phys_buf_addr=0;
-
-    fnprintf("\n");
-
-    fn = allocate_path(sysfs_basedir, smi_data_buf_size_fn);
+    char *fn = allocate_path(sysfs_basedir, name);
     if (!fn)
-        goto out;
-
-    fd = fopen(fn, "w+b");
-    if (!fd)
-        goto out;
-
-    snprintf(linebuf, bufsize, "%d", newsize);
-    size_t recs = fwrite(linebuf, strlen(linebuf)+1, 1, fd);
-    if (recs != 1)
-        goto out;
-
-    phys_buf_addr = get_phys_buf_addr();
-
-out:
-    if (fd)
-        fclose(fd);
-    fflush(NULL);
-
-    return phys_buf_addr;
+        return -1;
+    fnprintf("open: '%s'\n", fn);
+    return open(fn, flags | O_CLOEXEC);
 }
 
-void __hidden write_smi_data(u8 *buffer, size_t size)
-{
-    char *fn;
-    FILE *fd = 0;
+// dcdbas has a single request buffer for the whole machine. flock() keeps
+// other processes out, but every thread here has its own fds, so threads
+// would otherwise queue in the kernel; they wait on this mutex first.
+static pthread_mutex_t request_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+static void closefds(struct linux_smi_data *private_data)
+{
+    int *fds[] = { &private_data->request_fd, &private_data->size_fd, &private_data->addr_fd, &private_data->data_fd };
     fnprintf("\n");
-
-    fn = allocate_path(sysfs_basedir, smi_data_fn);
-    if (!fn)
-        goto out;
-
-    fnprintf("open data file: '%s'\n", fn);
-
-    fd = fopen(fn, "w+b");
-    if (!fd)
-        goto out;
-
-    size_t recs = fwrite(buffer, 1, size, fd);
-    UNREFERENCED_PARAMETER(recs);
-    fnprintf("wrote %zd recs\nclose()\n", recs);
-    fclose(fd);
-    fnprintf("fflush()\n");
-    fflush(NULL);
-out:
-    fnprintf("return\n");
-    return;
+    for (unsigned int i=0; i<sizeof(fds)/sizeof(fds[0]); ++i)
+    {
+        if (*fds[i] >= 0)
+            close(*fds[i]);
+        *fds[i] = -1;
+    }
+    // dcdbas only ever grows its buffer, but another user may reload the
+    // module while we are closed. Re-send the size on the next open.
+    private_data->kernel_buf_size = 0;
+    if (private_data->locked)       // closing the fd drops the flock
+        pthread_mutex_unlock(&request_mutex);
+    private_data->locked = false;
 }
 
-void __hidden trigger_smi(FILE *fd)
+static int openfds(struct linux_smi_data *private_data)
 {
-    fnprintf("\n");
-
-    if (!fd)
-        goto out;
-
-    size_t recs = fwrite("1", 1, 2, fd);
-    UNREFERENCED_PARAMETER(recs);
-    fflush(NULL);
-
-out:
-    return;
+    if (private_data->request_fd >= 0)
+        return 0;
+
+    private_data->request_fd = open_sysfs(smi_request_fn, O_WRONLY);
+    private_data->size_fd = open_sysfs(smi_data_buf_size_fn, O_WRONLY);
+    private_data->addr_fd = open_sysfs(smi_data_buf_phys_addr_fn, O_RDONLY);
+    private_data->data_fd = open_sysfs(smi_data_fn, O_RDWR);
+    if (private_data->request_fd < 0 || private_data->size_fd < 0
+            || private_data->addr_fd < 0 || private_data->data_fd < 0)
+    {
+        int saved = errno;
+        closefds(private_data);
+        errno = saved;
+        return -1;
+    }
+    return 0;
 }
 
-void __hidden get_smi_results(u8 *buffer, size_t size)
+static int get_phys_buf_addr(struct linux_smi_data *private_data, u32 *physaddr)
 {
-    char *fn;
-    FILE *fd = 0;
+    char linebuf[bufsize] = {0,};
 
     fnprintf("\n");
+    ssize_t numBytes = pread(private_data->addr_fd, linebuf, bufsize - 1, 0);
+    if (numBytes <= 0)
+        return -1;
 
-    fn = allocate_path(sysfs_basedir, smi_data_fn);
-    if (!fn)
-        goto out;
-
-    fd = fopen(fn, "rb");
-    if (!fd)
-        goto out;
-
-    size_t recs = fread(buffer, size, 1, fd);
-    UNREFERENCED_PARAMETER(recs);
-    fclose(fd);
-out:
-    return;
+    *physaddr = strtoll(linebuf, NULL, 16);
+    return 0;
 }
 
-FILE *open_request_file()
+// only grows the kernel buffer; dcdbas never shrinks it anyway
+static int set_phys_buf_size(struct linux_smi_data *private_data, size_t newsize)
 {
-    char *fn;
-    FILE *fd = 0;
-    int ret;
-
-    fn = allocate_path(sysfs_basedir, smi_request_fn);
-    if (!fn)
-        return NULL;
+    char linebuf[bufsize] = {0,};
 
-    fnprintf("open request file: '%s'\n", fn);
-    fd = fopen(fn, "wb");
-    if (!fd)
-        return NULL;
+    fnprintf("cur %zd new %zd\n", private_data->kernel_buf_size, newsize);
+    if (newsize <= private_data->kernel_buf_size)
+        return 0;
 
-    flock( fileno(fd), LOCK_EX );
-    ret = fwrite("0", 1, 1, fd);
+    snprintf(linebuf, bufsize, "%zd", newsize);
+    size_t len = strlen(linebuf) + 1;
+    if (pwrite(private_data->size_fd, linebuf, len, 0) != (ssize_t)len)
+        return -1;
 
-    fnprintf("got fd for request file: %p\n", fd);
-    UNREFERENCED_PARAMETER(ret);
-    return fd;
+    private_data->kernel_buf_size = newsize;
+    return 0;
 }
 
+static u8 *get_staging_buffer(struct linux_smi_data *private_data, size_t size)
+{
+    if (size > private_data->buffer_size)
+    {
+        u8 *newbuf = realloc(private_data->buffer, size);
+        if (!newbuf)
+            return 0;
+        private_data->buffer = newbuf;
+        private_data->buffer_size = size;
+    }
+    memset(private_data->buffer, 0, size);
+    return private_data->buffer;
+}
 
 #define TO_KERNEL_BUF true
 #define FROM_KERNEL_BUF false
@@ -308,27 +272,66 @@ int __hidden wmi_supported()
     return 0;
 }
 
+#define WMI_BUF_ALIGN 64
+
+// open the device and size the buffer once. The driver rejects any request
+// whose length differs from the one it reports, so it never changes.
+static int wmi_setup(struct linux_smi_data *private_data)
+{
+    u64 length = 0;
+    void *buf = 0;
+    int retval = -EIO;
+
+    if (private_data->wmi_buf)
+        return 0;
+
+    if (private_data->wmi_fd < 0)
+        private_data->wmi_fd = open(wmi_char, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (private_data->wmi_fd < 0)
+        return -EINVAL;
+
+    ssize_t ret = read(private_data->wmi_fd, &length, sizeof(length));
+    fnprintf("length: %llu\n", length);
+    if (ret != sizeof(length) || length > 65536 || length < sizeof(struct dell_wmi_smbios_buffer))
+        goto out_close;
+
+    retval = -ENOMEM;
+    if (posix_memalign(&buf, WMI_BUF_ALIGN, length))
+        goto out_close;
+
+    private_data->wmi_buf = buf;
+    memset(private_data->wmi_buf, 0, length);
+    private_data->wmi_buf->length = length;
+    return 0;
+
+out_close:
+    // the read moved the file offset: the next try must start from a fresh open
+    close(private_data->wmi_fd);
+    private_data->wmi_fd = -1;
+    return retval;
+}
+
 int __hidden LINUX_dell_wmi_obj_execute(struct dell_smi_obj *this)
 {
+    struct linux_smi_data *private_data = (struct linux_smi_data *)this->private_data;
     struct dell_wmi_smbios_buffer *buffer;
-    u64 length;
-    FILE *f;
-    int fd;
+    size_t header = offsetof(struct dell_wmi_smbios_buffer, ext.data);
+    size_t needed = header;
     int ret;
 
-    // setup buffer size
-    f = fopen(wmi_char, "rb");
-    if (!f)
+    ret = wmi_setup(private_data);
+    if (ret)
+        return ret;
+    buffer = private_data->wmi_buf;
+
+    for (int i=0; i<4; i++)
+        needed += this->physical_buffer_size[i];
+    if (needed > buffer->length)
         return -EINVAL;
-    ret = fread(&length, sizeof(__u64), 1, f);
-    fnprintf("length: %llu\n", length);
-    fclose(f);
-    if (ret <= 0 || length > 65536)
-        return -EIO;
-    buffer = calloc(1, length);
-    if (!buffer)
-        return -ENOMEM;
-    buffer->length = length;
+
+    // argument buffers are copied over in full, so only the fixed part
+    // needs clearing. Stale bytes past them are never referenced.
+    memset(&buffer->std, 0, header - sizeof(buffer->length));
 
     // update our buf
     memcpy(&buffer->std, &(this->smi_buf), sizeof(this->smi_buf));
@@ -337,15 +340,12 @@ int __hidden LINUX_dell_wmi_obj_execute(struct dell_smi_obj *this)
     copy_phys_bufs_wmi(this, buffer, TO_KERNEL_BUF);
 
     // perform command
-    fd = open(wmi_char, O_NONBLOCK);
-    if (fd < 0) {
-        ret = -EIO;
-        goto out_wmi;
-    }
-    ret = ioctl(fd, DELL_WMI_SMBIOS_CMD, buffer);
-    close(fd);
+    if (smi_emu_wmi_hook)
+        ret = smi_emu_wmi_hook(buffer);
+    else
+        ret = ioctl(private_data->wmi_fd, DELL_WMI_SMBIOS_CMD, buffer);
     if (ret)
-        goto out_wmi;
+        return ret;
 
     // copy result out
     memcpy(&(this->smi_buf), &buffer->std, sizeof(this->smi_buf));
@@ -353,17 +353,133 @@ int __hidden LINUX_dell_wmi_obj_execute(struct dell_smi_obj *this)
     // update smi buffer
     copy_phys_bufs_wmi(this, buffer, FROM_KERNEL_BUF);
 
-out_wmi:
-    free(buffer);
-    return ret;
+    return 0;
+}
+
+/*
+ * per-thread objects
+ */
+static pthread_mutex_t setup_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t thread_obj_key;
+static pthread_once_t thread_obj_once = PTHREAD_ONCE_INIT;
+static bool thread_obj_key_ok;
+
+void __hidden smi_setup_lock(void)
+{
+    pthread_mutex_lock(&setup_mutex);
+}
+
+void __hidden smi_setup_unlock(void)
+{
+    pthread_mutex_unlock(&setup_mutex);
+}
+
+static void free_thread_obj(void *obj)
+{
+    fnprintf("\n");
+    smi_setup_lock();   // stats_retire() folds into shared totals
+    _smi_free((struct dell_smi_obj *)obj);
+    smi_setup_unlock();
+}
+
+static void make_thread_obj_key(void)
+{
+    thread_obj_key_ok = (pthread_key_create(&thread_obj_key, free_thread_obj) == 0);
+}
+
+struct dell_smi_obj __hidden *smi_thread_obj(void)
+{
+    struct dell_smi_obj *obj;
+
+    pthread_once(&thread_obj_once, make_thread_obj_key);
+    if (!thread_obj_key_ok)
+        return 0;
+
+    obj = pthread_getspecific(thread_obj_key);
+    if (obj)
+        return obj;
+
+    obj = calloc(1, sizeof(struct dell_smi_obj));
+    if (obj && pthread_setspecific(thread_obj_key, obj))
+    {
+        free(obj);
+        obj = 0;
+    }
+    return obj;
+}
+
+static void linux_smi_unlock(struct dell_smi_obj *this)
+{
+    struct linux_smi_data *private_data = (struct linux_smi_data *)this->private_data;
+    fnprintf("\n");
+    if (!private_data->locked)
+        return;
+
+    flock(private_data->request_fd, LOCK_UN);
+    private_data->locked = false;
+    pthread_mutex_unlock(&request_mutex);
+    if (dell_smi_obj_should_close(this))
+        closefds(private_data);
+}
+
+// take the request lock and set up a kernel buffer of at least 'size' bytes.
+// The buffer address is re-read every time: another process may have grown
+// (and so moved) the kernel buffer since we last held the lock.
+static int linux_smi_lock(struct dell_smi_obj *this, size_t size)
+{
+    struct linux_smi_data *private_data = (struct linux_smi_data *)this->private_data;
+    fnprintf(" size %zd\n", size);
+    if (private_data->locked)
+        return 0;
+
+    if (openfds(private_data) < 0)
+        return -1;
+
+    pthread_mutex_lock(&request_mutex);
+    flock(private_data->request_fd, LOCK_EX);
+    private_data->locked = true;
+
+    // clear the kernel buffer
+    if (pwrite(private_data->request_fd, "0", 1, 0) != 1)
+        goto err_out;
+    if (set_phys_buf_size(private_data, size) < 0)
+        goto err_out;
+    if (get_phys_buf_addr(private_data, &private_data->physaddr) < 0)
+        goto err_out;
+    return 0;
+
+err_out:
+    {
+        int saved = errno;
+        flock(private_data->request_fd, LOCK_UN);
+        private_data->locked = false;
+        pthread_mutex_unlock(&request_mutex);
+        closefds(private_data);
+        errno = saved;
+    }
+    return -1;
+}
+
+static int linux_smi_batch_begin(struct dell_smi_obj *this, size_t max_arg_buffers)
+{
+    int retval = linux_smi_lock(this, sizeof(struct callintf_cmd) + sizeof(this->smi_buf) + max_arg_buffers);
+    if (retval < 0)
+    {
+        strlcpy( this->errstring, _("There was an error trying to set up the smi interface for a batch. Is the 'dcdbas' kernel module loaded?"), ERROR_BUFSIZE);
+        strlcat(this->errstring, _("\nThe OS Error string was: "), ERROR_BUFSIZE);
+        fixed_strerror(errno, this->errstring, ERROR_BUFSIZE);
+    }
+    return retval;
 }
 
 int __hidden LINUX_dell_smi_obj_execute(struct dell_smi_obj *this)
 {
+    struct linux_smi_data *private_data = (struct linux_smi_data *)this->private_data;
     struct callintf_cmd *kernel_buf;
     size_t alloc_size = sizeof(struct callintf_cmd) + sizeof(this->smi_buf);
+    const char *error = _("There was an error trying to perform the smi execute() cmd. Is the 'dcdbas' kernel module loaded?");
     int retval = -1;
-    u8 *buffer = 0;
+    bool own_lock = !private_data->locked;  // otherwise a batch holds it
 
     fnprintf("\n");
 
@@ -371,20 +487,23 @@ int __hidden LINUX_dell_smi_obj_execute(struct dell_smi_obj *this)
     for(int i=0; i<4; i++)
         alloc_size += this->physical_buffer_size[i];
 
-    // allocate buffer
-    fnprintf(" allocate buffer: %zd\n", alloc_size);
-    buffer = calloc(1, alloc_size);
-    kernel_buf = (struct callintf_cmd *)buffer;
+    fnprintf(" staging buffer: %zd\n", alloc_size);
+    kernel_buf = (struct callintf_cmd *)get_staging_buffer(private_data, alloc_size);
+    if (!kernel_buf)
+    {
+        error = _("Failed to allocate memory for the smi buffer.");
+        goto err_out;
+    }
 
     // LOCK
-    fnprintf(" open_request_file()\n");
-    FILE *fd = open_request_file();
-    if (!fd)
+    if (linux_smi_lock(this, alloc_size) < 0)
         goto err_out;
 
-    // set phys buf size
-    fnprintf(" set buffer size\n");
-    u32 physaddr = set_phys_buf_size(alloc_size);
+    // a batch entry bigger than the batch was set up for
+    if (alloc_size > private_data->kernel_buf_size)
+        if (set_phys_buf_size(private_data, alloc_size) < 0
+                || get_phys_buf_addr(private_data, &private_data->physaddr) < 0)
+            goto err_out;
 
     // setup kernel args
     kernel_buf->magic = KERNEL_SMI_MAGIC_NUMBER;
@@ -394,54 +513,104 @@ int __hidden LINUX_dell_smi_obj_execute(struct dell_smi_obj *this)
     kernel_buf->command_code = this->command_code;
 
     // copy in each physical addr buf
-    copy_phys_bufs_smi(this, kernel_buf, physaddr, TO_KERNEL_BUF);
+    copy_phys_bufs_smi(this, kernel_buf, private_data->physaddr, TO_KERNEL_BUF);
 
     // setup std smi args
     memcpy(kernel_buf->command_buffer_start, &(this->smi_buf), sizeof(this->smi_buf));
 
-    // write the whole thing to the smi file
     fnprintf(" write smi data\n");
-    write_smi_data(buffer, alloc_size);
+    if (pwrite(private_data->data_fd, kernel_buf, alloc_size, 0) != (ssize_t)alloc_size)
+        goto err_out;
 
-    // trigger smi
     fnprintf(" trigger smi\n");
-    trigger_smi(fd);
+    if (pwrite(private_data->request_fd, "1", 2, 0) != 2)
+        goto err_out;
+    if (smi_emu_dcdbas_hook && smi_emu_dcdbas_hook() < 0)
+        goto err_out;
 
-    // copy results back
     fnprintf(" read smi results\n");
-    get_smi_results(buffer, alloc_size);
-
-    // unlock
-    flock( fileno(fd), LOCK_UN );
+    if (pread(private_data->data_fd, kernel_buf, alloc_size, 0) != (ssize_t)alloc_size)
+        goto err_out;
 
     // update our physical address bufs
     memcpy(&(this->smi_buf), kernel_buf->command_buffer_start, sizeof(this->smi_buf));
 
     // update smi buffer
-    copy_phys_bufs_smi(this, kernel_buf, physaddr, FROM_KERNEL_BUF);
-
-    fclose(fd);
+    copy_phys_bufs_smi(this, kernel_buf, private_data->physaddr, FROM_KERNEL_BUF);
 
     retval = 0;
     goto out;
 
 err_out:
     fnprintf(" err_out\n");
-    strlcpy( this->errstring, _("There was an error trying to perform the smi execute() cmd. Is the 'dcdbas' kernel module loaded?"), ERROR_BUFSIZE);
+    strlcpy( this->errstring, error, ERROR_BUFSIZE);
     strlcat(this->errstring, _("\nThe OS Error string was: "), ERROR_BUFSIZE);
     fixed_strerror(errno, this->errstring, ERROR_BUFSIZE);
 
 out:
-    free(buffer);
+    // unlock. a failed call may have left the interface in a bad state
+    if (own_lock)
+        linux_smi_unlock(this);
+    if (own_lock && retval)
+        closefds(private_data);
     fnprintf("retval: %d\n", retval);
     return retval;
 }
 
+static void linux_smi_cleanup(struct dell_smi_obj *this)
+{
+    fnprintf("\n");
+    closefds((struct linux_smi_data *)this->private_data);
+}
+
+static void linux_smi_free(struct dell_smi_obj *this)
+{
+    struct linux_smi_data *private_data = (struct linux_smi_data *)this->private_data;
+    fnprintf("\n");
+    if (!private_data)
+        return;
+    if (private_data->wmi_fd >= 0)
+        close(private_data->wmi_fd);
+    free(private_data->wmi_buf);
+    free(private_data->buffer);
+    free(private_data);
+}
+
 int __hidden init_dell_smi_obj(struct dell_smi_obj *this)
 {
+    struct linux_smi_data *private_data = 0;
+
     if (wmi_supported())
         this->execute = LINUX_dell_wmi_obj_execute;
     else
         this->execute = LINUX_dell_smi_obj_execute;
-    return init_dell_smi_obj_std(this);
+
+    int retval = init_dell_smi_obj_std(this);
+    if (retval)
+        return retval;
+
+    private_data = calloc(1, sizeof(struct linux_smi_data));
+    if (!private_data)
+    {
+        char *errbuf = smi_get_module_error_buf();
+        if (errbuf)
+            strlcpy(errbuf, _("Failed to allocate memory for the smi object.\n"), ERROR_BUFSIZE);
+        free(this->errstring);
+        this->errstring = 0;
+        this->initialized = 0;
+        return -1;
+    }
+
+    private_data->request_fd = private_data->size_fd = -1;
+    private_data->addr_fd = private_data->data_fd = -1;
+    private_data->wmi_fd = -1;
+    this->private_data = private_data;
+    if (this->execute == LINUX_dell_smi_obj_execute)
+    {
+        this->batch_begin = linux_smi_batch_begin;
+        this->batch_end = linux_smi_unlock;
+    }
+    this->cleanup = linux_smi_cleanup;
+    this->free = linux_smi_free;
+    return 0;
 }
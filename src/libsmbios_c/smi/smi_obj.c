@@ -35,27 +35,23 @@
 
 // private
 #include "smi_impl.h"
-
-// forward declarations
-void _smi_free(struct dell_smi_obj *m);
+#include "stats_impl.h"
 
 // static vars
 static struct dell_smi_obj singleton; // auto-init to 0
 typedef int (*init_fn)(struct dell_smi_obj *);
-static char *module_error_buf; // auto-init to 0
+// per thread, like errno: objects are used from many threads at once
+static __thread char module_error_buf[ERROR_BUFSIZE];
 
-__attribute__((destructor)) static void return_mem(void)
+__attribute__((destructor)) static void close_singleton(void)
 {
-    fnprintf("\n");
-    free(module_error_buf);
-    module_error_buf = 0;
+    if (singleton.initialized && singleton.cleanup)
+        singleton.cleanup(&singleton);
 }
 
-static char *smi_get_module_error_buf()
+char *smi_get_module_error_buf()
 {
     fnprintf("\n");
-    if (!module_error_buf)
-        module_error_buf = calloc(1, ERROR_BUFSIZE);
     return module_error_buf;
 }
 
@@ -64,8 +60,7 @@ static void clear_err(const struct dell_smi_obj *this)
     fnprintf("\n");
     if (this && this->errstring)
         memset(this->errstring, 0, ERROR_BUFSIZE);
-    if(module_error_buf)
-        memset(module_error_buf, 0, ERROR_BUFSIZE);
+    memset(module_error_buf, 0, ERROR_BUFSIZE);
 }
 
 struct dell_smi_obj *dell_smi_factory(int flags, ...)
@@ -77,9 +72,14 @@ struct dell_smi_obj *dell_smi_factory(int flags, ...)
     fnprintf("\n");
 
     if (flags==DELL_SMI_DEFAULTS)
-        flags = DELL_SMI_GET_SINGLETON;
+        flags = DELL_SMI_GET_PER_THREAD;
+
+    if (flags & DELL_SMI_GET_PER_THREAD)
+        toReturn = smi_thread_obj();
 
-    if (flags & DELL_SMI_GET_SINGLETON)
+    if (toReturn)
+        toReturn->per_thread = true;
+    else if (flags & (DELL_SMI_GET_SINGLETON | DELL_SMI_GET_PER_THREAD))
         toReturn = &singleton;
     else
         toReturn = (struct dell_smi_obj *)calloc(1, sizeof(struct dell_smi_obj));
@@ -87,21 +87,39 @@ struct dell_smi_obj *dell_smi_factory(int flags, ...)
     if (toReturn->initialized)
         goto out;
 
+    // another thread may be setting up the singleton right now
+    smi_setup_lock();
+    if (toReturn->initialized)
+    {
+        smi_setup_unlock();
+        goto out;
+    }
+
+    toReturn->persistent = (flags & DELL_SMI_PERSISTENT) != 0;
     if (flags & DELL_SMI_UNIT_TEST_MODE)
     {
         va_start(ap, flags);
         init_fn fn = va_arg(ap, init_fn);
+        va_end(ap);
+        if (!fn)
+            fn = init_dell_smi_obj_loopback;
         fnprintf("call fn pointer: %p\n", fn);
         ret = fn(toReturn);
-        va_end(ap);
     } else
     {
         fnprintf("default init\n");
         ret = init_dell_smi_obj(toReturn);
     }
+    smi_setup_unlock();
 
     if (ret == 0)
+    {
+        if (smi_obj_is_shared(toReturn))
+            stats_track(STATS_SMI, &toReturn->stats);
+        if (flags & DELL_SMI_CACHE_RESULTS)
+            dell_smi_obj_cache_enable(toReturn, true);
         goto out;
+    }
 
     // failed
     fnprintf("failed\n");
@@ -118,7 +136,7 @@ out:
 void dell_smi_obj_free(struct dell_smi_obj *m)
 {
     fnprintf("\n");
-    if (m && m != &singleton)
+    if (m && !smi_obj_is_shared(m))
         _smi_free(m);
 }
 
@@ -151,20 +169,48 @@ void dell_smi_obj_set_select(struct dell_smi_obj *this, u16 smi_select)
         this->smi_buf.smi_select = smi_select;
 }
 
+static void release_buffer(struct dell_smi_obj *this, u8 argno)
+{
+    if (!this->physical_buffer_borrowed[argno])
+        free(this->physical_buffer[argno]);
+    this->physical_buffer[argno] = 0;
+    this->physical_buffer_size[argno] = 0;
+    this->physical_buffer_borrowed[argno] = false;
+}
+
 void dell_smi_obj_set_arg(struct dell_smi_obj *this, u8 argno, u32 value)
 {
     fnprintf(" %d -> 0x%x\n", argno, value);
     clear_err(this);
     if(!this) goto out;
-    free(this->physical_buffer[argno]);
-    this->physical_buffer[argno] = 0;
-    this->physical_buffer_size[argno] = 0;
+    release_buffer(this, argno);
 
     this->smi_buf.arg[argno] = value;
 out:
     return;
 }
 
+u32  dell_smi_obj_get_supported_cmds(struct dell_smi_obj *this)
+{
+    clear_err(this);
+    u32 retval = 0;
+    if (this)
+        retval = this->supported_cmds;
+    fnprintf(" = 0x%x\n", retval);
+    return retval;
+}
+
+bool dell_smi_obj_class_supported(struct dell_smi_obj *this, u16 smi_class)
+{
+    clear_err(this);
+    if (!this)
+        return false;
+    // bitmap not filled in by the BIOS, or too narrow to say: just try it
+    if (!this->supported_cmds || smi_class >= 32)
+        return true;
+    return (this->supported_cmds & (1UL << smi_class)) != 0;
+}
+
 u32  dell_smi_obj_get_res(struct dell_smi_obj *this, u8 argno)
 {
     clear_err(this);
@@ -184,7 +230,7 @@ static u8 * dell_smi_obj_make_buffer_X(struct dell_smi_obj *this, u8 argno, size
         goto out;
 
     this->smi_buf.arg[argno] = 0;
-    free(this->physical_buffer[argno]);
+    release_buffer(this, argno);
     this->physical_buffer[argno] = calloc(1, size);
     this->physical_buffer_size[argno] = size;
     retval = this->physical_buffer[argno];
@@ -220,16 +266,13 @@ u8 * dell_smi_obj_make_buffer_frombios_withoutheader(struct dell_smi_obj *this,
 u8 * dell_smi_obj_make_buffer_frombios_auto(struct dell_smi_obj *this, u8 argno, size_t size)
 {
     clear_err(this);
-    u8 smbios_ver = 1;
     u8 *retval = 0;
-    // look in smbios struct 0xD0 (Revisions and IDs) to find the Dell SMBIOS implementation version
-    //  offset 4 of the struct == dell major version
-    struct smbios_struct *s = smbios_get_next_struct_by_type(0, 0xd0);
-    smbios_struct_get_data(s, &(smbios_ver), 0x04, sizeof(u8));
+    if (!this)
+        return retval;
 
-    fnprintf("dell smbios ver: %d\n", smbios_ver);
+    fnprintf("dell smbios ver: %d\n", this->dell_smbios_ver);
 
-    if (smbios_ver >= 2)
+    if (this->dell_smbios_ver >= 2)
         retval = dell_smi_obj_make_buffer_frombios_withheader(this, argno, size);
     else
         retval = dell_smi_obj_make_buffer_frombios_withoutheader(this, argno, size);
@@ -241,6 +284,21 @@ u8 * dell_smi_obj_make_buffer_tobios(struct dell_smi_obj *this, u8 argno, size_t
     return dell_smi_obj_make_buffer_X(this, argno, size);
 }
 
+int dell_smi_obj_set_buffer(struct dell_smi_obj *this, u8 argno, u8 *buffer, size_t size)
+{
+    fnprintf(" %d -> %p (%zd)\n", argno, buffer, size);
+    clear_err(this);
+    if (argno>3 || !this || !buffer)
+        return -1;
+
+    this->smi_buf.arg[argno] = 0;
+    release_buffer(this, argno);
+    this->physical_buffer[argno] = buffer;
+    this->physical_buffer_size[argno] = size;
+    this->physical_buffer_borrowed[argno] = true;
+    return 0;
+}
+
 
 int dell_smi_obj_execute(struct dell_smi_obj *this)
 {
@@ -250,33 +308,183 @@ int dell_smi_obj_execute(struct dell_smi_obj *this)
     if(!this)
         goto out;
     this->smi_buf.res[0] = -3; //default to 'not handled'
-    if (this->execute)
+    if (this->execute && this->cache && smi_cache_lookup(this))
+        retval = 0;
+    else if (this->execute)
+    {
+        struct smi_cmd_buffer request = this->smi_buf;
+        u64 start = stats_start();
+        size_t bytes = sizeof(this->smi_buf);
+        for (int i=0; i<4; ++i)
+            bytes += this->physical_buffer_size[i];
         retval = this->execute(this);
+        stats_record(&this->stats.read, start, bytes, retval);
+        if (this->cache)
+            smi_cache_update(this, &request, retval);
+    }
 out:
     return retval;
 }
 
+void dell_smi_obj_suggest_leave_open(struct dell_smi_obj *this)
+{
+    clear_err(this);
+    if (this)
+        this->open_sessions++;
+}
+
+void dell_smi_obj_suggest_close(struct dell_smi_obj *this)
+{
+    clear_err(this);
+    if (!this || this->open_sessions <= 0)
+        return;
+
+    // last session out releases the kernel interface
+    this->open_sessions--;
+    if (dell_smi_obj_should_close(this) && this->cleanup)
+        this->cleanup(this);
+}
+
+bool dell_smi_obj_should_close(const struct dell_smi_obj *this)
+{
+    if (this)
+        return !this->persistent && this->open_sessions == 0;
+    return true;
+}
+
+int dell_smi_obj_get_stats(struct dell_smi_obj *this, struct libsmbios_c_obj_stats *out)
+{
+    if (!this || !out)
+        return -5;
+    *out = this->stats;
+    return 0;
+}
+
+void dell_smi_obj_reset_stats(struct dell_smi_obj *this)
+{
+    if (this)
+        memset(&this->stats, 0, sizeof(this->stats));
+}
+
+int dell_smi_obj_execute_batch(struct dell_smi_obj *this, struct dell_smi_request *reqs, size_t count)
+{
+    char first_error[ERROR_BUFSIZE] = {0,};
+    size_t max_buffers = 0;
+    int failed = 0;
+
+    fnprintf(" count %zd\n", count);
+    clear_err(this);
+    if (!this || (count && !reqs))
+        return -1;
+
+    for (size_t n=0; n<count; n++)
+    {
+        size_t total = 0;
+        for (int i=0; i<4; i++)
+            if (reqs[n].buffer[i])
+                total += reqs[n].buffer_size[i];
+        if (total > max_buffers)
+            max_buffers = total;
+    }
+
+    if (this->batch_begin && this->batch_begin(this, max_buffers) < 0)
+    {
+        for (size_t n=0; n<count; n++)
+            reqs[n].retval = -1;
+        return -1;
+    }
+
+    for (size_t n=0; n<count; n++)
+    {
+        struct dell_smi_request *r = &reqs[n];
+        this->smi_buf.smi_class = r->smi_class;
+        this->smi_buf.smi_select = r->select;
+        for (int i=0; i<4; i++)
+        {
+            release_buffer(this, i);
+            this->smi_buf.arg[i] = r->args[i];
+            if (r->buffer[i])
+            {
+                this->smi_buf.arg[i] = 0;
+                this->physical_buffer[i] = r->buffer[i];
+                this->physical_buffer_size[i] = r->buffer_size[i];
+                this->physical_buffer_borrowed[i] = true;
+            }
+        }
+
+        r->retval = dell_smi_obj_execute(this);
+        memcpy(r->res, this->smi_buf.res, sizeof(r->res));
+        if (r->retval && !failed++)
+            strlcpy(first_error, this->errstring, ERROR_BUFSIZE);
+    }
+
+    // dont leave the object pointing at caller memory
+    for (int i=0; i<4; i++)
+        release_buffer(this, i);
+
+    if (this->batch_end)
+        this->batch_end(this);
+
+    strlcpy(this->errstring, first_error, ERROR_BUFSIZE);
+    fnprintf(" failed %d\n", failed);
+    return failed;
+}
+
 /**************************************************
  *
  * Internal functions
  *
  **************************************************/
 
+bool __hidden smi_obj_is_shared(const struct dell_smi_obj *this)
+{
+    return this == &singleton || this->per_thread;
+}
+
 void __hidden _smi_free(struct dell_smi_obj *this)
 {
     fnprintf("\n");
+    if (this->cleanup)
+        this->cleanup(this);
+    if (this->free)
+        this->free(this);
+    this->private_data = 0;
     this->initialized=0;
     for (int i=0;i<4;++i)
-    {
-        free(this->physical_buffer[i]);
-        this->physical_buffer[i]=0;
-        this->physical_buffer_size[i] = 0;
-    }
+        release_buffer(this, i);
+    free(this->cache);
+    this->cache = 0;
     free(this->errstring);
     this->errstring = 0;
+    stats_retire(STATS_SMI, &this->stats);
     free(this);
 }
 
+// everything the smi layer needs from smbios, read once per object.
+// returns < 0 if there is no 0xDA structure; the fields then keep defaults
+int __hidden smi_read_smbios_info(struct dell_smi_obj *this)
+{
+    // no 0xD0: treat as a version 1 bios, buffers without header
+    this->dell_smbios_ver = 1;
+    this->supported_cmds = 0;
+
+    // 0xD0 (Revisions and IDs), offset 4 == dell major version
+    struct smbios_struct *s = smbios_get_next_struct_by_type(0, 0xd0);
+    smbios_struct_get_data(s, &(this->dell_smbios_ver), 0x04, sizeof(u8));
+
+    // 0xDA (Calling Interface)
+    s = smbios_get_next_struct_by_type(0, 0xda);
+    if (!s)
+        return -1;
+
+    smbios_struct_get_data(s, &(this->command_address), 4, sizeof(u16));
+    smbios_struct_get_data(s, &(this->command_code), 6, sizeof(u8));
+    smbios_struct_get_data(s, &(this->supported_cmds), 7, sizeof(u32));
+    fnprintf(" ver %d, cmd 0x%x/0x%x, supported 0x%x\n", this->dell_smbios_ver,
+            this->command_address, this->command_code, this->supported_cmds);
+    return 0;
+}
+
 int __hidden init_dell_smi_obj_std(struct dell_smi_obj *this)
 {
     int retval = 0;
@@ -284,12 +492,7 @@ int __hidden init_dell_smi_obj_std(struct dell_smi_obj *this)
     fnprintf("\n");
 
     const char *error = _("Failed to find appropriate SMBIOS 0xD4 structure.\n");
-    struct smbios_struct *s = smbios_get_next_struct_by_type(0, 0xda);
-    if (s) {
-        smbios_struct_get_data(s, &(this->command_address), 4, sizeof(u16));
-        smbios_struct_get_data(s, &(this->command_code), 6, sizeof(u8));
-    }
-    else
+    if (smi_read_smbios_info(this) < 0)
         goto out_fail;
 
     error = _("Failed to allocate memory for error string.\n");
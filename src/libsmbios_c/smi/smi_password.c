@@ -21,6 +21,7 @@
 // Include compat.h first, then system headers, then public, then private
 #include "smbios_c/compat.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 // public
@@ -86,11 +87,21 @@ function must first acquire a proper Security Key. It does this by performing th
    BIOS if it supports the Security Key feature.
 */
 
-int dell_smi_get_security_key(const char *password, u16 *key)
+// which password of the pair the BIOS wants for a given password type
+static const char *pick_password(int format, const char *pass_ascii, const char *pass_scancode)
+{
+    if (format == SMI_PASSWORD_TYPE_ASCII)
+        return pass_ascii;
+    return pass_scancode;
+}
+
+static int find_security_key(const char *pass_ascii, const char *pass_scancode, u16 *key, int *which_out, int *format_out)
 {
     int tmpret;
     u16 security_key = 0;
     int return_code = -2;
+    int found_which = DELL_SMI_PASSWORD_ANY;
+    int found_format = -1;
 
     int pass_to_check[] = {DELL_SMI_PASSWORD_ADMIN, DELL_SMI_PASSWORD_USER};
     int numpass = sizeof(pass_to_check)/sizeof(pass_to_check[0]);
@@ -101,6 +112,8 @@ int dell_smi_get_security_key(const char *password, u16 *key)
     for (int i=0; i<numpass; i++)
     {
         int which = pass_to_check[i];
+        int format = SMI_PASSWORD_TYPE_SCANCODE;
+        const char *password;
         fnprintf("check %d\n", which);
 
         // try new func first
@@ -108,6 +121,10 @@ int dell_smi_get_security_key(const char *password, u16 *key)
         tmpret = get_password_properties_2(which, &p);
         // if function succeeded and password *not* installed, skip
         fnprintf("after get_password_properties_2: tmpret(%d)  p.installed(%d)\n", tmpret, p.installed);
+        if (tmpret == 0 && (p.characteristics & 1))
+            format = SMI_PASSWORD_TYPE_ASCII;
+        if (found_format < 0)
+            found_format = format;
         if (tmpret == 0 && p.installed != 0)
         {
             return_code = 0;
@@ -122,12 +139,16 @@ int dell_smi_get_security_key(const char *password, u16 *key)
             continue;
         }
 
+        password = pick_password(format, pass_ascii, pass_scancode);
+
         // step 2a: verify admin password (new method)
         tmpret = verify_password_2(which, password, p.maxlen, &security_key);
         fnprintf("after verify_password_2: tmpret(%d)  security_key(%d)\n", tmpret, security_key);
         if (tmpret==0) // correct, security key set
         {
             return_code = 0;
+            found_which = which;
+            found_format = format;
             goto out;
         }
         if (tmpret==2)
@@ -139,6 +160,8 @@ int dell_smi_get_security_key(const char *password, u16 *key)
         if (tmpret==0) // correct, security key set
         {
             return_code = 0;
+            found_which = which;
+            found_format = format;
             goto out;
         }
         if (tmpret==2)
@@ -150,9 +173,136 @@ int dell_smi_get_security_key(const char *password, u16 *key)
 out:
     if (key)
         *key = security_key;
+    if (which_out)
+        *which_out = found_which;
+    if (format_out)
+        *format_out = found_format < 0 ? SMI_PASSWORD_TYPE_SCANCODE : found_format;
     return return_code;
 }
 
+int dell_smi_get_security_key(const char *password, u16 *key)
+{
+    return find_security_key(password, password, key, 0, 0);
+}
+
+/*************************************/
+/********* security context **********/
+/*************************************/
+
+struct dell_smi_security
+{
+    char *pass_ascii;
+    char *pass_scancode;
+    bool resolved;
+    int status;     // dell_smi_get_security_key() style return code
+    u16 key;
+    int which;      // password type that produced the key
+    int format;     // DELL_SMI_PASSWORD_FMT_* of that password
+};
+
+static char *dup_password(const char *pw)
+{
+    char *ret = 0;
+    if (pw)
+    {
+        size_t len = strlen(pw) + 1;
+        ret = calloc(1, len);
+        if (ret)
+            memcpy(ret, pw, len);
+    }
+    return ret;
+}
+
+static void free_password(char *pw)
+{
+    if (pw)
+    {
+        // dont leave passwords lying around in freed heap memory
+        volatile char *p = pw;
+        while (*p)
+            *p++ = 0;
+        free(pw);
+    }
+}
+
+struct dell_smi_security *dell_smi_security_new(const char *pass_ascii, const char *pass_scancode)
+{
+    struct dell_smi_security *sec = calloc(1, sizeof(struct dell_smi_security));
+    fnprintf("\n");
+    if (!sec)
+        goto out;
+
+    sec->pass_ascii = dup_password(pass_ascii);
+    sec->pass_scancode = dup_password(pass_scancode);
+    if ((pass_ascii && !sec->pass_ascii) || (pass_scancode && !sec->pass_scancode))
+    {
+        dell_smi_security_free(sec);
+        sec = 0;
+    }
+
+out:
+    return sec;
+}
+
+void dell_smi_security_free(struct dell_smi_security *sec)
+{
+    if (!sec)
+        return;
+    free_password(sec->pass_ascii);
+    free_password(sec->pass_scancode);
+    memset(sec, 0, sizeof(*sec));
+    free(sec);
+}
+
+void dell_smi_security_invalidate(struct dell_smi_security *sec)
+{
+    if (sec)
+        sec->resolved = false;
+}
+
+static void resolve_security(struct dell_smi_security *sec)
+{
+    if (sec->resolved)
+        return;
+
+    fnprintf("verifying password\n");
+    sec->key = 0;
+    sec->status = find_security_key(sec->pass_ascii, sec->pass_scancode, &sec->key, &sec->which, &sec->format);
+    // an smi failure may be transient, only remember definite answers
+    sec->resolved = (sec->status != -2);
+}
+
+int dell_smi_security_get_key(struct dell_smi_security *sec, u16 *key)
+{
+    int retval = -2;
+    if (!sec)
+        goto out;
+
+    resolve_security(sec);
+    retval = sec->status;
+    if (key)
+        *key = sec->key;
+
+out:
+    return retval;
+}
+
+int dell_smi_security_password_type(struct dell_smi_security *sec)
+{
+    if (!sec)
+        return DELL_SMI_PASSWORD_ANY;
+    resolve_security(sec);
+    return sec->which;
+}
+
+int dell_smi_security_password_format(struct dell_smi_security *sec)
+{
+    if (!sec)
+        return DELL_SMI_PASSWORD_FMT_SCANCODE;
+    resolve_security(sec);
+    return sec->format;
+}
+
 
 
 bool dell_smi_is_password_present(int which)
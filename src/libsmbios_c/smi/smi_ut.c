@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+
+// Include compat.h first, then system headers, then public, then private
+#include "smbios_c/compat.h"
+
+// system
+#include <stdlib.h>
+
+// public
+#include "smbios_c/obj/smi.h"
+#include "smbios_c/types.h"
+
+// private
+#include "smi_impl.h"
+
+/*
+ * Loopback backend for unit tests, selected with DELL_SMI_UNIT_TEST_MODE and
+ * a NULL init function. Every request succeeds (cbRES1 == 0) and
+ *     cbRESn = cbARGn ^ (class << 16 | select)    for n = 2..4
+ * so a caller can tell whether it got the answer to its own request.
+ * Argument buffers are left as they are.
+ */
+
+static int loopback_execute(struct dell_smi_obj *this)
+{
+    u32 tag = (u32)this->smi_buf.smi_class << 16 | this->smi_buf.smi_select;
+    fnprintf(" %d/%d\n", this->smi_buf.smi_class, this->smi_buf.smi_select);
+
+    this->smi_buf.res[cbRES1] = 0;
+    for (int i=cbARG2; i<=cbARG4; ++i)
+        this->smi_buf.res[i] = this->smi_buf.arg[i] ^ tag;
+    return 0;
+}
+
+int __hidden init_dell_smi_obj_loopback(struct dell_smi_obj *this)
+{
+    fnprintf("\n");
+    this->errstring = calloc(1, ERROR_BUFSIZE);
+    if (!this->errstring)
+        return -1;
+
+    // use the unit test tables when there are any, but do not need them
+    smi_read_smbios_info(this);
+    this->execute = loopback_execute;
+    this->initialized = 1;
+    return 0;
+}
@@ -38,5 +38,16 @@ int __hidden init_dell_smi_obj(struct dell_smi_obj *this)
     return -1;
 }
 
+// no thread support here yet: every caller shares the singleton
+struct dell_smi_obj __hidden *smi_thread_obj(void)
+{
+    return 0;
+}
 
+void __hidden smi_setup_lock(void)
+{
+}
 
+void __hidden smi_setup_unlock(void)
+{
+}
@@ -24,7 +24,9 @@
 
 #include "smbios_c/obj/token.h"
 #include "smbios_c/token.h"
+#include "smbios_c/obj/cmos.h"
 #include "smbios_c/cmos.h"
+#include "smbios_c/obj/smbios.h"
 #include "smbios_c/smbios.h"
 #include "smbios_c/smi.h"
 #include "smbios_c/system_info.h"
@@ -38,14 +40,10 @@ static char *getAssetTagFromSysEncl()
     return smbios_struct_get_string_from_table(System_Enclosure_or_Chassis_Structure, System_Enclosure_or_Chassis_Asset_Offset);
 }
 
-// not static so we can use it in unit test, but not part of public API.
-// you have been warned.
-char *getAssetTagFromToken()
+__hidden char *getAssetTagFromCMOS(const struct smbios_table *table, const struct cmos_access_obj *cmos)
 {
-    const struct smbios_struct *s;
+    struct d4_string str;
     char *tag = 0;
-    u16 indexPort, dataPort;
-    u8  location;
     u8 csum = 0;
     u8 byte;
     int ret;
@@ -54,22 +52,19 @@ char *getAssetTagFromToken()
 
     // Step 1: Get tag from CMOS
     fnprintf("- get string\n");
-    size_t len = 0;
-    tag = token_get_string(Cmos_Asset_Token, &len);  // allocates mem
+    if (!find_d4_string(table, Cmos_Asset_Token, &str))
+        goto out_err;
+    tag = read_d4_string(cmos, &str);  // allocates mem
     if (!tag)
         goto out_err;
 
     // Step 3: Make sure checksum is good before returning value
     fnprintf("- csum\n");
-    s = token_get_smbios_struct(Cmos_Asset_Token);
-    indexPort = ((struct indexed_io_access_structure*)s)->indexPort;
-    dataPort = ((struct indexed_io_access_structure*)s)->dataPort;
-    location = ((struct indexed_io_token *)token_get_ptr(Cmos_Asset_Token))->location;
 
     // calc checksum
     for( u32 i = 0; i < ASSET_TAG_CMOS_LEN_MAX; i++)
     {
-        ret = cmos_read_byte(&byte, indexPort, dataPort, location + i);
+        ret = cmos_obj_read_byte(cmos, &byte, str.indexPort, str.dataPort, str.location + i);
         if (ret<0)
             goto out_err;
 
@@ -77,7 +72,7 @@ char *getAssetTagFromToken()
     }
 
     // get checksum byte
-    ret = cmos_read_byte(&byte, indexPort, dataPort, location + ASSET_TAG_CMOS_LEN_MAX);
+    ret = cmos_obj_read_byte(cmos, &byte, str.indexPort, str.dataPort, str.location + ASSET_TAG_CMOS_LEN_MAX);
     if (ret<0)
         goto out_err;
 
@@ -97,6 +92,18 @@ out_err:
     return NULL;
 }
 
+// not static so we can use it in unit test, but not part of public API.
+// you have been warned.
+char *getAssetTagFromToken()
+{
+    struct smbios_table *table = smbios_table_factory(SMBIOS_GET_SINGLETON);
+    struct cmos_access_obj *cmos = cmos_obj_factory(CMOS_GET_SINGLETON);
+    char *tag = getAssetTagFromCMOS(table, cmos);
+    cmos_obj_free(cmos);
+    smbios_table_free(table);
+    return tag;
+}
+
 static char *getAssetTagFromSMI()
 {
     fnprintf("\n");
@@ -108,22 +115,30 @@ static char *getAssetTagFromSMI()
 static struct DellAssetTagFunctions
 {
     char *(*f_ptr)();
+    enum sysinfo_source src;
 } DellAssetTagFunctions[] = {
-                              {&getAssetTagFromSysEncl,}, // SMBIOS System Information Item
-                              {&getAssetTagFromToken,},   // SMBIOS CMOS Token
-                              {&getAssetTagFromSMI,},     // SMI
+                              {&getAssetTagFromSysEncl, SYSINFO_SRC_ENCLOSURE,}, // SMBIOS System Information Item
+                              {&getAssetTagFromToken, SYSINFO_SRC_CMOS,},   // SMBIOS CMOS Token
+                              {&getAssetTagFromSMI, SYSINFO_SRC_SMI,},     // SMI
                           };
 
-LIBSMBIOS_C_DLL_SPEC char *sysinfo_get_asset_tag()
+LIBSMBIOS_C_DLL_SPEC char *sysinfo_get_asset_tag_src(int sources, enum sysinfo_source *src)
 {
     char *assetTag = 0;
+    enum sysinfo_source found = SYSINFO_SRC_NONE;
     int numEntries =
         sizeof (DellAssetTagFunctions) / sizeof (DellAssetTagFunctions[0]);
 
     sysinfo_clearerr();
     fnprintf("\n");
+    if (tag_cache_get(CACHED_ASSET_TAG, sources, &assetTag, &found))
+        goto out;
+
     for (int i = 0; (i < numEntries) && (!assetTag); ++i)
     {
+        if (!(sources & SYSINFO_SOURCE_BIT(DellAssetTagFunctions[i].src)))
+            continue;
+
         fnprintf("Call fn pointer %p\n", DellAssetTagFunctions[i].f_ptr);
         // first function to return non-zero id with strlen()>0 wins.
         assetTag = DellAssetTagFunctions[i].f_ptr ();
@@ -138,27 +153,40 @@ LIBSMBIOS_C_DLL_SPEC char *sysinfo_get_asset_tag()
             free(assetTag);
             assetTag = NULL;
         }
+        else
+            found = DellAssetTagFunctions[i].src;
     }
 
     if (!assetTag)
         assetTag = strdup(ASSET_TAG_NOT_SPECIFIED);
+
+    if (sources == SYSINFO_ALL_SOURCES)
+        tag_cache_put(CACHED_ASSET_TAG, assetTag, found);
+
+out:
+    if (src)
+        *src = found;
     return assetTag;
 }
 
+LIBSMBIOS_C_DLL_SPEC char *sysinfo_get_asset_tag()
+{
+    return sysinfo_get_asset_tag_src(SYSINFO_ALL_SOURCES, 0);
+}
+
 
 //
 // SET FUNCTIONS
 //
 
-static int setAssetTagUsingCMOSToken(const char *newTag, const char *pass_ascii, const char *pass_scancode)
+static int setAssetTagUsingCMOSToken(const char *newTag, struct dell_smi_security *sec)
 {
     const struct smbios_struct *s;
     u16 indexPort, dataPort;
     u8  location, csum = 0, byte;
     int retval = -1, ret;
 
-    UNREFERENCED_PARAMETER(pass_ascii);
-    UNREFERENCED_PARAMETER(pass_scancode);
+    UNREFERENCED_PARAMETER(sec);
     fnprintf("\n");
 
     // Step 1: write tag to CMOS
@@ -197,14 +225,11 @@ out:
 }
 
 
-static int setAssetTagUsingSMI(const char *newTag, const char *pass_ascii, const char *pass_scancode)
+static int setAssetTagUsingSMI(const char *newTag, struct dell_smi_security *sec)
 {
     int retval = 0, ret;
     u16 security_key = 0;
-    const char *whichpw = pass_scancode;
-    if (dell_smi_password_format(DELL_SMI_PASSWORD_ADMIN) == DELL_SMI_PASSWORD_FMT_ASCII)
-        whichpw=pass_ascii;
-    ret = dell_smi_get_security_key(whichpw, &security_key);
+    ret = dell_smi_security_get_key(sec, &security_key);
     retval = -2;
     if (ret)  // bad password
         goto out;
@@ -223,13 +248,13 @@ out:
 // Code for getting the service tag from one of many locations
 static struct DellSetAssetTagFunctions
 {
-    int (*f_ptr)(const char *, const char *, const char *);
+    int (*f_ptr)(const char *, struct dell_smi_security *);
 } DellSetAssetTagFunctions[] = {
                                  {&setAssetTagUsingSMI},   // SMBIOS System Information Item
                                  {&setAssetTagUsingCMOSToken},   // SMBIOS System Information Item
                              };
 
-LIBSMBIOS_C_DLL_SPEC int sysinfo_set_asset_tag(const char *assetTag, const char *pass_ascii, const char *pass_scancode)
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_asset_tag_security(const char *assetTag, struct dell_smi_security *sec)
 {
     int ret = -1;
     int numEntries = sizeof (DellSetAssetTagFunctions) / sizeof (DellSetAssetTagFunctions[0]);
@@ -240,8 +265,19 @@ LIBSMBIOS_C_DLL_SPEC int sysinfo_set_asset_tag(const char *assetTag, const char
     {
         fnprintf("Call fn pointer %p\n", DellSetAssetTagFunctions[i].f_ptr);
         // first function to return non-zero id with strlen()>0 wins.
-        ret = DellSetAssetTagFunctions[i].f_ptr (assetTag, pass_ascii, pass_scancode);
+        ret = DellSetAssetTagFunctions[i].f_ptr (assetTag, sec);
     }
+    tag_cache_invalidate(CACHED_ASSET_TAG);
+    return ret;
+}
+
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_asset_tag(const char *assetTag, const char *pass_ascii, const char *pass_scancode)
+{
+    int ret = -1;
+    struct dell_smi_security *sec = dell_smi_security_new(pass_ascii, pass_scancode);
+    if (sec)
+        ret = sysinfo_set_asset_tag_security(assetTag, sec);
+    dell_smi_security_free(sec);
     return ret;
 }
 
@@ -23,7 +23,8 @@
 #include <stdlib.h>
 
 #include "smbios_c/system_info.h"
-#include "smbios_c/memory.h"
+#include "smbios_c/obj/memory.h"
+#include "smbios_c/obj/smbios.h"
 #include "smbios_c/smbios.h"
 
 #include "dell_magic.h"
@@ -34,7 +35,7 @@
 // ID Byte functions
 //
 //
-__hidden u16 get_id_byte_from_mem ()
+__hidden u16 get_id_byte_from_mem_obj (const struct memory_access_obj *m)
 {
     u16 tempWord = 0;
     u16 idWord = 0;
@@ -44,14 +45,14 @@ __hidden u16 get_id_byte_from_mem ()
     struct two_byte_structure tbs;
 
     // Step 1: Check that "Dell System" is present at the proper offset
-    ret = memory_read(strBuf, DELL_SYSTEM_STRING_LOC, DELL_SYSTEM_STRING_LEN-1);
+    ret = memory_obj_read(m, strBuf, DELL_SYSTEM_STRING_LOC, DELL_SYSTEM_STRING_LEN-1);
     if (ret<0) goto out;
 
     if( strncmp( strBuf, DELL_SYSTEM_STRING, DELL_SYSTEM_STRING_LEN ) != 0 )
         goto out;
 
     // Step 2: fill the id structs
-    ret = memory_read(&tbs, TWO_BYTE_STRUCT_LOC, sizeof(struct two_byte_structure) );
+    ret = memory_obj_read(m, &tbs, TWO_BYTE_STRUCT_LOC, sizeof(struct two_byte_structure) );
     if (ret<0) goto out;
 
     // Step 3: check the checksum of one-byte struct
@@ -78,20 +79,28 @@ out:
     return idWord;
 }
 
+__hidden u16 get_id_byte_from_mem ()
+{
+    struct memory_access_obj *m = memory_obj_factory(MEMORY_GET_SINGLETON);
+    u16 idWord = get_id_byte_from_mem_obj(m);
+    memory_obj_free(m);
+    return idWord;
+}
+
 
-__hidden u16 get_id_byte_from_mem_diamond()
+__hidden u16 get_id_byte_from_mem_diamond_obj(const struct memory_access_obj *m)
 {
     u16 idWord = 0;
     char strBuf[DELL_SYSTEM_STRING_LEN] = { 0, };
     int ret;
 
     // Step 1: Check that "Dell System" is present at the proper offset
-    ret = memory_read(strBuf, DELL_SYSTEM_STRING_LOC_DIAMOND_1, DELL_SYSTEM_STRING_LEN - 1);
+    ret = memory_obj_read(m, strBuf, DELL_SYSTEM_STRING_LOC_DIAMOND_1, DELL_SYSTEM_STRING_LEN - 1);
 
     if( ret>=0 && strncmp( strBuf, DELL_SYSTEM_STRING, DELL_SYSTEM_STRING_LEN ) == 0 )
     {
         u8 idByte = 0;
-        ret = memory_read(&idByte, ID_BYTE_LOC_DIAMOND_1, sizeof(idByte));
+        ret = memory_obj_read(m, &idByte, ID_BYTE_LOC_DIAMOND_1, sizeof(idByte));
         if( ret>=0 && SYSTEM_ID_DIAMOND == idByte )
         {
             idWord = SYSTEM_ID_DIAMOND;
@@ -99,11 +108,11 @@ __hidden u16 get_id_byte_from_mem_diamond()
         }
     }
 
-    ret = memory_read(strBuf, DELL_SYSTEM_STRING_LOC_DIAMOND_2, DELL_SYSTEM_STRING_LEN - 1);
+    ret = memory_obj_read(m, strBuf, DELL_SYSTEM_STRING_LOC_DIAMOND_2, DELL_SYSTEM_STRING_LEN - 1);
     if( (ret>=0) && (strncmp( strBuf, DELL_SYSTEM_STRING, DELL_SYSTEM_STRING_LEN ) == 0 ))
     {
         u8 idByte = 0;
-        ret = memory_read(&idByte, ID_BYTE_LOC_DIAMOND_2, sizeof(idByte));
+        ret = memory_obj_read(m, &idByte, ID_BYTE_LOC_DIAMOND_2, sizeof(idByte));
         if( ret>=0 && SYSTEM_ID_DIAMOND == idByte )
         {
             idWord = SYSTEM_ID_DIAMOND;
@@ -115,72 +124,62 @@ out:
     return idWord;
 }
 
+__hidden u16 get_id_byte_from_mem_diamond()
+{
+    struct memory_access_obj *m = memory_obj_factory(MEMORY_GET_SINGLETON);
+    u16 idWord = get_id_byte_from_mem_diamond_obj(m);
+    memory_obj_free(m);
+    return idWord;
+}
+
 
-__hidden const char * get_dell_oem_string_by_tag (int tag)
+// id from the value of a Dell oem strings item "N[XX]", XX in hex
+__hidden u16 get_id_from_table_oem_tag (const struct smbios_table *table, int tag)
 {
-    // search through 0x0B (OEM_Strings_Structure) items
-    smbios_for_each_struct_type( s, OEM_Strings ) {
-        // first string must be "Dell System" per spec
-        const char *str = smbios_struct_get_string_number(s, 1);
-        if ((!str) || (0 != strncmp (str, DELL_SYSTEM_STRING, strlen(DELL_SYSTEM_STRING)))) {
-            str = 0;
-            continue;
-        }
+    const char *value = smbios_table_get_dell_oem_tag(table, tag);
+    return value ? strtol(value, NULL, 16) : 0;
+}
 
-        int i=2; // start searching string table from second string (first was searched above)
-        while ( (str = smbios_struct_get_string_number(s, i++)) ){
-            char *endptr = 0;
-            long strtag = strtol(str, &endptr, 10);
-            if(strlen(str) > 3 && strtag == tag && endptr[0] == '[')
-                return str;
-        }
-    }
-    return 0;
+static u16 get_id_from_oem_tag (int tag)
+{
+    struct smbios_table *table = smbios_table_factory(SMBIOS_GET_SINGLETON);
+    u16 idWord = get_id_from_table_oem_tag(table, tag);
+    smbios_table_free(table);
+    return idWord;
 }
 
 __hidden u16 get_dell_id_byte_from_oem_item ()
 {
-    u16 idWord = 0;
     // Tag # for oem string table Dell ID tag is '1'
     // see docs for dell oem strings table (0x0b)
-    const char *str = get_dell_oem_string_by_tag(1);
-
-    //  Id byte is in second string in table 0x0B
-    //  the format is "1[NN]", where NN is the idbyte;
-    //  note the &str[2] below to skip the 'n['
-    if(str && strlen(str) > 3 && str[0] == '1' && str[1] == '[')
-        idWord = strtol( &str[2], NULL, 16 );
-
-    return idWord;
+    return get_id_from_oem_tag(OEM_String_Dell_System_ID_Tag);
 }
 
 __hidden u16 get_oem_id_byte_from_oem_item ()
 {
-    u16 idWord = 0;
     // Tag # for oem string table reseller ID tag is '7'
     // see docs for dell oem strings table (0x0b)
-    const char *str = get_dell_oem_string_by_tag(7);
-
-    //  Id byte is in second string in table 0x0B
-    //  the format is "1[NN]", where NN is the idbyte;
-    //  note the &str[2] below to skip the 'n['
-    if(str && strlen(str) > 3 && str[0] == '7' && str[1] == '[')
-        idWord = strtol( &str[2], NULL, 16 );
+    return get_id_from_oem_tag(OEM_String_Reseller_System_ID_Tag);
+}
 
+__hidden u16 get_id_from_rev_and_id_struct (const struct smbios_struct *s)
+{
+    u16 idWord = 0;
+    //If byte field is 0xFE, we need to look in the extension field
+    smbios_struct_get_data(s, &idWord, 0x06, 1);
+    if( 0xFE == idWord )
+    {
+        smbios_struct_get_data(s, &idWord, 0x08, 2);
+    }
     return idWord;
 }
 
 __hidden u16 get_id_byte_from_rev_and_id_structure ()
 {
     u16 idWord = 0;
-    // search through 0x0B (Revisions_and_IDs_Structure)
+    // search through 0xD0 (Revisions_and_IDs_Structure)
     smbios_for_each_struct_type( s, Dell_Revisions_and_IDs ) {
-        //If byte field is 0xFE, we need to look in the extension field
-        smbios_struct_get_data(s, &idWord, 0x06, 1);
-        if( 0xFE == idWord )
-        {
-            smbios_struct_get_data(s, &idWord, 0x08, 2);
-        }
+        idWord = get_id_from_rev_and_id_struct(s);
     }
     return idWord;
 }
@@ -213,44 +212,81 @@ DellOemIdByteFunctions[] = {
     };
 
 
-LIBSMBIOS_C_DLL_SPEC int sysinfo_get_dell_oem_system_id()
+static u16 run_id_chain(const struct DellIdByteFunctions *fns, int numEntries)
 {
-    int systemId = 0;
-    int numEntries =
-        sizeof (DellOemIdByteFunctions) / sizeof (DellOemIdByteFunctions[0]);
-
-    sysinfo_clearerr();
+    u16 systemId = 0;
     for (int i = 0; i < numEntries; ++i)
     {
-        fnprintf("calling id_byte function: %s\n",
-                 DellOemIdByteFunctions[i].name);
+        fnprintf("calling id_byte function: %s\n", fns[i].name);
         // first function to return non-zero id wins.
-        systemId = DellOemIdByteFunctions[i].f_ptr ();
+        systemId = fns[i].f_ptr ();
 
         if (systemId)
             break;
     }
-
     return systemId;
 }
 
-LIBSMBIOS_C_DLL_SPEC int sysinfo_get_dell_system_id()
+static u16 dell_id_chain()
 {
-    int systemId = 0;
-    int numEntries =
-        sizeof (DellIdByteFunctions) / sizeof (DellIdByteFunctions[0]);
+    return run_id_chain(DellIdByteFunctions, sizeof (DellIdByteFunctions) / sizeof (DellIdByteFunctions[0]));
+}
 
-    sysinfo_clearerr();
-    for (int i = 0; i < numEntries; ++i)
-    {
-        fnprintf("calling id_byte function: %s\n", DellIdByteFunctions[i].name);
-        // first function to return non-zero id wins.
-        systemId = DellIdByteFunctions[i].f_ptr ();
+static u16 oem_id_chain()
+{
+    return run_id_chain(DellOemIdByteFunctions, sizeof (DellOemIdByteFunctions) / sizeof (DellOemIdByteFunctions[0]));
+}
 
-        if (systemId)
-            break;
-    }
+// one id from the boot scoped cache, computing and adding it on a miss
+static u16 cached_id(u64 table_hash, int which, u16 (*compute)())
+{
+    struct sysinfo_id_cache c;
+    u16 *id = which == ID_CACHE_MEM_ID ? &c.mem_id : which == ID_CACHE_DELL_ID ? &c.dell_id : &c.oem_id;
+
+    if (!id_cache_enabled())
+        return compute();
+
+    if (id_cache_read(table_hash, &c) < 0)
+        memset(&c, 0, sizeof(c));
+    if (c.have & which)
+        return *id;
+
+    // a failed lookup is retried next time, not kept for the whole boot
+    *id = compute();
+    if (!*id)
+        return 0;
+    c.have |= which;
+    id_cache_write(table_hash, &c);
+    return *id;
+}
 
-    return systemId;
+// the table fixups need this while the table itself is still being set up
+__hidden u16 get_id_byte_from_mem_cached(u64 table_hash)
+{
+    return cached_id(table_hash, ID_CACHE_MEM_ID, get_id_byte_from_mem);
+}
+
+static u16 cached_table_id(int which, u16 (*compute)())
+{
+    if (!id_cache_enabled())
+        return compute();
+
+    // on a hit the singleton table is never set up
+    u64 hash = smbios_singleton_get_hash();
+    if (!hash)
+        return compute();
+
+    return cached_id(hash, which, compute);
+}
+
+LIBSMBIOS_C_DLL_SPEC int sysinfo_get_dell_oem_system_id()
+{
+    sysinfo_clearerr();
+    return cached_table_id(ID_CACHE_OEM_ID, oem_id_chain);
 }
 
+LIBSMBIOS_C_DLL_SPEC int sysinfo_get_dell_system_id()
+{
+    sysinfo_clearerr();
+    return cached_table_id(ID_CACHE_DELL_ID, dell_id_chain);
+}
@@ -35,7 +35,7 @@
 
 // prepackaged smi functions
 #define PROPERTY_TAG_LEN 80
-LIBSMBIOS_C_DLL_SPEC const char *sysinfo_get_property_ownership_tag()
+LIBSMBIOS_C_DLL_SPEC char *sysinfo_get_property_ownership_tag()
 {
     char *retval = 0;
     const char *error = 0;
@@ -88,11 +88,10 @@ out:
     return retval;
 }
 
-LIBSMBIOS_C_DLL_SPEC int sysinfo_set_property_ownership_tag(const char *newTag, const char *pass_ascii, const char *pass_scancode)
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_property_ownership_tag_security(const char *newTag, struct dell_smi_security *sec)
 {
     struct dell_smi_obj *smi;
     u16 security_key = 0;
-    const char *whichpw = pass_scancode;
     u8 *buf;
     const char *error = 0;
     char *errbuf;
@@ -107,9 +106,7 @@ LIBSMBIOS_C_DLL_SPEC int sysinfo_set_property_ownership_tag(const char *newTag,
         goto out_fail;
 
     fnprintf(" get security key\n");
-    if (dell_smi_password_format(DELL_SMI_PASSWORD_ADMIN) == DELL_SMI_PASSWORD_FMT_ASCII)
-        whichpw=pass_ascii;
-    ret = dell_smi_get_security_key(whichpw, &security_key);
+    ret = dell_smi_security_get_key(sec, &security_key);
     switch (ret) {
         case -1:
             error = _("Could not validate password.");
@@ -151,4 +148,12 @@ out:
     return retval;
 }
 
-
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_property_ownership_tag(const char *newTag, const char *pass_ascii, const char *pass_scancode)
+{
+    int retval = -2;
+    struct dell_smi_security *sec = dell_smi_security_new(pass_ascii, pass_scancode);
+    if (sec)
+        retval = sysinfo_set_property_ownership_tag_security(newTag, sec);
+    dell_smi_security_free(sec);
+    return retval;
+}
@@ -21,9 +21,11 @@
 
 #include <string.h>
 #include <stdlib.h>
-#include <ctype.h>  // toupper
+#include <ctype.h>  // isalpha
 
+#include "smbios_c/obj/smbios.h"
 #include "smbios_c/smbios.h"
+#include "smbios_c/obj/cmos.h"
 #include "smbios_c/obj/token.h"
 #include "smbios_c/token.h"
 #include "smbios_c/cmos.h"
@@ -33,131 +35,189 @@
 #include "sysinfo_impl.h"
 
 /***********************************************
- * specialty functions to decode dell service tag
+ * specialty functions to encode/decode dell service tag
  *
- * note: funny naming for the following functions
- *       as they were copied from another project
+ * A 7-char tag is coded into the 5 bytes of cmos space:
+ *
+ *    byte       byte        byte        byte         byte
+ *     0           1           2           3           4
+ *|----|----| |----|----| |----|----| |----|----| |----|----|
+ * 1  0 0000     11 1112   2222 3333   3444 4455   5556 6666
+ *     char0     char1  char2    char3  char4  char5    char6
+ *
+ * char0 is stored as is, with the high bit set to indicate a coded tag.
+ * chars 1-6 are 5 bit digits. Tags of up to 5 chars are stored uncoded.
  **********************************************/
-static unsigned char dell_decode_digit( char tagval )
+
+// digit -> ascii. digits are 0-9 and the consonants; 0x1F has no character
+// and decodes to '[', as it always has.
+static const char svc_tag_chars[32] = "0123456789BCDFGHJKLMNPQRSTVWXYZ[";
+
+// ascii -> digit, 0xFF for characters that cannot be coded. lower case is
+// accepted and comes back upper case.
+#define SVC_TAG_NO_DIGIT 0xFF
+static const u8 svc_tag_digits[128] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0x0a, 0x0b, 0x0c, 0xff, 0x0d, 0x0e, 0x0f, 0xff, 0x10, 0x11, 0x12, 0x13, 0x14, 0xff,
+    0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0x0a, 0x0b, 0x0c, 0xff, 0x0d, 0x0e, 0x0f, 0xff, 0x10, 0x11, 0x12, 0x13, 0x14, 0xff,
+    0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+static bool svc_tag_char_ok(char ch)
 {
-    // input == value from 0 - 0x1E
-    // output == ascii
-    // --> take value from range 0 - 0x1E and give ascii value
-    if( tagval > 0x19 )
-        tagval += 0x3C;   /* V-Z, 0x1A-0x1E */
-    else if( tagval > 0x14 )
-        tagval += 0x3B;   /* P-T, 0x15-0x19 */
-    else if( tagval > 0x0F )
-        tagval += 0x3A;   /* J-N, 0x10-0x14 */
-    else if( tagval > 0x0C )
-        tagval += 0x39;   /* F-H, 0x0D-0x0F */
-    else if( tagval > 0x09 )
-        tagval += 0x38;   /* B-D, 0x0A-0x0C */
-    else
-        tagval += 0x30;   /* 0-9, 0x00-0x09 */
+    return !(ch & 0x80) && svc_tag_digits[(u8)ch] != SVC_TAG_NO_DIGIT;
+}
 
-    return tagval;
+// the six digits of a coded tag, char1 in the top bits
+static u32 svc_tag_word(const u8 *image)
+{
+    return (u32)image[1] << 24 | (u32)image[2] << 16 | (u32)image[3] << 8 | image[4];
 }
 
-// decodes tag in-place
-// see encoding function for nice ascii art representation.
-static void dell_decode_service_tag( char *new_tag, char *tag, int len )
+// decodes one cmos image into tag[SVC_TAG_LEN_MAX + 1]. returns SYSINFO_SVC_TAG_* bits
+static int decode_service_tag(const u8 *image, char *tag)
 {
-    memcpy(new_tag, tag, len);
-    if( ((tag)[0] & (1<<7)) == (1<<7) )
+    int status = 0;
+
+    memset(tag, 0, SVC_TAG_LEN_MAX + 1);
+    if (!(image[0] & 0x80))
     {
-        new_tag[6] = dell_decode_digit( (tag[4] & 0x1F) );
-        new_tag[5] = dell_decode_digit( ((tag[3] & 0x03)<<3) | ((tag[4]>>5) & 0x07) );
-        new_tag[4] = dell_decode_digit( ((tag[3] & 0x7C)>>2) );
-        new_tag[3] = dell_decode_digit( (((tag[2] & 0x0F)<<1) | ((tag[3]>>7) & 0x01)) );
-        new_tag[2] = dell_decode_digit( (((tag[1] & 0x01)<<4) | ((tag[2]>>4) & 0xF)) & 0x1F);
-        new_tag[1] = dell_decode_digit( ((tag[1] & 0x3E)>>1) & 0x1F );
-        new_tag[0] = (tag[0] ^ (1<<7));
-        memset(tag, 0, len);
+        memcpy(tag, image, SVC_TAG_CMOS_LEN_MAX);
+        for (int i = 0; tag[i]; ++i)
+            if (!svc_tag_char_ok(tag[i]))
+                status |= SYSINFO_SVC_TAG_BAD_CHAR;
+        return status | SYSINFO_SVC_TAG_UNCODED;
     }
-}
 
-static unsigned char dell_encode_digit( char ch )
-{
-    // input == ascii
-    // output == value from 0 - 0x1E
-    // scale ascii value down to range 0-0x1E
-    // valid input ascii == Alphanumeric - vowels
-    // invalid input is converted to the char '0' (zero)
-    int uc = toupper(ch);
-    unsigned char retval = 0;
-    if ( uc >= '0' && uc <= '9' )
-        retval = uc - 0x30;
-    if ( uc >= 'B' && uc <= 'D' )
-        retval = uc - 0x38;
-    if ( uc >= 'F' && uc <= 'H' )
-        retval = uc - 0x39;
-    if ( uc >= 'J' && uc <= 'N' )
-        retval = uc - 0x3A;
-    if ( uc >= 'P' && uc <= 'T' )
-        retval = uc - 0x3B;
-    if ( uc >= 'V' && uc <= 'Z' )
-        retval = uc - 0x3C;
-    return retval;
+    u32 word = svc_tag_word(image);
+    tag[0] = image[0] ^ 0x80;
+    if (!svc_tag_char_ok(tag[0]))
+        status |= SYSINFO_SVC_TAG_BAD_CHAR;
+    for (int i = 1; i < SVC_TAG_LEN_MAX; ++i)
+    {
+        u8 digit = (word >> (5 * (SVC_TAG_LEN_MAX - 1 - i))) & 0x1F;
+        if (digit == 0x1F)
+            status |= SYSINFO_SVC_TAG_BAD_CHAR;
+        tag[i] = svc_tag_chars[digit];
+    }
+    return status;
 }
 
-static void dell_encode_service_tag( char *tag, size_t len )
+// codes all 7 chars of 'chars' into image[SVC_TAG_CMOS_LEN_MAX]. characters
+// that cannot be coded become '0'.
+static int code_service_tag(const char *chars, u8 *image)
 {
-    char tagToSet[SVC_TAG_LEN_MAX] = {0,};
-    char newTagBuf[SVC_TAG_CMOS_LEN_MAX] = {0,};
+    int status = 0;
+    u32 word = 0;
 
-    if (len <= SVC_TAG_CMOS_LEN_MAX)
-        return;
+    if (!svc_tag_char_ok(chars[0]))
+        status |= SYSINFO_SVC_TAG_BAD_CHAR;
+    for (int i = 1; i < SVC_TAG_LEN_MAX; ++i)
+    {
+        u8 digit = 0;
+        if (svc_tag_char_ok(chars[i]))
+            digit = svc_tag_digits[(u8)chars[i]];
+        else if (chars[i])  // a 6 char tag codes its missing char as '0'
+            status |= SYSINFO_SVC_TAG_BAD_CHAR;
+        word = (word << 5) | digit;
+    }
 
-    // codes a 7-char value into 5 bytes
-    //
-    //    byte       byte        byte        byte         byte
-    //     0           1           2           3           4
-    //|----|----| |----|----| |----|----| |----|----| |----|----|
-    // 1  0 0000     11 1112   2222 3333   3444 4455   5556 6666
-    //     char0     char1  char2    char3  char4  char5    char6
-    //
-    // note: high bit set in byte0 to indicate coded tag.
+    image[0] = chars[0] | 0x80;
+    image[1] = word >> 24;
+    image[2] = word >> 16;
+    image[3] = word >> 8;
+    image[4] = word;
+    return status;
+}
 
-    memcpy(tagToSet, tag, len < SVC_TAG_LEN_MAX ? len : SVC_TAG_LEN_MAX );
+// encodes one nul terminated tag the way it is stored in cmos
+static int encode_service_tag(const char *tag, u8 *image)
+{
+    char chars[SVC_TAG_LEN_MAX] = {0,};
+    size_t len = strnlen(tag, SVC_TAG_LEN_MAX + 1);
+    int status = 0;
 
-    // char 0
-    newTagBuf[0] = tagToSet[0] | 1<<7;
+    if (len > SVC_TAG_LEN_MAX)
+    {
+        status |= SYSINFO_SVC_TAG_TOO_LONG;
+        len = SVC_TAG_LEN_MAX;
+    }
 
-    // char 1
-    newTagBuf[1] = dell_encode_digit(tagToSet[1]) << 1;
+    memset(image, 0, SVC_TAG_CMOS_LEN_MAX);
+    if (len <= SVC_TAG_CMOS_LEN_MAX)
+    {
+        memcpy(image, tag, len);
+        for (size_t i = 0; i < len; ++i)
+            if (!svc_tag_char_ok(tag[i]))
+                status |= SYSINFO_SVC_TAG_BAD_CHAR;
+        return status | SYSINFO_SVC_TAG_UNCODED;
+    }
 
-    // char 2
-    newTagBuf[1] = newTagBuf[1] | dell_encode_digit(tagToSet[2]) >> 4;
-    newTagBuf[2] = dell_encode_digit(tagToSet[2]) << 4;
+    memcpy(chars, tag, len);
+    return status | code_service_tag(chars, image);
+}
 
-    // char 3
-    newTagBuf[2] = newTagBuf[2] | dell_encode_digit(tagToSet[3]) >> 1;
-    newTagBuf[3] = dell_encode_digit(tagToSet[3]) << 7;
+LIBSMBIOS_C_DLL_SPEC size_t sysinfo_decode_service_tags(const u8 *images, size_t count, char *tags, int *status)
+{
+    size_t good = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        int st = decode_service_tag(images + i * SVC_TAG_CMOS_LEN_MAX, tags + i * (SVC_TAG_LEN_MAX + 1));
+        if (!(st & SYSINFO_SVC_TAG_ERRORS))
+            ++good;
+        if (status)
+            status[i] = st;
+    }
+    return good;
+}
 
-    // char 4
-    newTagBuf[3] = newTagBuf[3] | dell_encode_digit(tagToSet[4]) << 2;
+LIBSMBIOS_C_DLL_SPEC size_t sysinfo_encode_service_tags(const char *tags, size_t count, u8 *images, int *status)
+{
+    size_t good = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        int st = encode_service_tag(tags + i * (SVC_TAG_LEN_MAX + 1), images + i * SVC_TAG_CMOS_LEN_MAX);
+        if (!(st & SYSINFO_SVC_TAG_ERRORS))
+            ++good;
+        if (status)
+            status[i] = st;
+    }
+    return good;
+}
 
-    // char 5
-    newTagBuf[3] = newTagBuf[3] | dell_encode_digit(tagToSet[5]) >> 3;
-    newTagBuf[4] = dell_encode_digit(tagToSet[5]) << 5;
+// decodes tag in-place
+static void dell_decode_service_tag( char *new_tag, char *tag, int len )
+{
+    memcpy(new_tag, tag, len);
+    if( len >= SVC_TAG_CMOS_LEN_MAX && (tag[0] & 0x80) )
+    {
+        decode_service_tag((const u8 *)tag, new_tag);
+        memset(tag, 0, len);
+    }
+}
 
-    // char 6
-    newTagBuf[4] = newTagBuf[4] | dell_encode_digit(tagToSet[6]);
+static void dell_encode_service_tag( char *tag, size_t len )
+{
+    char tagToSet[SVC_TAG_LEN_MAX] = {0,};
+
+    if (len <= SVC_TAG_CMOS_LEN_MAX)
+        return;
 
+    memcpy(tagToSet, tag, len < SVC_TAG_LEN_MAX ? len : SVC_TAG_LEN_MAX );
     memset(tag, 0, len);
-    memcpy(tag, newTagBuf, SVC_TAG_CMOS_LEN_MAX);
-    return;
+    code_service_tag(tagToSet, (u8 *)tag);
 }
 
 
-static char *getServiceTagFromCMOSToken()
+__hidden char *getServiceTagFromCMOS(const struct smbios_table *table, const struct cmos_access_obj *cmos)
 {
-    const struct smbios_struct *s;
+    struct d4_string str;
     char *tempval = 0;
     char *tag = 0;
-    u16 indexPort, dataPort;
-    u8  location;
     u8 csum = 0;
     u8 byte;
     int ret;
@@ -166,34 +226,31 @@ static char *getServiceTagFromCMOSToken()
 
     // Step 1: Get tag from CMOS
     fnprintf("- get string\n");
-    size_t len = 0;
-    tempval = token_get_string(Cmos_Service_Token, &len);  // allocates mem
+    if (!find_d4_string(table, Cmos_Service_Token, &str))
+        goto out_err;
+    tempval = read_d4_string(cmos, &str);  // allocates mem
     if (!tempval)
         goto out_err;
 
-    //fnprintf("- current string: '%s', len: %zd, strlen %zd, tagsize %d", tempval, len, strlen(tempval), SVC_TAG_CMOS_LEN_MAX);
+    //fnprintf("- current string: '%s', len: %d, strlen %zd, tagsize %d", tempval, str.length, strlen(tempval), SVC_TAG_CMOS_LEN_MAX);
 
     // if we got a value, we have to allocate a larger buffer to hold the result
     tag = calloc(1, SVC_TAG_LEN_MAX + 1);
 
     // Step 2: Decode 7-char tag from 5-char CMOS value
     fnprintf("- decode string\n");
-    dell_decode_service_tag(tag, tempval, len);
+    dell_decode_service_tag(tag, tempval, str.length);
     free(tempval);
     tempval = 0;
     fnprintf("- GOT: '%s'\n", tag);
 
     // Step 3: Make sure checksum is good before returning value
     fnprintf("- csum: ");
-    s = token_get_smbios_struct(Cmos_Service_Token);
-    indexPort = ((struct indexed_io_access_structure*)s)->indexPort;
-    dataPort = ((struct indexed_io_access_structure*)s)->dataPort;
-    location = ((struct indexed_io_token *)token_get_ptr(Cmos_Service_Token))->location;
 
     // calc checksum
     for( u32 i = 0; i < SVC_TAG_CMOS_LEN_MAX; i++)
     {
-        ret = cmos_read_byte(&byte, indexPort, dataPort, location + i);
+        ret = cmos_obj_read_byte(cmos, &byte, str.indexPort, str.dataPort, str.location + i);
         if (ret<0)
             goto out_err;
 
@@ -204,7 +261,7 @@ static char *getServiceTagFromCMOSToken()
     dbg_printf("\n");
 
     // get checksum byte
-    ret = cmos_read_byte(&byte, indexPort, dataPort, location + SVC_TAG_CMOS_LEN_MAX);
+    ret = cmos_obj_read_byte(cmos, &byte, str.indexPort, str.dataPort, str.location + SVC_TAG_CMOS_LEN_MAX);
     if (ret<0)
         goto out_err;
 
@@ -225,6 +282,16 @@ out:
     return tag;
 }
 
+__hidden char *getServiceTagFromCMOSToken()
+{
+    struct smbios_table *table = smbios_table_factory(SMBIOS_GET_SINGLETON);
+    struct cmos_access_obj *cmos = cmos_obj_factory(CMOS_GET_SINGLETON);
+    char *tag = getServiceTagFromCMOS(table, cmos);
+    cmos_obj_free(cmos);
+    smbios_table_free(table);
+    return tag;
+}
+
 static char *getServiceTagFromSysInfo()
 {
     fnprintf("\n");
@@ -238,21 +305,14 @@ static char *getServiceTagFromSysEncl()
 }
 
 
-/* only for service/asset tags. */
-__hidden char *getTagFromSMI(u16 select)
+/* only for service/asset tags. turns a successful read tag smi result into
+ * an allocated string */
+__hidden char *getTagFromSMIResult(const u32 res[4])
 {
-    u32 args[4] = {0,0,0,0}, res[4] = {0,0,0,0};
-    char *retval = 0;
-    int ret = 0;
-    fnprintf("\n");
-    ret = dell_simple_ci_smi(11, select, args, res);
-
-    fnprintf("res[0] = %d\n", (unsigned int)res[0]);
-    if (ret || res[0])
+    char *retval = calloc(1, MAX_SMI_TAG_SIZE + 1); // smi function can hold at most 12 bytes, add one for '\0'
+    if (!retval)
         goto out;
-
-    retval = calloc(1, MAX_SMI_TAG_SIZE + 1); // smi function can hold at most 12 bytes, add one for '\0'
-    memcpy(retval, (u8 *)(&(res[1])), MAX_SMI_TAG_SIZE);
+    memcpy(retval, (const u8 *)(&(res[1])), MAX_SMI_TAG_SIZE);
 
     fnprintf("raw = ");
     for(int i=0; i<MAX_SMI_TAG_SIZE; i++)
@@ -272,6 +332,21 @@ out:
     return retval;
 }
 
+/* only for service/asset tags. */
+__hidden char *getTagFromSMI(u16 select)
+{
+    u32 args[4] = {0,0,0,0}, res[4] = {0,0,0,0};
+    int ret = 0;
+    fnprintf("\n");
+    ret = dell_simple_ci_smi(11, select, args, res);
+
+    fnprintf("res[0] = %d\n", (unsigned int)res[0]);
+    if (ret || res[0])
+        return 0;
+
+    return getTagFromSMIResult(res);
+}
+
 
 static char *getServiceTagFromSMI()
 {
@@ -286,23 +361,31 @@ static char *getServiceTagFromSMI()
 static struct DellGetServiceTagFunctions
 {
     char *(*f_ptr)();
+    enum sysinfo_source src;
 } DellGetServiceTagFunctions[] = {
-                                   {&getServiceTagFromSysInfo,},   // SMBIOS System Information Item
-                                   {&getServiceTagFromSysEncl,},   // SMBIOS System Enclosure Item
-                                   {&getServiceTagFromSMI,},       // SMI Token
-                                   {&getServiceTagFromCMOSToken,}, // CMOS Token
+                                   {&getServiceTagFromSysInfo, SYSINFO_SRC_SYSTEM_INFO,},   // SMBIOS System Information Item
+                                   {&getServiceTagFromSysEncl, SYSINFO_SRC_ENCLOSURE,},   // SMBIOS System Enclosure Item
+                                   {&getServiceTagFromSMI, SYSINFO_SRC_SMI,},       // SMI Token
+                                   {&getServiceTagFromCMOSToken, SYSINFO_SRC_CMOS,}, // CMOS Token
                                };
 
-LIBSMBIOS_C_DLL_SPEC char *sysinfo_get_service_tag()
+LIBSMBIOS_C_DLL_SPEC char *sysinfo_get_service_tag_src(int sources, enum sysinfo_source *src)
 {
     char *serviceTag = 0;
+    enum sysinfo_source found = SYSINFO_SRC_NONE;
     int numEntries =
         sizeof (DellGetServiceTagFunctions) / sizeof (DellGetServiceTagFunctions[0]);
 
     sysinfo_clearerr();
     fnprintf("\n");
+    if (tag_cache_get(CACHED_SERVICE_TAG, sources, &serviceTag, &found))
+        goto out;
+
     for (int i = 0; (i < numEntries) && (!serviceTag); ++i)
     {
+        if (!(sources & SYSINFO_SOURCE_BIT(DellGetServiceTagFunctions[i].src)))
+            continue;
+
         fnprintf("Call fn pointer %p\n", DellGetServiceTagFunctions[i].f_ptr);
         // first function to return non-zero id with strlen()>0 wins.
         serviceTag = DellGetServiceTagFunctions[i].f_ptr ();
@@ -316,11 +399,25 @@ LIBSMBIOS_C_DLL_SPEC char *sysinfo_get_service_tag()
                 free(serviceTag);
                 serviceTag=0;
             }
+            else
+                found = DellGetServiceTagFunctions[i].src;
         }
     }
+
+    if (sources == SYSINFO_ALL_SOURCES)
+        tag_cache_put(CACHED_SERVICE_TAG, serviceTag, found);
+
+out:
+    if (src)
+        *src = found;
     return serviceTag;
 }
 
+LIBSMBIOS_C_DLL_SPEC char *sysinfo_get_service_tag()
+{
+    return sysinfo_get_service_tag_src(SYSINFO_ALL_SOURCES, 0);
+}
+
 
 
 /* only for service/asset tags. */
@@ -338,7 +435,7 @@ __hidden u32 setTagUsingSMI(u16 select, const char *newTag, u16 security_key)
         return 0;
 }
 
-int setServiceTagUsingCMOSToken(const char *newTag, const char *pass_ascii, const char *pass_scancode)
+static int setServiceTagUsingCMOSToken(const char *newTag, struct dell_smi_security *sec)
 {
     const struct smbios_struct *s;
     u16 indexPort, dataPort;
@@ -346,8 +443,7 @@ int setServiceTagUsingCMOSToken(const char *newTag, const char *pass_ascii, cons
     int retval = -1, ret;
     char codedTag[SVC_TAG_LEN_MAX + 1] = {0,}; // null padded
 
-    UNREFERENCED_PARAMETER(pass_ascii);
-    UNREFERENCED_PARAMETER(pass_scancode);
+    UNREFERENCED_PARAMETER(sec);
 
     // don't want to modify user-supplied buffer, so copy new tag
     // to our own buffer.
@@ -419,15 +515,12 @@ out:
 /*  Only the manufacturing software that’s loading the service tag into the system should use this interface.
     Some systems may return an error when the service tag has already been set (i.e. they prevent this function from changing the service tag once it has been set).
     */
-int setServiceTagUsingSMI(const char *newTag, const char *pass_ascii, const char *pass_scancode)
+static int setServiceTagUsingSMI(const char *newTag, struct dell_smi_security *sec)
 {
     int retval = 0;
     u16 security_key = 0;
-    const char *whichpw = pass_scancode;
-    if (dell_smi_password_format(DELL_SMI_PASSWORD_ADMIN) == DELL_SMI_PASSWORD_FMT_ASCII)
-        whichpw=pass_ascii;
     retval = -2;
-    if(dell_smi_get_security_key(whichpw, &security_key))
+    if(dell_smi_security_get_key(sec, &security_key))
         goto out;
 
     retval = -1;
@@ -444,7 +537,7 @@ out:
 struct DellSetServiceTagFunctions
 {
     const char *name;
-    int (*f_ptr)(const char *, const char *, const char *);
+    int (*f_ptr)(const char *, struct dell_smi_security *);
 }
 
 DellSetServiceTagFunctions[] = {
@@ -452,7 +545,7 @@ DellSetServiceTagFunctions[] = {
                                    {"setServiceTagUsingCMOSToken", &setServiceTagUsingCMOSToken,},   // SMBIOS System Information Item
                                };
 
-LIBSMBIOS_C_DLL_SPEC int sysinfo_set_service_tag(const char *serviceTag, const char *pass_ascii, const char *pass_scancode)
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_service_tag_security(const char *serviceTag, struct dell_smi_security *sec)
 {
     int ret = -1;
     int numEntries =
@@ -464,7 +557,18 @@ LIBSMBIOS_C_DLL_SPEC int sysinfo_set_service_tag(const char *serviceTag, const c
     {
         fnprintf("Call fn pointer to %s\n", DellSetServiceTagFunctions[i].name);
         // first function to return non-zero id with strlen()>0 wins.
-        ret = DellSetServiceTagFunctions[i].f_ptr (serviceTag, pass_ascii, pass_scancode);
+        ret = DellSetServiceTagFunctions[i].f_ptr (serviceTag, sec);
     }
+    tag_cache_invalidate(CACHED_SERVICE_TAG);
+    return ret;
+}
+
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_service_tag(const char *serviceTag, const char *pass_ascii, const char *pass_scancode)
+{
+    int ret = -1;
+    struct dell_smi_security *sec = dell_smi_security_new(pass_ascii, pass_scancode);
+    if (sec)
+        ret = sysinfo_set_service_tag_security(serviceTag, sec);
+    dell_smi_security_free(sec);
     return ret;
 }
@@ -0,0 +1,305 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+#include "smbios_c/compat.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "smbios_c/obj/cmos.h"
+#include "smbios_c/obj/memory.h"
+#include "smbios_c/obj/smbios.h"
+#include "smbios_c/obj/smi.h"
+#include "smbios_c/smbios.h"
+#include "smbios_c/smi.h"
+#include "smbios_c/system_info.h"
+#include "dell_magic.h"
+#include "sysinfo_impl.h"
+
+/*
+ * sysinfo_snapshot(): the same lookup chains as the individual getters in
+ * id_byte.c, service_tag.c and asset_tag.c, but every smbios structure they
+ * look at is found in a single table walk (oem strings items come from the
+ * table's tag index), memory is opened once for both
+ * id chains, and both smi tag reads go out as one batch. Tags share the
+ * cache of the tag getters.
+ *
+ * sysinfo_snapshot_from() runs the same chains over objects the caller
+ * hands in, and leaves out everything that belongs to the running system:
+ * the tag cache and smi.
+ */
+
+enum { STR_VENDOR, STR_SYSTEM, STR_BIOS, STR_SERVICE, STR_ASSET, NUM_STRINGS };
+
+// where a snapshot is read from
+struct sources
+{
+    const struct smbios_table *table;
+    struct memory_access_obj *memory;   // may be 0
+    const struct cmos_access_obj *cmos; // may be 0
+    bool this_system;   // tag cache and smi apply
+};
+
+struct gathered
+{
+    char *str[NUM_STRINGS];
+    enum sysinfo_source src[NUM_STRINGS];
+    bool cached[NUM_STRINGS];   // tag answered by tag_cache.c, even if 0
+};
+
+// keeps the first usable value for a field. takes ownership of 'str'.
+// the tag chains move on from empty strings, the plain getters do not.
+static void take_string(struct gathered *g, int field, char *str, enum sysinfo_source src)
+{
+    if (!str)
+        return;
+
+    strip_trailing_whitespace(str);
+    bool chained = (field == STR_SERVICE || field == STR_ASSET);
+    if (g->str[field] || g->cached[field] || (chained && !strlen(str)))
+    {
+        free(str);
+        return;
+    }
+    fnprintf(" field %d from source %d: '%s'\n", field, src, str);
+    g->str[field] = str;
+    g->src[field] = src;
+}
+
+static void take_struct_string(struct gathered *g, int field, const struct smbios_struct *s, u8 offset, enum sysinfo_source src)
+{
+    const char *r = 0;
+    if (s)
+        r = smbios_struct_get_string_from_offset(s, offset);
+    if (r)
+        take_string(g, field, strdup(r), src);
+}
+
+static void read_smi_tags(struct gathered *g)
+{
+    struct dell_smi_request req[2];
+    int field[2];
+    size_t n = 0;
+
+    memset(req, 0, sizeof(req));
+    if (!g->str[STR_SERVICE] && !g->cached[STR_SERVICE])
+    {
+        req[n].smi_class = 11;
+        req[n].select = 2; /* Read service tag select code */
+        field[n++] = STR_SERVICE;
+    }
+    if (!g->str[STR_ASSET] && !g->cached[STR_ASSET])
+    {
+        req[n].smi_class = 11;
+        req[n].select = 0; /* Read asset tag select code */
+        field[n++] = STR_ASSET;
+    }
+    if (!n)
+        return;
+
+    struct dell_smi_obj *smi = dell_smi_factory(DELL_SMI_DEFAULTS);
+    if (!smi)
+        return;
+
+    if (dell_smi_obj_execute_batch(smi, req, n) >= 0)
+        for (size_t i=0; i<n; ++i)
+            if (!req[i].retval && !req[i].res[cbRES1])
+                take_string(g, field[i], getTagFromSMIResult(req[i].res), SYSINFO_SRC_SMI);
+
+    dell_smi_obj_free(smi);
+}
+
+// walks the id chain, reusing memory results. 'mem' is filled in on first use
+static int pick_id(const struct sources *from, u16 diamond, u16 oem_item, u16 rev_and_id, u16 *mem, bool *mem_read, enum sysinfo_source *src)
+{
+    *src = SYSINFO_SRC_MEMORY;
+    if (diamond)
+        return diamond;
+
+    *src = SYSINFO_SRC_OEM_STRINGS;
+    if (oem_item)
+        return oem_item;
+
+    *src = SYSINFO_SRC_REV_AND_ID;
+    if (rev_and_id)
+        return rev_and_id;
+
+    if (!*mem_read)
+    {
+        *mem = from->memory ? get_id_byte_from_mem_obj(from->memory) : 0;
+        *mem_read = true;
+    }
+    *src = SYSINFO_SRC_MEMORY;
+    if (*mem)
+        return *mem;
+
+    *src = SYSINFO_SRC_NONE;
+    return 0;
+}
+
+static struct sysinfo_snapshot *gather(const struct sources *from)
+{
+    struct gathered g;
+    struct sysinfo_snapshot *snap = 0;
+    const struct smbios_struct *bios = 0, *sys = 0, *encl = 0;
+    u16 rev_and_id = 0;
+
+    fnprintf("\n");
+    memset(&g, 0, sizeof(g));
+    if (from->this_system)
+    {
+        g.cached[STR_SERVICE] = tag_cache_get(CACHED_SERVICE_TAG, SYSINFO_ALL_SOURCES, &g.str[STR_SERVICE], &g.src[STR_SERVICE]);
+        g.cached[STR_ASSET] = tag_cache_get(CACHED_ASSET_TAG, SYSINFO_ALL_SOURCES, &g.str[STR_ASSET], &g.src[STR_ASSET]);
+    }
+
+    // 1: one pass over the table. like the getters, only the first structure
+    // of each standard type counts; the last 0xD0 wins.
+    smbios_table_for_each_struct(from->table, s) {
+        switch (smbios_struct_get_type(s))
+        {
+        case BIOS_Information_Structure:
+            bios = bios ? bios : s;
+            break;
+        case System_Information_Structure:
+            sys = sys ? sys : s;
+            break;
+        case System_Enclosure_or_Chassis_Structure:
+            encl = encl ? encl : s;
+            break;
+        case Dell_Revisions_and_IDs:
+            rev_and_id = get_id_from_rev_and_id_struct(s);
+            break;
+        }
+    }
+
+    take_struct_string(&g, STR_VENDOR, sys, System_Information_Manufacturer_Offset, SYSINFO_SRC_SYSTEM_INFO);
+    take_struct_string(&g, STR_SYSTEM, sys, System_Information_Product_Name_Offset, SYSINFO_SRC_SYSTEM_INFO);
+    take_struct_string(&g, STR_BIOS, bios, BIOS_Information_Version_Offset, SYSINFO_SRC_BIOS_INFO);
+    take_struct_string(&g, STR_SERVICE, sys, System_Information_Serial_Number_Offset, SYSINFO_SRC_SYSTEM_INFO);
+    take_struct_string(&g, STR_SERVICE, encl, System_Enclosure_or_Chassis_Service_Offset, SYSINFO_SRC_ENCLOSURE);
+    take_struct_string(&g, STR_ASSET, encl, System_Enclosure_or_Chassis_Asset_Offset, SYSINFO_SRC_ENCLOSURE);
+
+    // 2: one memory session for both id chains
+    int sysid, oemid;
+    enum sysinfo_source sysid_src, oemid_src;
+    u16 mem = 0, diamond = 0;
+    bool mem_read = false;
+    memory_obj_suggest_leave_open(from->memory);
+
+    if (from->memory)
+        diamond = get_id_byte_from_mem_diamond_obj(from->memory);
+    sysid = pick_id(from, diamond, get_id_from_table_oem_tag(from->table, OEM_String_Dell_System_ID_Tag),
+                    rev_and_id, &mem, &mem_read, &sysid_src);
+    oemid = pick_id(from, diamond, get_id_from_table_oem_tag(from->table, OEM_String_Reseller_System_ID_Tag),
+                    rev_and_id, &mem, &mem_read, &oemid_src);
+
+    memory_obj_suggest_close(from->memory);
+
+    // 3: cmos and smi, in the order the getters try them
+    if (!g.str[STR_ASSET] && !g.cached[STR_ASSET] && from->cmos)
+        take_string(&g, STR_ASSET, getAssetTagFromCMOS(from->table, from->cmos), SYSINFO_SRC_CMOS);
+    if (from->this_system)
+        read_smi_tags(&g);
+    if (!g.str[STR_SERVICE] && !g.cached[STR_SERVICE] && from->cmos)
+        take_string(&g, STR_SERVICE, getServiceTagFromCMOS(from->table, from->cmos), SYSINFO_SRC_CMOS);
+    if (!g.str[STR_ASSET])
+        g.str[STR_ASSET] = strdup(ASSET_TAG_NOT_SPECIFIED);
+
+    if (from->this_system && !g.cached[STR_SERVICE])
+        tag_cache_put(CACHED_SERVICE_TAG, g.str[STR_SERVICE], g.src[STR_SERVICE]);
+    if (from->this_system && !g.cached[STR_ASSET])
+        tag_cache_put(CACHED_ASSET_TAG, g.str[STR_ASSET], g.src[STR_ASSET]);
+
+    // 4: pack into a single allocation
+    size_t size = sizeof(*snap);
+    for (int i=0; i<NUM_STRINGS; ++i)
+        if (g.str[i])
+            size += strlen(g.str[i]) + 1;
+
+    snap = calloc(1, size);
+    if (!snap)
+        goto out;
+
+    const char **dest[NUM_STRINGS] = {
+        &snap->vendor_name, &snap->system_name, &snap->bios_version,
+        &snap->service_tag, &snap->asset_tag,
+    };
+    enum sysinfo_source *dest_src[NUM_STRINGS] = {
+        &snap->vendor_name_src, &snap->system_name_src, &snap->bios_version_src,
+        &snap->service_tag_src, &snap->asset_tag_src,
+    };
+    char *strings = (char *)(snap + 1);
+    for (int i=0; i<NUM_STRINGS; ++i)
+    {
+        *dest_src[i] = g.src[i];
+        if (!g.str[i])
+            continue;
+        strcpy(strings, g.str[i]);
+        *dest[i] = strings;
+        strings += strlen(strings) + 1;
+    }
+
+    snap->dell_system_id = sysid;
+    snap->dell_system_id_src = sysid_src;
+    snap->dell_oem_system_id = oemid;
+    snap->dell_oem_system_id_src = oemid_src;
+
+out:
+    for (int i=0; i<NUM_STRINGS; ++i)
+        free(g.str[i]);
+    return snap;
+}
+
+LIBSMBIOS_C_DLL_SPEC struct sysinfo_snapshot *sysinfo_snapshot()
+{
+    struct sources from;
+    struct sysinfo_snapshot *snap;
+
+    sysinfo_clearerr();
+    from.table = smbios_table_factory(SMBIOS_GET_SINGLETON);
+    from.memory = memory_obj_factory(MEMORY_GET_SINGLETON);
+    from.cmos = cmos_obj_factory(CMOS_GET_SINGLETON);
+    from.this_system = true;
+
+    snap = gather(&from);
+
+    cmos_obj_free((struct cmos_access_obj *)from.cmos);
+    memory_obj_free(from.memory);
+    smbios_table_free((struct smbios_table *)from.table);
+    return snap;
+}
+
+LIBSMBIOS_C_DLL_SPEC struct sysinfo_snapshot *sysinfo_snapshot_from(const struct smbios_table *table, struct memory_access_obj *memory, const struct cmos_access_obj *cmos)
+{
+    struct sources from;
+
+    if (!table)
+        return 0;
+
+    from.table = table;
+    from.memory = memory;
+    from.cmos = cmos;
+    from.this_system = false;
+    return gather(&from);
+}
+
+LIBSMBIOS_C_DLL_SPEC void sysinfo_snapshot_free(struct sysinfo_snapshot *snap)
+{
+    free(snap);
+}
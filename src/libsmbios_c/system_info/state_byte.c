@@ -24,22 +24,102 @@
 #include <stdlib.h>
 
 #include "smbios_c/system_info.h"
-#include "smbios_c/token.h"
+#include "smbios_c/obj/token.h"
+#include "smbios_c/cmos.h"
+#include "smbios_c/obj/smbios.h"
 #include "smbios_c/smbios.h"
 
 #include "dell_magic.h"
 #include "sysinfo_impl.h"
 
-LIBSMBIOS_C_DLL_SPEC int sysinfo_has_nvram_state_bytes()
+// where the two state bytes live in cmos. looked up once per process,
+// straight from the 0xD4 structures, without building the token table.
+// each byte is the first of its token string.
+static struct
 {
-    int retval = 1;
-    if ( 0xD4 != token_get_type( NvramByte1_Token )  )
-        retval = 0;
-    if ( 0xD4 != token_get_type( NvramByte2_Token )  )
-        retval = 0;
+    bool resolved;
+    bool present;
+    bool checksums;  // checksum observers registered
+    struct d4_string byte[2];
+} nvram;
+
+static bool resolve_state_byte(u16 id, struct d4_string *b)
+{
+    struct smbios_table *table = smbios_table_factory(SMBIOS_GET_SINGLETON);
+    bool found = find_d4_string(table, id, b);
+    smbios_table_free(table);
+    return found;
+}
+
+static bool resolve_state_bytes(void)
+{
+    sysinfo_lock();
+    if (!nvram.resolved)
+    {
+        nvram.present = resolve_state_byte(NvramByte1_Token, &nvram.byte[0])
+                     && resolve_state_byte(NvramByte2_Token, &nvram.byte[1]);
+        nvram.resolved = true;
+    }
+    sysinfo_unlock();
+    return nvram.present;
+}
+
+// both bytes, low byte from NvramByte1_Token. < 0 on failure
+static int read_state_bytes(void)
+{
+    int retval = 0;
+    if (!resolve_state_bytes())
+        return -1;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        const struct d4_string *b = &nvram.byte[i];
+        u8 byte;
+        if (cmos_read_byte(&byte, b->indexPort, b->dataPort, b->location) < 0)
+            return -1;
+        retval |= byte << (8 * i);
+    }
+    return retval;
+}
+
+// writes both bytes with a single checksum update at the end
+static int write_state_bytes(u16 value)
+{
+    int retval = 0;
+    if (!resolve_state_bytes())
+        return -1;
+
+    sysinfo_lock();
+    for (int i = 0; i < 2 && !nvram.checksums; ++i)
+        for (int j = 0; j < nvram.byte[i].length; ++j)
+            if (setup_d4_checksums_covering(nvram.byte[i].indexPort, nvram.byte[i].location + j) < 0)
+                retval = -1;
+    nvram.checksums = !retval;
+    sysinfo_unlock();
+    if (retval)
+        return retval;
+
+    cmos_begin_write_batch();
+    for (int i = 0; i < 2; ++i)
+    {
+        const struct d4_string *b = &nvram.byte[i];
+        // like token_set_string(): the rest of the token string is cleared
+        for (int j = 0; j < b->length && !retval; ++j)
+        {
+            u8 byte = j ? 0 : (u8)(value >> (8 * i));
+            if (cmos_write_byte(byte, b->indexPort, b->dataPort, b->location + j) < 0)
+                retval = -1;
+        }
+    }
+    cmos_end_write_batch();
     return retval;
 }
 
+LIBSMBIOS_C_DLL_SPEC int sysinfo_has_nvram_state_bytes()
+{
+    return resolve_state_bytes() ? 1 : 0;
+}
+
 
 // user =
 //      0x0000 = DSA
@@ -53,18 +133,9 @@ LIBSMBIOS_C_DLL_SPEC int sysinfo_has_nvram_state_bytes()
 //      0xF000 = expand to whole byte
 LIBSMBIOS_C_DLL_SPEC int sysinfo_get_nvram_state_bytes( int user )
 {
-    char *string;
-    int retval = 0;
-
-    string = token_get_string( NvramByte1_Token, 0 );
-    if (string)
-        retval = ((u8 *)string)[0];
-    free(string);
-
-    string = token_get_string( NvramByte2_Token, 0 );
-    if (string)
-        retval |= ((u8 *)string)[0] << 8;
-    free(string);
+    int retval = read_state_bytes();
+    if (retval < 0)
+        retval = 0;
 
     if( user == 0x0000 )  // DSA
     {
@@ -114,12 +185,5 @@ LIBSMBIOS_C_DLL_SPEC void sysinfo_set_nvram_state_bytes(int user, int value)
         value |= user;      // set user
     }
 
-    char *tempdata = (char*)(&value);
-    token_set_string( NvramByte1_Token, tempdata, 1);
-    token_set_string( NvramByte2_Token, tempdata + 1, 1);
-
-    return;
+    write_state_bytes((u16)value);
 }
-
-
-
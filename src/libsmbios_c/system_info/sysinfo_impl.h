@@ -18,17 +18,90 @@
 #ifndef C_SYSINFO_H
 #define C_SYSINFO_H
 
+#include "smbios_c/system_info.h"
+
 #undef DEBUG_MODULE_NAME
 #define DEBUG_MODULE_NAME "DEBUG_SYSINFO_C"
 
 #define MAX_SMI_TAG_SIZE 12
 #define ERROR_BUFSIZE 1024
 
+struct smbios_struct;
+struct smbios_table;
+struct cmos_access_obj;
+struct memory_access_obj;
+
 __hidden void sysinfo_clearerr();
 __hidden char *sysinfo_get_module_error_buf();
 __hidden char * smbios_struct_get_string_from_table(u8 type, u8 offset);
 __hidden void strip_trailing_whitespace( char *str );
 __hidden char *getTagFromSMI(u16 select);
+__hidden char *getTagFromSMIResult(const u32 res[4]);
+__hidden char *getServiceTagFromCMOSToken();
+__hidden char *getServiceTagFromCMOS(const struct smbios_table *, const struct cmos_access_obj *);
+char *getAssetTagFromToken();
+__hidden char *getAssetTagFromCMOS(const struct smbios_table *, const struct cmos_access_obj *);
+__hidden u16 get_id_byte_from_mem();
+__hidden u16 get_id_byte_from_mem_obj(const struct memory_access_obj *);
+__hidden u16 get_id_byte_from_mem_diamond();
+__hidden u16 get_id_byte_from_mem_diamond_obj(const struct memory_access_obj *);
+__hidden u16 get_id_from_table_oem_tag(const struct smbios_table *, int tag);
+__hidden u16 get_id_from_rev_and_id_struct(const struct smbios_struct *s);
+
+// os layer: guards process wide sysinfo state
+__hidden void sysinfo_lock(void);
+__hidden void sysinfo_unlock(void);
+
+// os layer: boot scoped on-disk id cache, see sysinfo_id_cache_set_dir().
+// entries are keyed by boot and the hash of the smbios table they belong to
+#define ID_CACHE_MEM_ID     0x01    // get_id_byte_from_mem(), for table fixups
+#define ID_CACHE_DELL_ID    0x02    // sysinfo_get_dell_system_id()
+#define ID_CACHE_OEM_ID     0x04    // sysinfo_get_dell_oem_system_id()
+struct sysinfo_id_cache
+{
+    int have;   // ID_CACHE_* bits of the ids below that are valid
+    u16 mem_id;
+    u16 dell_id;
+    u16 oem_id;
+};
+__hidden bool id_cache_enabled(void);
+// returns < 0 if disabled or there is no entry for this boot and table
+__hidden int  id_cache_read(u64 table_hash, struct sysinfo_id_cache *);
+__hidden void id_cache_write(u64 table_hash, const struct sysinfo_id_cache *);
+__hidden u16 get_id_byte_from_mem_cached(u64 table_hash);
+
+// smbios layer
+__hidden u64 smbios_table_get_hash(const struct smbios_table *);
+__hidden u64 smbios_singleton_get_hash(void);
+__hidden bool smbios_singleton_get_path(const char **path);
+
+// os layer: kernel's decoded copy of an smbios string, see SYSINFO_FORCE_TABLE.
+// 'name' is a file in /sys/class/dmi/id. returns 0 if not available
+__hidden char *dmi_id_read(const char *name);
+
+// token layer: cmos checksum observers for one byte, see token_d4.c
+__hidden int setup_d4_checksums_covering(u32 indexPort, u32 offset);
+struct indexed_io_access_structure;
+struct indexed_io_token;
+__hidden const struct indexed_io_token *find_d4_token(const struct smbios_table *, u16 id, const struct indexed_io_access_structure **);
+
+// a 0xD4 string token's bytes in cmos, found without the token table
+struct d4_string
+{
+    u16 indexPort;
+    u16 dataPort;
+    u8  location;
+    u8  length;
+};
+__hidden bool find_d4_string(const struct smbios_table *, u16 id, struct d4_string *);
+// allocated, 0 terminated copy of the token string, or 0 on a cmos error
+__hidden char *read_d4_string(const struct cmos_access_obj *, const struct d4_string *);
+
+// service/asset tag cache (tag_cache.c). get returns an allocated copy
+enum { CACHED_SERVICE_TAG, CACHED_ASSET_TAG, NUM_CACHED_TAGS };
+__hidden bool tag_cache_get(int which, int sources, char **tag, enum sysinfo_source *src);
+__hidden void tag_cache_put(int which, const char *tag, enum sysinfo_source src);
+__hidden void tag_cache_invalidate(int which);
 __hidden u32 setTagUsingSMI(u16 select, const char *, u16);
 
 #endif
@@ -0,0 +1,259 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+#include "smbios_c/compat.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>     // PATH_MAX
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "smbios_c/system_info.h"
+#include "smbios_c/types.h"
+#include "internal_strl.h"
+#include "sysinfo_impl.h"
+
+#define BOOT_ID_FILE    "/proc/sys/kernel/random/boot_id"
+#define BOOT_ID_LEN     36
+#define ID_CACHE_FILE   "system-id"
+#define ID_CACHE_MAGIC  "libsmbios-id-cache-1"
+
+static pthread_mutex_t sysinfo_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void __hidden sysinfo_lock(void)
+{
+    pthread_mutex_lock(&sysinfo_mutex);
+}
+
+void __hidden sysinfo_unlock(void)
+{
+    pthread_mutex_unlock(&sysinfo_mutex);
+}
+
+
+/*
+ * Boot scoped system id cache. The ids come from the bios image and the
+ * smbios table, so they cannot change before the next boot. One small text
+ * file per directory:
+ *     libsmbios-id-cache-1 <boot_id> <table hash> <have> <mem> <dell> <oem>
+ * Only files owned by root or by us, in a directory owned by root or by us
+ * that nobody else can write to, are trusted.
+ */
+
+static char *id_cache_dir; // 0 == disabled
+
+// the environment only switches the cache on, in the fixed root owned
+// directory. secure_getenv(): setuid callers do not let their user turn it on
+__attribute__((constructor)) static void id_cache_initialize(void)
+{
+    const char *env = secure_getenv("LIBSMBIOS_C_ID_CACHE");
+    if (env && atoi(env) > 0)
+        id_cache_dir = strdup(SYSINFO_ID_CACHE_DEFAULT_DIR);
+}
+
+__attribute__((destructor)) static void id_cache_return_mem(void)
+{
+    free(id_cache_dir);
+    id_cache_dir = 0;
+}
+
+LIBSMBIOS_C_DLL_SPEC int sysinfo_id_cache_set_dir(const char *dir)
+{
+    char *copy = 0;
+    if (dir && !(copy = strdup(dir)))
+        return -1;
+
+    sysinfo_lock();
+    free(id_cache_dir);
+    id_cache_dir = copy;
+    sysinfo_unlock();
+    return 0;
+}
+
+__hidden bool id_cache_enabled(void)
+{
+    return id_cache_dir != 0;
+}
+
+static int get_boot_id(char *boot_id)
+{
+    int retval = -1;
+    FILE *f = fopen(BOOT_ID_FILE, "r");
+    if (!f)
+        return retval;
+    if (fgets(boot_id, BOOT_ID_LEN + 1, f) && strlen(boot_id) == BOOT_ID_LEN)
+        retval = 0;
+    fclose(f);
+    return retval;
+}
+
+static int cache_path(char *path, size_t len)
+{
+    if (!id_cache_dir)
+        return -1;
+    if ((size_t)snprintf(path, len, "%s/%s", id_cache_dir, ID_CACHE_FILE) >= len)
+        return -1;
+    return 0;
+}
+
+// others could plant a link or swap the file in a directory they can write
+static bool cache_dir_trusted(void)
+{
+    struct stat st;
+    if (stat(id_cache_dir, &st) || !S_ISDIR(st.st_mode))
+        return false;
+    if (st.st_uid != 0 && st.st_uid != geteuid())
+        return false;
+    return !(st.st_mode & (S_IWGRP | S_IWOTH));
+}
+
+__hidden int id_cache_read(u64 table_hash, struct sysinfo_id_cache *c)
+{
+    char path[PATH_MAX], boot_id[BOOT_ID_LEN + 1] = {0,}, line[128] = {0,};
+    char file_boot_id[BOOT_ID_LEN + 1] = {0,};
+    unsigned long long file_hash = 0;
+    unsigned int have, mem_id, dell_id, oem_id;
+    int retval = -1;
+    struct stat st;
+    FILE *f = 0;
+    int fd;
+
+    sysinfo_lock();
+    if (cache_path(path, sizeof(path)) || get_boot_id(boot_id) || !cache_dir_trusted())
+        goto out;
+
+    fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        goto out;
+    f = fdopen(fd, "r");
+    if (!f)
+    {
+        close(fd);
+        goto out;
+    }
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || (st.st_uid != 0 && st.st_uid != geteuid()))
+        goto out;
+    if (!fgets(line, sizeof(line), f))
+        goto out;
+
+    if (sscanf(line, ID_CACHE_MAGIC " %36s %llx %x %x %x %x", file_boot_id, &file_hash,
+                &have, &mem_id, &dell_id, &oem_id) != 6)
+        goto out;
+    if (strcmp(file_boot_id, boot_id) || file_hash != table_hash)
+        goto out;
+
+    c->have = have;
+    c->mem_id = mem_id;
+    c->dell_id = dell_id;
+    c->oem_id = oem_id;
+    retval = 0;
+
+out:
+    if (f)
+        fclose(f);
+    sysinfo_unlock();
+    fnprintf(" %s: %d\n", id_cache_dir, retval);
+    return retval;
+}
+
+// best effort: write a temp file and rename it over the old one, so
+// concurrent readers see either entry whole
+__hidden void id_cache_write(u64 table_hash, const struct sysinfo_id_cache *c)
+{
+    char path[PATH_MAX], tmp[PATH_MAX], boot_id[BOOT_ID_LEN + 1] = {0,};
+    FILE *f = 0;
+    int fd = -1;
+
+    sysinfo_lock();
+    if (cache_path(path, sizeof(path)) || get_boot_id(boot_id))
+        goto out;
+    if ((size_t)snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= sizeof(tmp))
+        goto out;
+
+    if (mkdir(id_cache_dir, 0755) && errno != EEXIST)
+        goto out;
+    if (!cache_dir_trusted())
+        goto out;
+
+    // unique name, created exclusively: never opens something already there
+    fd = mkstemp(tmp);
+    if (fd < 0)
+        goto out;
+    f = fchmod(fd, 0644) ? 0 : fdopen(fd, "w");
+    if (!f)
+    {
+        close(fd);
+        unlink(tmp);
+        goto out;
+    }
+
+    fprintf(f, ID_CACHE_MAGIC " %s %llx %x %x %x %x\n", boot_id, (unsigned long long)table_hash,
+            c->have, c->mem_id, c->dell_id, c->oem_id);
+    if (fclose(f) || rename(tmp, path))
+        unlink(tmp);
+
+out:
+    sysinfo_unlock();
+}
+
+
+/*
+ * The kernel decodes the common identity strings of the smbios table into
+ * small world readable files (serial numbers are root only), so most
+ * callers can skip loading the table. A unit test table directory may carry
+ * its own copy in an "id" subdirectory.
+ */
+#define DMI_ID_DIR      "/sys/class/dmi/id"
+#define DMI_ID_MAX      256
+
+__hidden char *dmi_id_read(const char *name)
+{
+    char path[PATH_MAX], buf[DMI_ID_MAX] = {0,};
+    const char *table_path;
+    char *retval = 0;
+    FILE *f;
+
+    if (!smbios_singleton_get_path(&table_path))
+        goto out;
+    if (table_path)
+        snprintf(path, sizeof(path), "%s/id/%s", table_path, name);
+    else
+        snprintf(path, sizeof(path), DMI_ID_DIR "/%s", name);
+
+    f = fopen(path, "r");
+    if (!f)
+        goto out;
+    if (fgets(buf, sizeof(buf), f))
+    {
+        buf[strcspn(buf, "\n")] = '\0';
+        strip_trailing_whitespace(buf);
+        if (strlen(buf))
+            retval = strdup(buf);
+    }
+    fclose(f);
+
+out:
+    fnprintf(" %s: %s\n", name, retval ? retval : "(none)");
+    return retval;
+}
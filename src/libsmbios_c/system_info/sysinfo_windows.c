@@ -0,0 +1,59 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+#include "smbios_c/compat.h"
+
+#include "smbios_c/system_info.h"
+#include "smbios_c/types.h"
+#include "sysinfo_impl.h"
+
+// no thread support here yet
+void __hidden sysinfo_lock(void)
+{
+}
+
+void __hidden sysinfo_unlock(void)
+{
+}
+
+// no boot scoped id cache yet
+LIBSMBIOS_C_DLL_SPEC int sysinfo_id_cache_set_dir(const char *dir)
+{
+    return -1;
+}
+
+__hidden bool id_cache_enabled(void)
+{
+    return false;
+}
+
+__hidden int id_cache_read(u64 table_hash, struct sysinfo_id_cache *c)
+{
+    return -1;
+}
+
+__hidden void id_cache_write(u64 table_hash, const struct sysinfo_id_cache *c)
+{
+}
+
+// no kernel dmi id files: always read the table
+__hidden char *dmi_id_read(const char *name)
+{
+    return 0;
+}
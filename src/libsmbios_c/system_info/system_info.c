@@ -22,12 +22,15 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "smbios_c/obj/cmos.h"
+#include "smbios_c/obj/token.h"
 #include "smbios_c/smbios.h"
 #include "smbios_c/system_info.h"
 #include "dell_magic.h"
 #include "sysinfo_impl.h"
 
 static char *module_error_buf; // auto-init to 0
+static int sysinfo_flags; // SYSINFO_* flags, auto-init to SYSINFO_DEFAULTS
 
 LIBSMBIOS_C_DLL_SPEC const char *smbios_get_library_version_string()
 {
@@ -93,6 +96,39 @@ void __hidden strip_trailing_whitespace( char *str )
     } while(ch);
 }
 
+LIBSMBIOS_C_DLL_SPEC int sysinfo_set_flags(int flags)
+{
+    int old = sysinfo_flags;
+    sysinfo_flags = flags;
+    return old;
+}
+
+// table strings the kernel also exports, by file name in /sys/class/dmi/id
+static const struct dmi_id_file
+{
+    u8 type;
+    u8 offset;
+    const char *name;
+} dmi_id_files[] = {
+    {BIOS_Information_Structure, BIOS_Information_Version_Offset, "bios_version"},
+    {System_Information_Structure, System_Information_Manufacturer_Offset, "sys_vendor"},
+    {System_Information_Structure, System_Information_Product_Name_Offset, "product_name"},
+    {System_Information_Structure, System_Information_Serial_Number_Offset, "product_serial"},
+    {System_Enclosure_or_Chassis_Structure, System_Enclosure_or_Chassis_Service_Offset, "chassis_serial"},
+    {System_Enclosure_or_Chassis_Structure, System_Enclosure_or_Chassis_Asset_Offset, "chassis_asset_tag"},
+};
+
+static char *get_string_from_dmi_id(u8 type, u8 offset)
+{
+    if (sysinfo_flags & SYSINFO_FORCE_TABLE)
+        return 0;
+
+    for (size_t i = 0; i < sizeof(dmi_id_files) / sizeof(dmi_id_files[0]); ++i)
+        if (dmi_id_files[i].type == type && dmi_id_files[i].offset == offset)
+            return dmi_id_read(dmi_id_files[i].name);
+    return 0;
+}
+
 __hidden char * smbios_struct_get_string_from_table(u8 type, u8 offset)
 {
     const struct smbios_struct *s;
@@ -100,6 +136,10 @@ __hidden char * smbios_struct_get_string_from_table(u8 type, u8 offset)
     char *ret = 0;
 
     sysinfo_clearerr();
+    ret = get_string_from_dmi_id(type, offset);
+    if (ret)
+        return ret;
+
     s = smbios_get_next_struct_by_type(0, type);
     if (!s)
         goto out_err;
@@ -120,6 +160,37 @@ out_err:
     return NULL;
 }
 
+__hidden bool find_d4_string(const struct smbios_table *table, u16 id, struct d4_string *str)
+{
+    const struct indexed_io_access_structure *d4 = 0;
+    const struct indexed_io_token *token = find_d4_token(table, id, &d4);
+
+    // the value is a string token, same as token_get_string() requires
+    if (!token || token->andMask)
+        return false;
+
+    str->indexPort = d4->indexPort;
+    str->dataPort = d4->dataPort;
+    str->location = token->location;
+    str->length = token->stringLength ? token->stringLength : 1;
+    return true;
+}
+
+__hidden char *read_d4_string(const struct cmos_access_obj *cmos, const struct d4_string *str)
+{
+    char *ret = calloc(1, str->length + 1);
+    if (!ret)
+        return 0;
+
+    for (int i = 0; i < str->length; ++i)
+        if (cmos_obj_read_byte(cmos, (u8 *)ret + i, str->indexPort, str->dataPort, str->location + i) < 0)
+        {
+            free(ret);
+            return 0;
+        }
+    return ret;
+}
+
 LIBSMBIOS_C_DLL_SPEC void sysinfo_string_free(void *f)
 {
     free(f);
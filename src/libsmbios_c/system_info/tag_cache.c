@@ -0,0 +1,113 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=c:cindent:textwidth=0:
+ *
+ * Copyright (C) 2005 Dell Inc.
+ *  by Michael Brown <Michael_E_Brown@dell.com>
+ * Licensed under the Open Software License version 2.1
+ *
+ * Alternatively, you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#define LIBSMBIOS_C_SOURCE
+#include "smbios_c/compat.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "smbios_c/system_info.h"
+#include "sysinfo_impl.h"
+
+/*
+ * Process wide cache of the service and asset tag lookups. A tag only
+ * changes through sysinfo_set_*_tag*(), which invalidate it, so once the
+ * full source chain has run its answer (including "not found") is kept.
+ */
+
+struct tag_cache_entry
+{
+    bool valid;
+    char *tag;
+    enum sysinfo_source src;
+};
+
+static struct tag_cache_entry tag_cache[NUM_CACHED_TAGS];
+
+__attribute__((destructor)) static void return_mem(void)
+{
+    fnprintf("\n");
+    for (int i=0; i<NUM_CACHED_TAGS; ++i)
+        free(tag_cache[i].tag);
+    memset(tag_cache, 0, sizeof(tag_cache));
+}
+
+// a cached answer is only good for a restricted lookup if the source that
+// gave it is allowed (every source before it in the chain came up empty),
+// or if no source had the tag.
+__hidden bool tag_cache_get(int which, int sources, char **tag, enum sysinfo_source *src)
+{
+    bool hit = false;
+    struct tag_cache_entry *e = &tag_cache[which];
+
+    sysinfo_lock();
+    if (!e->valid)
+        goto out;
+    if (e->src != SYSINFO_SRC_NONE && !(sources & SYSINFO_SOURCE_BIT(e->src)))
+        goto out;
+
+    *tag = 0;
+    if (e->tag)
+    {
+        *tag = strdup(e->tag);
+        if (!*tag)
+            goto out;
+    }
+    *src = e->src;
+    hit = true;
+
+out:
+    sysinfo_unlock();
+    fnprintf(" %d: %s\n", which, hit ? "hit" : "miss");
+    return hit;
+}
+
+__hidden void tag_cache_put(int which, const char *tag, enum sysinfo_source src)
+{
+    char *copy = 0;
+    struct tag_cache_entry *e = &tag_cache[which];
+
+    if (tag && !(copy = strdup(tag)))
+        return;
+
+    sysinfo_lock();
+    free(e->tag);
+    e->tag = copy;
+    e->src = src;
+    e->valid = true;
+    sysinfo_unlock();
+}
+
+__hidden void tag_cache_invalidate(int which)
+{
+    struct tag_cache_entry *e = &tag_cache[which];
+
+    fnprintf(" %d\n", which);
+    sysinfo_lock();
+    free(e->tag);
+    e->tag = 0;
+    e->valid = false;
+    sysinfo_unlock();
+}
+
+LIBSMBIOS_C_DLL_SPEC void sysinfo_tag_cache_invalidate()
+{
+    for (int i=0; i<NUM_CACHED_TAGS; ++i)
+        tag_cache_invalidate(i);
+}
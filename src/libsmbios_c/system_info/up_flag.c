@@ -50,22 +50,59 @@ LIBSMBIOS_C_PACKED_ATTR;
 #pragma pack(pop)
 #endif
 
-__hidden bool get_up_offset_and_flag(struct up_info *up)
+struct up_search
 {
-    s64 offset = memory_search( UP_ANCHOR, UP_ANCHOR_LEN,  0xF0000UL, 0xFFFFFUL, 16);
-    if (!offset)
-        offset = memory_search( UP_ANCHOR, UP_ANCHOR_LEN,  0xF0000UL, 0xFFFFFUL, 1);
+    s64 aligned;    // first anchor on a paragraph boundary
+    s64 unaligned;  // first anchor anywhere else, only used if there is none
+};
 
-    if (offset!=0 && offset!=-1)
+static int found_up_anchor(const struct memory_access_obj *m, size_t which, u64 offset, void *userdata)
+{
+    struct up_search *search = userdata;
+    if (offset % 16 == 0)
     {
-        int ret;
-        ret = memory_read(up, (u64)offset, sizeof(*up));
-        if (ret < 0)
-            return false;
+        search->aligned = (s64)offset;
+        return 1;
     }
+    if (search->unaligned == -1)
+        search->unaligned = (s64)offset;
+    return 0;
+}
+
+// the _UP_ structure is part of the bios image, so it is only searched for
+// once per process
+static struct
+{
+    bool probed;
+    bool found;
+    struct up_info up;
+} up_cache;
+
+__hidden bool get_up_offset_and_flag(struct up_info *up)
+{
+    const struct memory_search_pattern pat = { UP_ANCHOR, UP_ANCHOR_LEN };
+    struct up_search search = { -1, -1 };
+    s64 offset;
 
-    fnprintf("offset 0x%llx", offset);
-    return (offset!=0 && offset!=-1);
+    sysinfo_lock();
+    if (up_cache.probed)
+        goto out;
+
+    // one pass over the segment; paragraph aligned anchors win
+    if (memory_search_multi(&pat, 1, 0xF0000UL, 0xFFFFFUL, 1, found_up_anchor, &search) < 0)
+        goto out;
+
+    offset = search.aligned != -1 ? search.aligned : search.unaligned;
+    fnprintf("offset 0x%llx\n", (long long)offset);
+    up_cache.probed = true;
+    if (offset != -1 && memory_read(&up_cache.up, (u64)offset, sizeof(up_cache.up)) >= 0)
+        up_cache.found = true;
+
+out:
+    if (up_cache.found)
+        memcpy(up, &up_cache.up, sizeof(*up));
+    sysinfo_unlock();
+    return up_cache.found;
 }
 
 __hidden int up_boot_helper(int flag)
@@ -88,9 +125,6 @@ __hidden int up_boot_helper(int flag)
     if(!found)
         goto out;
 
-    // instantiate token table to set up checksum observers
-    token_table_factory(TOKEN_DEFAULTS);
-
     // find 0xD4 token
     struct smbios_struct *s = smbios_get_next_struct_by_type(0, 0xD4);
     if(!s)
@@ -102,6 +136,11 @@ __hidden int up_boot_helper(int flag)
     u32 indexPort = d4->indexPort;
     u32 dataPort = d4->dataPort;
 
+    // only the checksums over our byte need to observe the write, no need
+    // for the whole token table
+    if (flag != 0 && setup_d4_checksums_covering(indexPort, up.offset) < 0)
+        goto out_err;
+
     // read byte
     u8 byte;
     int ret = cmos_read_byte(&byte, indexPort, dataPort, up.offset);
@@ -72,7 +72,7 @@ __hidden int update_checksum(const struct cmos_access_obj *c, bool do_update, vo
         fnprintf("REWRITE CSUM\n");
         for( unsigned int i=0; i<data->csumlen; ++i )
         {
-            int ret = cmos_obj_write_byte(c, data->indexPort, data->dataPort, data->csumloc+i, csum[data->csumlen -i -1]);
+            int ret = cmos_obj_write_byte(c, csum[data->csumlen -i -1], data->indexPort, data->dataPort, data->csumloc+i);
             if (ret)
                 goto out;
         }
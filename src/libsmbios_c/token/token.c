@@ -119,5 +119,19 @@ out:
     return 0;
 }
 
+int token_use_security(u16 id, struct dell_smi_security *sec)
+{
+    struct token_table *table = 0;
+    const struct token_obj *token = 0;
+    fnprintf("\n");
+    table = token_table_factory(TOKEN_DEFAULTS);
+    if (!table) goto out;
+    token = token_table_get_next_by_id(table, 0, id);
+    if (!token) goto out;
+    return token_obj_use_security(token, sec);
+out:
+    return 0;
+}
+
 
 
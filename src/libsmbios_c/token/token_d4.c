@@ -243,24 +243,67 @@ void __hidden init_d4_token(struct token_table *table, struct token_obj *t)
     t->get_string = _d4_get_string;
     t->set_string = _d4_set_string;
     t->try_password = 0;
+    t->use_security = 0;
     t->private_data = 0;
     t->errstring = table->errstring;
 }
 
+// checksums registered with the cmos singleton so far. token tables and the
+// up boot flag code both set them up, and each one must only run once.
+struct registered_checksum
+{
+    u32 indexPort;
+    u32 csumloc;
+    u32 csumlen;
+    struct registered_checksum *next;
+};
+static struct registered_checksum *registered_checksums;
+
+__attribute__((destructor)) static void return_mem(void)
+{
+    while (registered_checksums)
+    {
+        struct registered_checksum *next = registered_checksums->next;
+        free(registered_checksums);
+        registered_checksums = next;
+    }
+}
+
+static bool d4_has_checksum(const struct indexed_io_access_structure *d4_struct)
+{
+    // if all zeros, there is no checksum
+    return d4_struct->checkedRangeStartIndex || d4_struct->checkedRangeEndIndex || d4_struct->checkValueIndex;
+}
+
+static bool checksum_registered(const struct indexed_io_access_structure *d4_struct)
+{
+    for (const struct registered_checksum *r = registered_checksums; r; r = r->next)
+        if (r->indexPort == d4_struct->indexPort && r->csumloc == d4_struct->checkValueIndex)
+            return true;
+    return false;
+}
+
 int setup_d4_checksum(struct indexed_io_access_structure *d4_struct)
 {
     struct checksum_details *d = 0;
+    struct registered_checksum *r = 0;
     struct cmos_access_obj *c = cmos_obj_factory(CMOS_GET_SINGLETON);
     int retval = 0;
 
     if (!c)
         goto out_err;
 
-    // if all zeros, there is no checksum
-    if (!(d4_struct->checkedRangeStartIndex || d4_struct->checkedRangeEndIndex || d4_struct->checkValueIndex))
+    if (!d4_has_checksum(d4_struct) || checksum_registered(d4_struct))
         goto out;
 
     d = calloc(1, sizeof(struct checksum_details));
+    r = calloc(1, sizeof(struct registered_checksum));
+    if (!d || !r)
+    {
+        free(d);
+        free(r);
+        goto out_err;
+    }
 
     d->csumloc   = d4_struct->checkValueIndex;
     d->csumlen   = sizeof(u16);
@@ -289,6 +332,11 @@ int setup_d4_checksum(struct indexed_io_access_structure *d4_struct)
     }
 
     cmos_obj_register_write_callback(c, update_checksum, d, free);
+    r->indexPort = d->indexPort;
+    r->csumloc = d->csumloc;
+    r->csumlen = d->csumlen;
+    r->next = registered_checksums;
+    registered_checksums = r;
     goto out;
 out_err:
     // really should do something here
@@ -298,6 +346,59 @@ out:
     return retval;
 }
 
+static bool d4_range_covers(const struct indexed_io_access_structure *d4_struct, u32 indexPort, u32 start, u32 len)
+{
+    return d4_struct->indexPort == indexPort
+        && start <= d4_struct->checkedRangeEndIndex
+        && start + len > d4_struct->checkedRangeStartIndex;
+}
+
+// sets up the checksums of the singleton table that a write to 'offset'
+// affects, without building a token table. a rewritten checksum can itself
+// sit in another checked range, so keep going until nothing new is added.
+int __hidden setup_d4_checksums_covering(u32 indexPort, u32 offset)
+{
+    bool added;
+    do {
+        added = false;
+        smbios_for_each_struct_type(s, 0xD4) {
+            struct indexed_io_access_structure *d4_struct = (struct indexed_io_access_structure*)s;
+            if (!d4_has_checksum(d4_struct) || checksum_registered(d4_struct))
+                continue;
+
+            bool covered = d4_range_covers(d4_struct, indexPort, offset, 1);
+            for (const struct registered_checksum *r = registered_checksums; r && !covered; r = r->next)
+                covered = d4_range_covers(d4_struct, r->indexPort, r->csumloc, r->csumlen);
+            if (!covered)
+                continue;
+
+            if (setup_d4_checksum(d4_struct))
+                return -1;
+            added = true;
+        }
+    } while (added);
+    return 0;
+}
+
+// looks a 0xD4 token up in a smbios table directly, for callers that only
+// need one or two tokens and not the whole token table
+__hidden const struct indexed_io_token *find_d4_token(const struct smbios_table *table, u16 id, const struct indexed_io_access_structure **d4_out)
+{
+    smbios_table_for_each_struct_type(table, s, 0xD4) {
+        const struct indexed_io_access_structure *d4_struct = (const struct indexed_io_access_structure*)s;
+        const u8 *end = (const u8 *)d4_struct + d4_struct->length;
+        for (const struct indexed_io_token *token = d4_struct->tokens;
+                (const u8 *)(token + 1) <= end && token->tokenId != TokenTypeEOT; ++token)
+        {
+            if (token->tokenId != id)
+                continue;
+            *d4_out = d4_struct;
+            return token;
+        }
+    }
+    return 0;
+}
+
 int __hidden add_d4_tokens(struct token_table *table)
 {
     int retval = 0, ret;
@@ -161,21 +161,28 @@ static int _da_set_string(const struct token_obj *t, const char *str, size_t siz
     return retval;
 }
 
-static int _da_try_password(const struct token_obj *t, const char *pass_ascii, const char *pass_scan)
+static int _da_use_security(const struct token_obj *t, struct dell_smi_security *sec)
 {
     fnprintf("\n");
     union void_u16 *indirect = (union void_u16*) &(t->private_data);
 
-    const char *whichpw = pass_scan;
-    if (dell_smi_password_format(DELL_SMI_PASSWORD_ADMIN) == DELL_SMI_PASSWORD_FMT_ASCII)
-        whichpw=pass_ascii;
-
     fnprintf("current security key: %d\n", indirect->val);
-    int ret = dell_smi_get_security_key(whichpw, &(indirect->val));
+    int ret = dell_smi_security_get_key(sec, &(indirect->val));
     fnprintf("new security key: 0x%04x\n", indirect->val);
     return ret;
 }
 
+static int _da_try_password(const struct token_obj *t, const char *pass_ascii, const char *pass_scan)
+{
+    fnprintf("\n");
+    int ret = -2;
+    struct dell_smi_security *sec = dell_smi_security_new(pass_ascii, pass_scan);
+    if (sec)
+        ret = _da_use_security(t, sec);
+    dell_smi_security_free(sec);
+    return ret;
+}
+
 void __hidden init_da_token(struct token_table *table, struct token_obj *t)
 {
     fnprintf("\n");
@@ -188,6 +195,7 @@ void __hidden init_da_token(struct token_table *table, struct token_obj *t)
     t->get_string = _da_get_string;
     t->set_string = _da_set_string;
     t->try_password = _da_try_password;
+    t->use_security = _da_use_security;
     t->private_data = 0;
     t->errstring = table->errstring;
 }
@@ -57,6 +57,7 @@ struct token_obj
     int (*set_string)(const struct token_obj*, const char *, size_t size);
 
     int (*try_password)(const struct token_obj *, const char *ascii, const char *scancode);
+    int (*use_security)(const struct token_obj *, struct dell_smi_security *);
 
     const char *(*strerror)(const struct token_obj*);
 
@@ -203,6 +203,14 @@ int token_obj_try_password(const struct token_obj *t, const char *pass_ascii, co
     return 0;
 }
 
+int token_obj_use_security(const struct token_obj *t, struct dell_smi_security *sec)
+{
+    fnprintf("\n");
+    if (t && t->use_security)
+        return t->use_security (t, sec);
+    return 0;
+}
+
 const struct smbios_struct *token_obj_get_smbios_struct(const struct token_obj *t)
 {
     if (t)
@@ -22,8 +22,10 @@ from . import cmos
 from . import memory
 from . import smbios
 from . import smi
+from . import stats
 from . import system_info
 from . import smbios_token
+from . import smbiosd
 from . import _common
 
 import gettext
@@ -32,7 +34,7 @@ gettext.install(GETTEXT_PACKAGE, localedir)
 __VERSION__ = "uninstalled-version"
 
 _all_ = [
-    "cmos", "memory", "smbios", "smi", "system_info", "smbios_token",
+    "cmos", "memory", "smbios", "smi", "stats", "system_info", "smbios_token", "smbiosd",
     "GETTEXT_PACKAGE",
     "localedir", "pkgdatadir", "pythondir", "pkgconfdir"
     ]
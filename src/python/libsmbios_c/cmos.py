@@ -16,14 +16,16 @@ import ctypes
 
 from libsmbios_c import libsmbios_c_DLL as DLL
 from ._common import errorOnNegativeFN, errorOnNullPtrFN, c_utf8_p
+from .stats import ObjStats
 from .trace_decorator import traceLog
 
-__all__ = ["CmosAccess", "CMOS_DEFAULTS", "CMOS_GET_SINGLETON", "CMOS_GET_NEW", "CMOS_UNIT_TEST_MODE"]
+__all__ = ["CmosAccess", "CMOS_DEFAULTS", "CMOS_GET_SINGLETON", "CMOS_GET_NEW", "CMOS_UNIT_TEST_MODE", "CMOS_FROM_BUFFER"]
 
 CMOS_DEFAULTS      =0x0000
 CMOS_GET_SINGLETON =0x0001
 CMOS_GET_NEW       =0x0002
 CMOS_UNIT_TEST_MODE=0x0004
+CMOS_FROM_BUFFER   =0x0010
 
 @traceLog()
 def CmosAccess(flags=CMOS_GET_SINGLETON, *factory_args):
@@ -72,6 +74,24 @@ class _CmosAccess(ctypes.Structure):
 
         DLL.cmos_obj_register_write_callback(self._cmosobj, cb, userdata, fcb)
 
+    @traceLog()
+    def beginWriteBatch(self):
+        DLL.cmos_obj_begin_write_batch(self._cmosobj)
+
+    @traceLog()
+    def endWriteBatch(self):
+        return DLL.cmos_obj_end_write_batch(self._cmosobj)
+
+    @traceLog()
+    def get_stats(self):
+        s = ObjStats()
+        DLL.cmos_obj_get_stats(self._cmosobj, ctypes.byref(s))
+        return s
+
+    @traceLog()
+    def reset_stats(self):
+        DLL.cmos_obj_reset_stats(self._cmosobj)
+
 
 #// format error string
 #const char *cmos_obj_strerror(const struct cmos_access_obj *m);
@@ -113,4 +133,20 @@ DLL.cmos_obj_register_write_callback.restype = None
 
 #int cmos_obj_run_callbacks(const struct cmos_access_obj *m, bool do_update);
 
+#void cmos_obj_begin_write_batch(struct cmos_access_obj *);
+DLL.cmos_obj_begin_write_batch.argtypes = [ ctypes.POINTER(_CmosAccess), ]
+DLL.cmos_obj_begin_write_batch.restype = None
+
+#int  cmos_obj_end_write_batch(struct cmos_access_obj *);
+DLL.cmos_obj_end_write_batch.argtypes = [ ctypes.POINTER(_CmosAccess), ]
+DLL.cmos_obj_end_write_batch.restype = ctypes.c_int
+DLL.cmos_obj_end_write_batch.errcheck = errorOnNegativeFN(_strerror)
+
+#int  cmos_obj_get_stats(const struct cmos_access_obj *, struct libsmbios_c_obj_stats *out);
+DLL.cmos_obj_get_stats.argtypes = [ ctypes.POINTER(_CmosAccess), ctypes.POINTER(ObjStats) ]
+DLL.cmos_obj_get_stats.restype = ctypes.c_int
+DLL.cmos_obj_get_stats.errcheck = errorOnNegativeFN(_strerror)
 
+#void cmos_obj_reset_stats(struct cmos_access_obj *);
+DLL.cmos_obj_reset_stats.argtypes = [ ctypes.POINTER(_CmosAccess), ]
+DLL.cmos_obj_reset_stats.restype = None
@@ -16,14 +16,17 @@ import ctypes
 
 from libsmbios_c import libsmbios_c_DLL as DLL
 from ._common import errorOnNegativeFN, errorOnNullPtrFN, c_utf8_p
+from .stats import ObjStats
 from .trace_decorator import traceLog, getLog
 
-__all__ = ["MemoryAccess", "MEMORY_DEFAULTS", "MEMORY_GET_SINGLETON", "MEMORY_GET_NEW", "MEMORY_UNIT_TEST_MODE"]
+__all__ = ["MemoryAccess", "MEMORY_DEFAULTS", "MEMORY_GET_SINGLETON", "MEMORY_GET_NEW", "MEMORY_UNIT_TEST_MODE", "MEMORY_PERSISTENT", "MEMORY_FROM_BUFFER"]
 
 MEMORY_DEFAULTS      =0x0000
 MEMORY_GET_SINGLETON =0x0001
 MEMORY_GET_NEW       =0x0002
 MEMORY_UNIT_TEST_MODE=0x0004
+MEMORY_PERSISTENT    =0x0010
+MEMORY_FROM_BUFFER   =0x0020
 
 @traceLog()
 def MemoryAccess(flags=MEMORY_GET_SINGLETON, *factory_args):
@@ -60,6 +63,21 @@ class _MemoryAccess(ctypes.Structure):
     def search(self, pattern, start, end, stride):
         return DLL.memory_obj_search(self._memobj, pattern, len(pattern), start, end, stride)
 
+    @traceLog()
+    def search_multi(self, patterns, start, end, stride):
+        pats = (_MemorySearchPattern * len(patterns))()
+        for i, p in enumerate(patterns):
+            pats[i].pat = p
+            pats[i].patlen = len(p)
+
+        found = []
+        def _cb(memobj, which, offset, userdata):
+            found.append((which, offset))
+            return 0
+
+        DLL.memory_obj_search_multi(self._memobj, pats, len(patterns), start, end, stride, SEARCH_CALLBACK(_cb), None)
+        return found
+
     @traceLog()
     def close_hint(self, hint=None):
         if hint is not None:
@@ -70,6 +88,19 @@ class _MemoryAccess(ctypes.Structure):
 
         return DLL.memory_obj_should_close(self._memobj)
 
+    @traceLog()
+    def get_stats(self):
+        s = ObjStats()
+        DLL.memory_obj_get_stats(self._memobj, ctypes.byref(s))
+        return s
+
+    @traceLog()
+    def reset_stats(self):
+        DLL.memory_obj_reset_stats(self._memobj)
+
+
+class _MemorySearchPattern(ctypes.Structure):
+    _fields_ = [ ("pat", ctypes.c_char_p), ("patlen", ctypes.c_size_t) ]
 
 # define strerror first so we can use it in error checking other functions.
 DLL.memory_obj_strerror.argtypes = [ ctypes.POINTER(_MemoryAccess) ]
@@ -103,6 +134,14 @@ DLL.memory_obj_search.argtypes = [ ctypes.POINTER(_MemoryAccess), ctypes.c_char_
 DLL.memory_obj_search.restype = ctypes.c_int64
 DLL.memory_obj_search.errcheck = errorOnNegativeFN(lambda r,f,a: _strerror(a[0]))
 
+#typedef int (*memory_search_fn)(const struct memory_access_obj *, size_t which, u64 offset, void *userdata);
+SEARCH_CALLBACK = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.POINTER(_MemoryAccess), ctypes.c_size_t, ctypes.c_uint64, ctypes.c_void_p)
+
+#int  memory_obj_search_multi(const struct memory_access_obj *, const struct memory_search_pattern *pats, size_t numpats, u64 start, u64 end, u64 stride, memory_search_fn fn, void *userdata);
+DLL.memory_obj_search_multi.argtypes = [ ctypes.POINTER(_MemoryAccess), ctypes.POINTER(_MemorySearchPattern), ctypes.c_size_t, ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64, SEARCH_CALLBACK, ctypes.c_void_p ]
+DLL.memory_obj_search_multi.restype = ctypes.c_int
+DLL.memory_obj_search_multi.errcheck = errorOnNegativeFN(lambda r,f,a: _strerror(a[0]))
+
 #void  memory_obj_suggest_leave_open(struct memory_access_obj *);
 DLL.memory_obj_suggest_leave_open.argtypes = [ ctypes.POINTER(_MemoryAccess), ]
 DLL.memory_obj_suggest_leave_open.restype = None
@@ -114,3 +153,12 @@ DLL.memory_obj_suggest_close.restype = None
 #bool  memory_obj_should_close(const struct memory_access_obj *);
 DLL.memory_obj_should_close.argtypes = [ ctypes.POINTER(_MemoryAccess), ]
 DLL.memory_obj_should_close.restype = ctypes.c_bool
+
+#int  memory_obj_get_stats(const struct memory_access_obj *, struct libsmbios_c_obj_stats *out);
+DLL.memory_obj_get_stats.argtypes = [ ctypes.POINTER(_MemoryAccess), ctypes.POINTER(ObjStats) ]
+DLL.memory_obj_get_stats.restype = ctypes.c_int
+DLL.memory_obj_get_stats.errcheck = errorOnNegativeFN(lambda r,f,a: _strerror(a[0]))
+
+#void memory_obj_reset_stats(struct memory_access_obj *);
+DLL.memory_obj_reset_stats.argtypes = [ ctypes.POINTER(_MemoryAccess), ]
+DLL.memory_obj_reset_stats.restype = None
@@ -18,12 +18,14 @@ from libsmbios_c import libsmbios_c_DLL as DLL
 from ._common import errorOnNullPtrFN, errorOnNegativeFN, c_utf8_p
 from .trace_decorator import traceLog, getLog, strip_trailing_whitespace
 
-__all__ = ["SmbiosTable", "SMBIOS_DEFAULTS", "SMBIOS_GET_SINGLETON", "SMBIOS_GET_NEW", "SMBIOS_UNIT_TEST_MODE"]
+__all__ = ["SmbiosTable", "SMBIOS_DEFAULTS", "SMBIOS_GET_SINGLETON", "SMBIOS_GET_NEW", "SMBIOS_UNIT_TEST_MODE", "SMBIOS_FROM_BUFFER", "SMBIOS_FROM_MEMORY"]
 
 SMBIOS_DEFAULTS      =0x0000
 SMBIOS_GET_SINGLETON =0x0001
 SMBIOS_GET_NEW       =0x0002
 SMBIOS_UNIT_TEST_MODE=0x0004
+SMBIOS_FROM_BUFFER   =0x0020
+SMBIOS_FROM_MEMORY   =0x0040
 
 class TableParseError(Exception): pass
 
@@ -86,7 +88,7 @@ class _SmbiosTable(ctypes.Structure):
             if bool(cur):
                 yield cur.contents
             else:
-                raise StopIteration(_("hit end of table."))
+                return # hit end of table
 
     @traceLog()
     def iterByType(self, t):
@@ -97,7 +99,7 @@ class _SmbiosTable(ctypes.Structure):
                 if cur.contents.getType() == t:
                     yield cur.contents
             else:
-                raise StopIteration(_("hit end of table."))
+                return # hit end of table
 
     @traceLog()
     def getStructureByHandle(self, handle):
@@ -117,6 +119,22 @@ class _SmbiosTable(ctypes.Structure):
 
     __getitem__ = getStructureByType
 
+    @traceLog()
+    def getDellOemTag(self, tag):
+        value = DLL.smbios_table_get_dell_oem_tag( self._tableobj, tag )
+        if value is None:
+            raise IndexError(_("No Dell OEM strings item with tag %s") % tag)
+        return value
+
+    @traceLog()
+    def getDellOemTags(self):
+        tags = ctypes.POINTER(_SmbiosOemTag)()
+        count = DLL.smbios_table_get_dell_oem_tags( self._tableobj, ctypes.byref(tags) )
+        return [ (tags[i].tag, tags[i].value.decode("utf-8", "replace")) for i in range(count) ]
+
+class _SmbiosOemTag(ctypes.Structure):
+    _fields_ = [ ("tag", ctypes.c_int), ("value", ctypes.c_char_p) ]
+
 #// format error string
 #const char *smbios_table_strerror(const struct smbios_table *m);
 # define strerror first so we can use it in error checking other functions.
@@ -148,6 +166,14 @@ DLL.smbios_table_get_next_struct_by_type.restype = ctypes.POINTER(SmbiosStructur
 DLL.smbios_table_get_next_struct_by_handle.argtypes = [ ctypes.POINTER(_SmbiosTable), ctypes.POINTER(SmbiosStructure), ctypes.c_uint16 ]
 DLL.smbios_table_get_next_struct_by_handle.restype = ctypes.POINTER(SmbiosStructure)
 
+#const char *smbios_table_get_dell_oem_tag(const struct smbios_table *, int tag);
+DLL.smbios_table_get_dell_oem_tag.argtypes = [ ctypes.POINTER(_SmbiosTable), ctypes.c_int ]
+DLL.smbios_table_get_dell_oem_tag.restype = c_utf8_p
+
+#size_t smbios_table_get_dell_oem_tags(const struct smbios_table *, const struct smbios_oem_tag **tags);
+DLL.smbios_table_get_dell_oem_tags.argtypes = [ ctypes.POINTER(_SmbiosTable), ctypes.POINTER(ctypes.POINTER(_SmbiosOemTag)) ]
+DLL.smbios_table_get_dell_oem_tags.restype = ctypes.c_size_t
+
 #u8 DLL_SPEC smbios_struct_get_type(const struct smbios_struct *);
 DLL.smbios_struct_get_type.argtypes = [ ctypes.POINTER(SmbiosStructure) ]
 DLL.smbios_struct_get_type.restype = ctypes.c_uint8
@@ -16,6 +16,7 @@ import ctypes
 
 from libsmbios_c import libsmbios_c_DLL as DLL
 from ._common import errorOnNullPtrFN, errorOnNegativeFN, freeLibStringFN, c_utf8_p
+from .smi import _DellSmiSecurity
 from .trace_decorator import traceLog, getLog
 
 __all__ = ["TokenTable", "TOKEN_DEFAULTS", "TOKEN_GET_SINGLETON", "TOKEN_GET_NEW", "TOKEN_UNIT_TEST_MODE"]
@@ -81,6 +82,10 @@ class Token(ctypes.Structure):
     def tryPassword(self, pass_ascii, pass_scancode):
         return DLL.token_obj_try_password(self, pass_ascii, pass_scancode)
 
+    @traceLog()
+    def useSecurity(self, security):
+        return DLL.token_obj_use_security(self, security)
+
 
 def TokenPtrSubClass(kind):
     def decorator(cls):
@@ -131,7 +136,7 @@ class _TokenTable(ctypes.Structure):
             if bool(cur):
                 yield cur.contents
             else:
-                raise StopIteration
+                return
 
     @traceLog()
     def __getitem__(self, id):
@@ -240,6 +245,10 @@ DLL.token_obj_set_string.errcheck = errorOnNegativeFN(lambda r,f,a: TokenManipul
 DLL.token_obj_try_password.argtypes = [ ctypes.POINTER(Token), ctypes.c_char_p, ctypes.c_char_p ]
 DLL.token_obj_try_password.restype = ctypes.c_int
 
+#int  DLL_SPEC token_obj_use_security(const struct token_obj *, struct dell_smi_security *);
+DLL.token_obj_use_security.argtypes = [ ctypes.POINTER(Token), ctypes.POINTER(_DellSmiSecurity) ]
+DLL.token_obj_use_security.restype = ctypes.c_int
+
 #const void * DLL_SPEC token_obj_get_ptr(const struct token_obj *t);
 DLL.token_obj_get_ptr.argtypes = [ ctypes.POINTER(Token), ]
 DLL.token_obj_get_ptr.restype = ctypes.POINTER(TokenPtr)
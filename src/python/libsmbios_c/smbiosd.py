@@ -0,0 +1,197 @@
+# vim:tw=0:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=python:
+
+  #############################################################################
+  #
+  # Copyright (c) 2005 Dell Computer Corporation
+  # Dual Licenced under GNU GPL and OSL
+  #
+  #############################################################################
+"""
+smbiosd:
+    python interface to functions in libsmbios_c  smbiosd.h
+"""
+
+# imports (alphabetical)
+import ctypes
+
+from libsmbios_c import libsmbios_c_DLL as DLL
+from ._common import errorOnNullPtrFN, errorOnNegativeFN, c_utf8_p
+from .system_info import _SysinfoSnapshot
+from .trace_decorator import traceLog, getLog
+
+__all__ = ["Server", "Client", "SmbiosdError", "SMBIOSD_DEFAULT_SOCKET",
+    "SMBIOSD_TOKEN_BOOL", "SMBIOSD_TOKEN_STRING", "SMBIOSD_TOKEN_ACTIVE", "SMBIOSD_TOKEN_ERROR"]
+
+SMBIOSD_DEFAULT_SOCKET = "/run/libsmbios/smbiosd.sock"
+
+SMBIOSD_TOKEN_BOOL   = 0x01
+SMBIOSD_TOKEN_STRING = 0x02
+SMBIOSD_TOKEN_ACTIVE = 0x04
+SMBIOSD_TOKEN_ERROR  = 0x08
+
+class SmbiosdError(Exception): pass
+
+class _Server(ctypes.Structure): pass
+class _Client(ctypes.Structure): pass
+
+class _Token(ctypes.Structure):
+    _fields_ = [ ("id", ctypes.c_uint16), ("type", ctypes.c_uint8), ("flags", ctypes.c_uint8),
+                 ("value_len", ctypes.c_uint16), ("value", ctypes.c_void_p) ]
+
+    def asDict(self):
+        value = None
+        if self.value:
+            value = ctypes.string_at(self.value, self.value_len)
+        return { "id": self.id, "type": self.type, "flags": self.flags, "value": value }
+
+#const char *smbiosd_strerror();
+DLL.smbiosd_strerror.argtypes = [ ]
+DLL.smbiosd_strerror.restype = c_utf8_p
+def _strerror(r, f, a):
+    return SmbiosdError(DLL.smbiosd_strerror())
+
+def _path(path):
+    if path is not None and not isinstance(path, bytes):
+        path = path.encode("utf-8")
+    return path
+
+class Server(object):
+    """loads the table, tokens and sysinfo snapshot, and listens on 'path'"""
+    @traceLog()
+    def __init__(self, path=None):
+        self._server = None
+        self._server = DLL.smbiosd_server_create(_path(path))
+
+    def __del__(self):
+        if self._server is not None:
+            DLL.smbiosd_server_free(self._server)
+
+    @traceLog()
+    def run(self):
+        """serves clients until stop() (or a signal handler calling it)"""
+        DLL.smbiosd_server_run(self._server)
+
+    @traceLog()
+    def reload(self):
+        DLL.smbiosd_server_reload(self._server)
+
+    def stop(self):
+        DLL.smbiosd_server_stop(self._server)
+
+class Client(object):
+    """connection to a running smbiosd"""
+    @traceLog()
+    def __init__(self, path=None):
+        self._client = None
+        self._client = DLL.smbiosd_client_open(_path(path))
+
+    def __del__(self):
+        if self._client is not None:
+            DLL.smbiosd_client_close(self._client)
+
+    @traceLog()
+    def ping(self):
+        DLL.smbiosd_client_ping(self._client)
+
+    @traceLog()
+    def getTable(self):
+        """raw SMBIOS structure table, as bytes"""
+        length = ctypes.c_size_t()
+        buf = DLL.smbiosd_client_get_table_buffer(self._client, ctypes.byref(length))
+        return ctypes.string_at(buf, length.value)
+
+    @traceLog()
+    def snapshot(self):
+        """the daemon's system_info.snapshot()"""
+        snap = DLL.smbiosd_client_get_snapshot(self._client)
+        try:
+            ret = {}
+            for n, t in snap.contents._fields_:
+                v = getattr(snap.contents, n)
+                if isinstance(v, bytes):
+                    v = v.decode("utf-8", "replace")
+                ret[n] = v
+            return ret
+        finally:
+            DLL.sysinfo_snapshot_free(snap)
+
+    @traceLog()
+    def getTokens(self):
+        """list of dicts with id, type, flags (SMBIOSD_TOKEN_*) and value"""
+        tokens = ctypes.POINTER(_Token)()
+        count = DLL.smbiosd_client_get_tokens(self._client, ctypes.byref(tokens))
+        if not tokens:
+            raise SmbiosdError(DLL.smbiosd_strerror())
+        return [ tokens[i].asDict() for i in range(count) ]
+
+    @traceLog()
+    def getToken(self, id):
+        """one token as a dict, or None if the daemon does not have it"""
+        token = DLL.smbiosd_client_get_token(self._client, id)
+        if not token:
+            return None
+        return token.contents.asDict()
+
+    @traceLog()
+    def reload(self):
+        DLL.smbiosd_client_reload(self._client)
+
+#struct smbiosd_server *smbiosd_server_create(const char *path);
+DLL.smbiosd_server_create.argtypes = [ ctypes.c_char_p ]
+DLL.smbiosd_server_create.restype = ctypes.POINTER(_Server)
+DLL.smbiosd_server_create.errcheck = errorOnNullPtrFN(_strerror)
+
+#int smbiosd_server_run(struct smbiosd_server *);
+DLL.smbiosd_server_run.argtypes = [ ctypes.POINTER(_Server) ]
+DLL.smbiosd_server_run.restype = ctypes.c_int
+DLL.smbiosd_server_run.errcheck = errorOnNegativeFN(_strerror)
+
+#int smbiosd_server_reload(struct smbiosd_server *);
+DLL.smbiosd_server_reload.argtypes = [ ctypes.POINTER(_Server) ]
+DLL.smbiosd_server_reload.restype = ctypes.c_int
+DLL.smbiosd_server_reload.errcheck = errorOnNegativeFN(_strerror)
+
+#void smbiosd_server_stop(struct smbiosd_server *);
+DLL.smbiosd_server_stop.argtypes = [ ctypes.POINTER(_Server) ]
+DLL.smbiosd_server_stop.restype = None
+
+#void smbiosd_server_free(struct smbiosd_server *);
+DLL.smbiosd_server_free.argtypes = [ ctypes.POINTER(_Server) ]
+DLL.smbiosd_server_free.restype = None
+
+#struct smbiosd_client *smbiosd_client_open(const char *path);
+DLL.smbiosd_client_open.argtypes = [ ctypes.c_char_p ]
+DLL.smbiosd_client_open.restype = ctypes.POINTER(_Client)
+DLL.smbiosd_client_open.errcheck = errorOnNullPtrFN(_strerror)
+
+#void smbiosd_client_close(struct smbiosd_client *);
+DLL.smbiosd_client_close.argtypes = [ ctypes.POINTER(_Client) ]
+DLL.smbiosd_client_close.restype = None
+
+#int smbiosd_client_ping(struct smbiosd_client *);
+DLL.smbiosd_client_ping.argtypes = [ ctypes.POINTER(_Client) ]
+DLL.smbiosd_client_ping.restype = ctypes.c_int
+DLL.smbiosd_client_ping.errcheck = errorOnNegativeFN(_strerror)
+
+#const void *smbiosd_client_get_table_buffer(struct smbiosd_client *, size_t *len);
+DLL.smbiosd_client_get_table_buffer.argtypes = [ ctypes.POINTER(_Client), ctypes.POINTER(ctypes.c_size_t) ]
+DLL.smbiosd_client_get_table_buffer.restype = ctypes.c_void_p
+DLL.smbiosd_client_get_table_buffer.errcheck = errorOnNullPtrFN(_strerror)
+
+#struct sysinfo_snapshot *smbiosd_client_get_snapshot(struct smbiosd_client *);
+DLL.smbiosd_client_get_snapshot.argtypes = [ ctypes.POINTER(_Client) ]
+DLL.smbiosd_client_get_snapshot.restype = ctypes.POINTER(_SysinfoSnapshot)
+DLL.smbiosd_client_get_snapshot.errcheck = errorOnNullPtrFN(_strerror)
+
+#size_t smbiosd_client_get_tokens(struct smbiosd_client *, const struct smbiosd_token **tokens);
+DLL.smbiosd_client_get_tokens.argtypes = [ ctypes.POINTER(_Client), ctypes.POINTER(ctypes.POINTER(_Token)) ]
+DLL.smbiosd_client_get_tokens.restype = ctypes.c_size_t
+
+#const struct smbiosd_token *smbiosd_client_get_token(struct smbiosd_client *, u16 id);
+DLL.smbiosd_client_get_token.argtypes = [ ctypes.POINTER(_Client), ctypes.c_uint16 ]
+DLL.smbiosd_client_get_token.restype = ctypes.POINTER(_Token)
+
+#int smbiosd_client_reload(struct smbiosd_client *);
+DLL.smbiosd_client_reload.argtypes = [ ctypes.POINTER(_Client) ]
+DLL.smbiosd_client_reload.restype = ctypes.c_int
+DLL.smbiosd_client_reload.errcheck = errorOnNegativeFN(_strerror)
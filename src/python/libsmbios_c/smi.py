@@ -16,9 +16,10 @@ import ctypes
 
 from libsmbios_c import libsmbios_c_DLL as DLL
 from ._common import errorOnNullPtrFN, errorOnNegativeFN, errorOnZeroFN, c_utf8_p
+from .stats import ObjStats
 from .trace_decorator import traceLog, getLog
 
-__all__ = ["DellSmi", "DELL_SMI_DEFAULTS", "DELL_SMI_GET_SINGLETON", "DELL_SMI_GET_NEW", "DELL_SMI_UNIT_TEST_MODE"]
+__all__ = ["DellSmi", "DELL_SMI_DEFAULTS", "DELL_SMI_GET_SINGLETON", "DELL_SMI_GET_NEW", "DELL_SMI_UNIT_TEST_MODE", "DELL_SMI_PERSISTENT", "DELL_SMI_CACHE_RESULTS", "DELL_SMI_GET_PER_THREAD"]
 __all__.extend( [ "cbARG1", "cbARG2", "cbARG3", "cbARG4", "cbRES1", "cbRES2", "cbRES3", "cbRES4", ])
 
 cbARG1=0
@@ -33,6 +34,9 @@ DELL_SMI_DEFAULTS      =0x0000
 DELL_SMI_GET_SINGLETON =0x0001
 DELL_SMI_GET_NEW       =0x0002
 DELL_SMI_UNIT_TEST_MODE=0x0004
+DELL_SMI_PERSISTENT    =0x0010
+DELL_SMI_CACHE_RESULTS =0x0020
+DELL_SMI_GET_PER_THREAD=0x0040
 
 class SMIExecutionError(Exception): pass # ret = -1
 class SMIUnsupported(Exception): pass # ret = -2
@@ -40,6 +44,16 @@ class SMIUnhandled(Exception): pass   # ret = -3
 class SMIOutputBufferFormatError(Exception): pass  # ret == -5
 class SMIOutputBufferTooSmall(Exception): pass  # ret == -6
 
+class DellSmiRequest(ctypes.Structure):
+    _fields_ = [ ("smi_class", ctypes.c_uint16),
+                 ("select", ctypes.c_uint16),
+                 ("args", ctypes.c_uint32 * 4),
+                 ("buffer", ctypes.c_void_p * 4),
+                 ("buffer_size", ctypes.c_size_t * 4),
+                 ("res", ctypes.c_uint32 * 4),
+                 ("retval", ctypes.c_int) ]
+__all__.append("DellSmiRequest")
+
 class BadPassword(Exception): pass
 class SmiCreateError(Exception): pass
 class SmiBufferCreateError(Exception): pass
@@ -80,6 +94,14 @@ class _DellSmi(ctypes.Structure):
     def getRes(self, res):
         return DLL.dell_smi_obj_get_res(self._smiobj, res)
 
+    @traceLog()
+    def supportedCmds(self):
+        return DLL.dell_smi_obj_get_supported_cmds(self._smiobj)
+
+    @traceLog()
+    def classSupported(self, smiclass):
+        return DLL.dell_smi_obj_class_supported(self._smiobj, smiclass)
+
     @traceLog()
     def buffer_frombios_auto(self, arg, size):
         self.bufs[arg] = DLL.dell_smi_obj_make_buffer_frombios_auto(self._smiobj, arg, size)
@@ -106,10 +128,48 @@ class _DellSmi(ctypes.Structure):
         ret = DLL.dell_smi_obj_execute(self._smiobj)
         raiseExceptionOnError(ret, self)
 
+    @traceLog()
+    def execute_batch(self, reqs):
+        # reqs: ctypes array of DellSmiRequest, res/retval filled in place.
+        # returns the number of failed entries
+        return DLL.dell_smi_obj_execute_batch(self._smiobj, reqs, len(reqs))
+
     @traceLog()
     def getBufContents(self, arg):
         return self.bufs[arg]
 
+    @traceLog()
+    def cache_enable(self, enable=True):
+        DLL.dell_smi_obj_cache_enable(self._smiobj, enable)
+
+    @traceLog()
+    def cache_set_ttl(self, smiclass, select, ttl_ms):
+        DLL.dell_smi_obj_cache_set_ttl(self._smiobj, smiclass, select, ttl_ms)
+
+    @traceLog()
+    def cache_invalidate(self):
+        DLL.dell_smi_obj_cache_invalidate(self._smiobj)
+
+    @traceLog()
+    def close_hint(self, hint=None):
+        if hint is not None:
+            if hint:
+                DLL.dell_smi_obj_suggest_leave_open(self._smiobj)
+            else:
+                DLL.dell_smi_obj_suggest_close(self._smiobj)
+
+        return DLL.dell_smi_obj_should_close(self._smiobj)
+
+    @traceLog()
+    def get_stats(self):
+        s = ObjStats()
+        DLL.dell_smi_obj_get_stats(self._smiobj, ctypes.byref(s))
+        return s
+
+    @traceLog()
+    def reset_stats(self):
+        DLL.dell_smi_obj_reset_stats(self._smiobj)
+
 @traceLog()
 def raiseExceptionOnError(ret, smiobj=None):
     if ret == -1:
@@ -281,6 +341,216 @@ DLL.dell_smi_password_change.restype = ctypes.c_int
 password_change = DLL.dell_smi_password_change
 __all__.append("password_change")
 
+class _DellSmiSecurity(ctypes.Structure): pass
+
+class SecurityContext(object):
+    """password pair that is verified against the bios only once"""
+    @traceLog()
+    def __init__(self, pass_ascii=None, pass_scancode=None):
+        self._as_parameter_ = None
+        self._as_parameter_ = DLL.dell_smi_security_new(pass_ascii, pass_scancode)
+
+    # dont decorate __del__
+    def __del__(self):
+        if self._as_parameter_:
+            DLL.dell_smi_security_free(self._as_parameter_)
+
+    @traceLog()
+    def get_key(self):
+        key = ctypes.c_uint16(0)
+        DLL.dell_smi_security_get_key(self, key)
+        return key.value
+
+    @traceLog()
+    def password_type(self):
+        return DLL.dell_smi_security_password_type(self)
+
+    @traceLog()
+    def password_format(self):
+        return DLL.dell_smi_security_password_format(self)
+
+    @traceLog()
+    def invalidate(self):
+        DLL.dell_smi_security_invalidate(self)
+__all__.append("SecurityContext")
+
+#struct dell_smi_security *dell_smi_security_new(const char *pass_ascii, const char *pass_scancode);
+DLL.dell_smi_security_new.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+DLL.dell_smi_security_new.restype = ctypes.POINTER(_DellSmiSecurity)
+DLL.dell_smi_security_new.errcheck = errorOnNullPtrFN(lambda r,f,a: MemoryError())
+
+#void dell_smi_security_free(struct dell_smi_security *);
+DLL.dell_smi_security_free.argtypes = [ctypes.POINTER(_DellSmiSecurity)]
+DLL.dell_smi_security_free.restype = None
+
+#void dell_smi_security_invalidate(struct dell_smi_security *);
+DLL.dell_smi_security_invalidate.argtypes = [ctypes.POINTER(_DellSmiSecurity)]
+DLL.dell_smi_security_invalidate.restype = None
+
+#int dell_smi_security_get_key(struct dell_smi_security *, u16 *security_key);
+DLL.dell_smi_security_get_key.argtypes = [ctypes.POINTER(_DellSmiSecurity), ctypes.POINTER(ctypes.c_uint16)]
+DLL.dell_smi_security_get_key.restype = ctypes.c_int
+DLL.dell_smi_security_get_key.errcheck=errorOnNegativeFN(lambda r,f,a: securityException(r))
+
+#int dell_smi_security_password_type(struct dell_smi_security *);
+DLL.dell_smi_security_password_type.argtypes = [ctypes.POINTER(_DellSmiSecurity)]
+DLL.dell_smi_security_password_type.restype = ctypes.c_int
+
+#int dell_smi_security_password_format(struct dell_smi_security *);
+DLL.dell_smi_security_password_format.argtypes = [ctypes.POINTER(_DellSmiSecurity)]
+DLL.dell_smi_security_password_format.restype = ctypes.c_int
+
+class _DellSmiAsync(ctypes.Structure): pass
+
+#typedef void (*dell_smi_async_fn)(struct dell_smi_request *req, void *userdata);
+dell_smi_async_fn = ctypes.CFUNCTYPE(None, ctypes.POINTER(DellSmiRequest), ctypes.c_void_p)
+
+class AsyncContext(object):
+    """worker thread running requests on an smi object of its own"""
+    @traceLog()
+    def __init__(self, smiobj):
+        self._as_parameter_ = None
+        self._smiobj = smiobj  # must outlive the worker
+        self._pending = {}
+        self._callback = dell_smi_async_fn(self._done)
+        self._as_parameter_ = DLL.dell_smi_async_new(smiobj._smiobj)
+
+    # dont decorate __del__
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        if self._as_parameter_:
+            DLL.dell_smi_async_free(self._as_parameter_)
+        self._as_parameter_ = None
+
+    def _done(self, req, userdata):
+        fn, r = self._pending.pop(userdata or 0)
+        if fn is not None:
+            fn(r)
+
+    @traceLog()
+    def submit(self, req, fn=None):
+        # req must stay alive until fn(req) has run from complete()
+        key = ctypes.addressof(req)
+        self._pending[key] = (fn, req)
+        DLL.dell_smi_async_submit(self, ctypes.byref(req), self._callback, key)
+
+    @traceLog()
+    def fileno(self):
+        return DLL.dell_smi_async_fd(self)
+
+    @traceLog()
+    def complete(self, timeout_ms=0):
+        return DLL.dell_smi_async_complete(self, timeout_ms)
+__all__.append("AsyncContext")
+
+#struct dell_smi_async *dell_smi_async_new(struct dell_smi_obj *smi);
+# argtypes are set below, with the other object functions
+DLL.dell_smi_async_new.restype = ctypes.POINTER(_DellSmiAsync)
+DLL.dell_smi_async_new.errcheck = errorOnNullPtrFN(lambda r,f,a: SmiCreateError(_obj_strerror(a[0])))
+
+#void dell_smi_async_free(struct dell_smi_async *);
+DLL.dell_smi_async_free.argtypes = [ctypes.POINTER(_DellSmiAsync)]
+DLL.dell_smi_async_free.restype = None
+
+#int  dell_smi_async_submit(struct dell_smi_async *, struct dell_smi_request *req, dell_smi_async_fn fn, void *userdata);
+DLL.dell_smi_async_submit.argtypes = [ctypes.POINTER(_DellSmiAsync), ctypes.POINTER(DellSmiRequest), dell_smi_async_fn, ctypes.c_void_p]
+DLL.dell_smi_async_submit.restype = ctypes.c_int
+DLL.dell_smi_async_submit.errcheck = errorOnNegativeFN(lambda r,f,a: MemoryError())
+
+#int  dell_smi_async_fd(const struct dell_smi_async *);
+DLL.dell_smi_async_fd.argtypes = [ctypes.POINTER(_DellSmiAsync)]
+DLL.dell_smi_async_fd.restype = ctypes.c_int
+
+#int  dell_smi_async_complete(struct dell_smi_async *, int timeout_ms);
+DLL.dell_smi_async_complete.argtypes = [ctypes.POINTER(_DellSmiAsync), ctypes.c_int]
+DLL.dell_smi_async_complete.restype = ctypes.c_int
+DLL.dell_smi_async_complete.errcheck = errorOnNegativeFN(lambda r,f,a: SMIExecutionError(_strerror()))
+
+DELL_SMI_EMU_DCDBAS = 0
+DELL_SMI_EMU_WMI = 1
+__all__.extend(["DELL_SMI_EMU_DCDBAS", "DELL_SMI_EMU_WMI"])
+
+class _DellSmiEmu(ctypes.Structure): pass
+
+class Emulator(object):
+    """stand-in firmware answering SMIs from files in a scratch directory"""
+    @traceLog()
+    def __init__(self, directory, interface=DELL_SMI_EMU_DCDBAS):
+        self._as_parameter_ = None
+        self._as_parameter_ = DLL.dell_smi_emu_new(directory, interface)
+
+    # dont decorate __del__
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        if self._as_parameter_:
+            DLL.dell_smi_emu_free(self._as_parameter_)
+        self._as_parameter_ = None
+
+    @traceLog()
+    def set_result(self, smiclass, select, *res):
+        DLL.dell_smi_emu_set_result(self, smiclass, select, array_4_u32(*res))
+
+    @traceLog()
+    def set_buffer(self, smiclass, select, arg, data):
+        DLL.dell_smi_emu_set_buffer(self, smiclass, select, arg, data, len(data))
+
+    @traceLog()
+    def set_latency(self, usec):
+        DLL.dell_smi_emu_set_latency(self, usec)
+
+    @traceLog()
+    def count(self, smiclass=None, select=None):
+        if smiclass is None:
+            return DLL.dell_smi_emu_get_total(self)
+        return DLL.dell_smi_emu_get_count(self, smiclass, select)
+
+    @traceLog()
+    def last_request(self):
+        smiclass = ctypes.c_uint16(0)
+        select = ctypes.c_uint16(0)
+        args = array_4_u32(0, 0, 0, 0)
+        if DLL.dell_smi_emu_get_last_request(self, smiclass, select, args) < 0:
+            return None
+        return (smiclass.value, select.value, [ a & 0xffffffff for a in args ])
+__all__.append("Emulator")
+
+#struct dell_smi_emu *dell_smi_emu_new(const char *dir, int interface);
+DLL.dell_smi_emu_new.argtypes = [ctypes.c_char_p, ctypes.c_int]
+DLL.dell_smi_emu_new.restype = ctypes.POINTER(_DellSmiEmu)
+DLL.dell_smi_emu_new.errcheck = errorOnNullPtrFN(lambda r,f,a: SmiCreateError(_strerror()))
+
+#void dell_smi_emu_free(struct dell_smi_emu *);
+DLL.dell_smi_emu_free.argtypes = [ctypes.POINTER(_DellSmiEmu)]
+DLL.dell_smi_emu_free.restype = None
+
+#int dell_smi_emu_set_result(struct dell_smi_emu *, u16 smi_class, u16 select, const u32 res[4]);
+DLL.dell_smi_emu_set_result.argtypes = [ctypes.POINTER(_DellSmiEmu), ctypes.c_uint16, ctypes.c_uint16, array_4_u32]
+DLL.dell_smi_emu_set_result.restype = ctypes.c_int
+
+#int dell_smi_emu_set_buffer(struct dell_smi_emu *, u16 smi_class, u16 select, u8 argno, const u8 *data, size_t size);
+DLL.dell_smi_emu_set_buffer.argtypes = [ctypes.POINTER(_DellSmiEmu), ctypes.c_uint16, ctypes.c_uint16, ctypes.c_uint8, ctypes.c_char_p, ctypes.c_size_t]
+DLL.dell_smi_emu_set_buffer.restype = ctypes.c_int
+
+#void dell_smi_emu_set_latency(struct dell_smi_emu *, unsigned int usec);
+DLL.dell_smi_emu_set_latency.argtypes = [ctypes.POINTER(_DellSmiEmu), ctypes.c_uint]
+DLL.dell_smi_emu_set_latency.restype = None
+
+#u64 dell_smi_emu_get_count(struct dell_smi_emu *, u16 smi_class, u16 select);
+DLL.dell_smi_emu_get_count.argtypes = [ctypes.POINTER(_DellSmiEmu), ctypes.c_uint16, ctypes.c_uint16]
+DLL.dell_smi_emu_get_count.restype = ctypes.c_uint64
+
+#u64 dell_smi_emu_get_total(struct dell_smi_emu *);
+DLL.dell_smi_emu_get_total.argtypes = [ctypes.POINTER(_DellSmiEmu)]
+DLL.dell_smi_emu_get_total.restype = ctypes.c_uint64
+
+#int dell_smi_emu_get_last_request(struct dell_smi_emu *, u16 *smi_class, u16 *select, u32 args[4]);
+DLL.dell_smi_emu_get_last_request.argtypes = [ctypes.POINTER(_DellSmiEmu), ctypes.POINTER(ctypes.c_uint16), ctypes.POINTER(ctypes.c_uint16), array_4_u32]
+DLL.dell_smi_emu_get_last_request.restype = ctypes.c_int
+
 
 ################################################################################
 ################################################################################
@@ -305,6 +575,8 @@ def _obj_strerror(obj):
 DLL.dell_smi_factory.restype = ctypes.POINTER(_DellSmi)
 DLL.dell_smi_factory.errcheck = errorOnNullPtrFN(lambda r,f,a: SmiCreateError(_obj_strerror(r)))
 
+DLL.dell_smi_async_new.argtypes = [ ctypes.POINTER(_DellSmi) ]
+
 #void dell_smi_obj_free(struct dell_smi_obj *);
 DLL.dell_smi_obj_free.argtypes = [ ctypes.POINTER(_DellSmi) ]
 DLL.dell_smi_obj_free.restype = None
@@ -325,6 +597,14 @@ DLL.dell_smi_obj_set_arg.restype = None
 DLL.dell_smi_obj_get_res.argtypes = [ ctypes.POINTER(_DellSmi), ctypes.c_uint8 ]
 DLL.dell_smi_obj_get_res.restype = ctypes.c_uint32
 
+#u32  dell_smi_obj_get_supported_cmds(struct dell_smi_obj *);
+DLL.dell_smi_obj_get_supported_cmds.argtypes = [ ctypes.POINTER(_DellSmi) ]
+DLL.dell_smi_obj_get_supported_cmds.restype = ctypes.c_uint32
+
+#bool dell_smi_obj_class_supported(struct dell_smi_obj *, u16 smi_class);
+DLL.dell_smi_obj_class_supported.argtypes = [ ctypes.POINTER(_DellSmi), ctypes.c_uint16 ]
+DLL.dell_smi_obj_class_supported.restype = ctypes.c_bool
+
 #u8  *dell_smi_obj_make_buffer_frombios_auto(struct dell_smi_obj *, u8 argno, size_t size);
 DLL.dell_smi_obj_make_buffer_frombios_auto.argtypes = [ ctypes.POINTER(_DellSmi), ctypes.c_uint8, ctypes.c_size_t ]
 DLL.dell_smi_obj_make_buffer_frombios_auto.restype = ctypes.c_void_p
@@ -351,6 +631,46 @@ DLL.dell_smi_obj_execute.restype = ctypes.c_int
 # dont use error check since class does this
 #DLL.dell_smi_obj_execute.errcheck = errorOnNegativeFN(lambda r,f,a: SMIExecutionError(_obj_strerror(a[0])))
 
+#int  dell_smi_obj_execute_batch(struct dell_smi_obj *, struct dell_smi_request *reqs, size_t count);
+DLL.dell_smi_obj_execute_batch.argtypes = [ ctypes.POINTER(_DellSmi), ctypes.POINTER(DellSmiRequest), ctypes.c_size_t ]
+DLL.dell_smi_obj_execute_batch.restype = ctypes.c_int
+DLL.dell_smi_obj_execute_batch.errcheck = errorOnNegativeFN(lambda r,f,a: SMIExecutionError(_obj_strerror(a[0])))
+
+#int  dell_smi_obj_cache_enable(struct dell_smi_obj *, bool enable);
+DLL.dell_smi_obj_cache_enable.argtypes = [ ctypes.POINTER(_DellSmi), ctypes.c_bool ]
+DLL.dell_smi_obj_cache_enable.restype = ctypes.c_int
+DLL.dell_smi_obj_cache_enable.errcheck = errorOnNegativeFN()
+
+#int  dell_smi_obj_cache_set_ttl(struct dell_smi_obj *, u16 smi_class, u16 select, u32 ttl_ms);
+DLL.dell_smi_obj_cache_set_ttl.argtypes = [ ctypes.POINTER(_DellSmi), ctypes.c_uint16, ctypes.c_uint16, ctypes.c_uint32 ]
+DLL.dell_smi_obj_cache_set_ttl.restype = ctypes.c_int
+DLL.dell_smi_obj_cache_set_ttl.errcheck = errorOnNegativeFN()
+
+#void dell_smi_obj_cache_invalidate(struct dell_smi_obj *);
+DLL.dell_smi_obj_cache_invalidate.argtypes = [ ctypes.POINTER(_DellSmi) ]
+DLL.dell_smi_obj_cache_invalidate.restype = None
+
+#void dell_smi_obj_suggest_leave_open(struct dell_smi_obj *);
+DLL.dell_smi_obj_suggest_leave_open.argtypes = [ ctypes.POINTER(_DellSmi) ]
+DLL.dell_smi_obj_suggest_leave_open.restype = None
+
+#void dell_smi_obj_suggest_close(struct dell_smi_obj *);
+DLL.dell_smi_obj_suggest_close.argtypes = [ ctypes.POINTER(_DellSmi) ]
+DLL.dell_smi_obj_suggest_close.restype = None
+
+#bool dell_smi_obj_should_close(const struct dell_smi_obj *);
+DLL.dell_smi_obj_should_close.argtypes = [ ctypes.POINTER(_DellSmi) ]
+DLL.dell_smi_obj_should_close.restype = ctypes.c_bool
+
+#int  dell_smi_obj_get_stats(struct dell_smi_obj *, struct libsmbios_c_obj_stats *out);
+DLL.dell_smi_obj_get_stats.argtypes = [ ctypes.POINTER(_DellSmi), ctypes.POINTER(ObjStats) ]
+DLL.dell_smi_obj_get_stats.restype = ctypes.c_int
+DLL.dell_smi_obj_get_stats.errcheck = errorOnNegativeFN()
+
+#void dell_smi_obj_reset_stats(struct dell_smi_obj *);
+DLL.dell_smi_obj_reset_stats.argtypes = [ ctypes.POINTER(_DellSmi) ]
+DLL.dell_smi_obj_reset_stats.restype = None
+
 
 
 # for testing only. It only does en_US, which is just wrong.
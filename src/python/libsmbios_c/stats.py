@@ -0,0 +1,53 @@
+# vim:tw=0:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=python:
+
+  #############################################################################
+  #
+  # Copyright (c) 2005 Dell Computer Corporation
+  # Dual Licenced under GNU GPL and OSL
+  #
+  #############################################################################
+"""
+stats:
+    python interface to functions in libsmbios_c  stats.h
+"""
+
+# imports (alphabetical)
+import ctypes
+
+from libsmbios_c import libsmbios_c_DLL as DLL
+from .trace_decorator import traceLog
+
+__all__ = ["OpStats", "ObjStats", "enable", "enabled", "STATS_BUCKETS"]
+
+STATS_BUCKETS = 32
+
+class OpStats(ctypes.Structure):
+    _fields_ = [ ("calls", ctypes.c_uint64),
+                 ("errors", ctypes.c_uint64),
+                 ("bytes", ctypes.c_uint64),
+                 ("total_ns", ctypes.c_uint64),
+                 ("max_ns", ctypes.c_uint64),
+                 ("hist", ctypes.c_uint64 * STATS_BUCKETS) ]
+
+class ObjStats(ctypes.Structure):
+    _fields_ = [ ("read", OpStats),
+                 ("write", OpStats),
+                 ("remaps", ctypes.c_uint64),
+                 ("reopens", ctypes.c_uint64),
+                 ("callbacks", ctypes.c_uint64) ]
+
+@traceLog()
+def enable(on=True):
+    DLL.libsmbios_c_stats_enable(on)
+
+@traceLog()
+def enabled():
+    return DLL.libsmbios_c_stats_enabled()
+
+#void libsmbios_c_stats_enable(bool enable);
+DLL.libsmbios_c_stats_enable.argtypes = [ ctypes.c_bool ]
+DLL.libsmbios_c_stats_enable.restype = None
+
+#bool libsmbios_c_stats_enabled(void);
+DLL.libsmbios_c_stats_enabled.argtypes = []
+DLL.libsmbios_c_stats_enabled.restype = ctypes.c_bool
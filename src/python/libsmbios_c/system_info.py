@@ -55,6 +55,22 @@ DLL.sysinfo_get_dell_system_id.errcheck=errorOnZeroFN(lambda r,f,a: Exception(_(
 get_dell_system_id = DLL.sysinfo_get_dell_system_id
 __all__.append("get_dell_system_id")
 
+#int sysinfo_id_cache_set_dir(const char *dir);
+DLL.sysinfo_id_cache_set_dir.argtypes = [ctypes.c_char_p]
+DLL.sysinfo_id_cache_set_dir.restype = ctypes.c_int
+DLL.sysinfo_id_cache_set_dir.errcheck=errorOnNegativeFN(lambda r,f,a: Exception(_("Could not set the system ID cache directory.")))
+id_cache_set_dir = DLL.sysinfo_id_cache_set_dir
+__all__.append("id_cache_set_dir")
+
+SYSINFO_DEFAULTS = 0x0000
+SYSINFO_FORCE_TABLE = 0x0001
+
+#int sysinfo_set_flags(int flags);
+DLL.sysinfo_set_flags.argtypes = [ctypes.c_int]
+DLL.sysinfo_set_flags.restype = ctypes.c_int
+set_flags = DLL.sysinfo_set_flags
+__all__.append("set_flags")
+
 #    void sysinfo_string_free( const char * );
 DLL.sysinfo_string_free.argtypes = [ctypes.POINTER(ctypes.c_char),]
 DLL.sysinfo_string_free.restype = None
@@ -96,6 +112,173 @@ def set_property_ownership_tag(newtag, pass_ascii=None, pass_scancode=None):
     return DLL.sysinfo_set_property_ownership_tag(newtag, pass_ascii, pass_scancode)
 __all__.append("set_property_ownership_tag")
 
+SYSINFO_SVC_TAG_LEN = 7
+SYSINFO_SVC_TAG_CMOS_LEN = 5
+SYSINFO_SVC_TAG_UNCODED = 0x01
+SYSINFO_SVC_TAG_BAD_CHAR = 0x02
+SYSINFO_SVC_TAG_TOO_LONG = 0x04
+SYSINFO_SVC_TAG_ERRORS = SYSINFO_SVC_TAG_BAD_CHAR | SYSINFO_SVC_TAG_TOO_LONG
+
+#size_t sysinfo_decode_service_tags(const u8 *images, size_t count, char *tags, int *status);
+DLL.sysinfo_decode_service_tags.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_char_p, ctypes.POINTER(ctypes.c_int)]
+DLL.sysinfo_decode_service_tags.restype = ctypes.c_size_t
+
+#size_t sysinfo_encode_service_tags(const char *tags, size_t count, u8 *images, int *status);
+DLL.sysinfo_encode_service_tags.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_char_p, ctypes.POINTER(ctypes.c_int)]
+DLL.sysinfo_encode_service_tags.restype = ctypes.c_size_t
+
+@traceLog()
+def decode_service_tags(images):
+    """decode back to back 5 byte CMOS service tag images (bytes). returns a
+    list of (tag, SYSINFO_SVC_TAG_* status) tuples"""
+    if len(images) % SYSINFO_SVC_TAG_CMOS_LEN:
+        raise ValueError(_("Service tag images must be %d bytes each.") % SYSINFO_SVC_TAG_CMOS_LEN)
+    count = len(images) // SYSINFO_SVC_TAG_CMOS_LEN
+    stride = SYSINFO_SVC_TAG_LEN + 1
+    tags = ctypes.create_string_buffer(count * stride)
+    status = (ctypes.c_int * count)()
+    DLL.sysinfo_decode_service_tags(bytes(images), count, tags, status)
+    raw = tags.raw
+    return [ (raw[i*stride:(i+1)*stride].split(b"\0", 1)[0].decode("latin-1"), status[i]) for i in range(count) ]
+__all__.append("decode_service_tags")
+
+@traceLog()
+def encode_service_tags(tags):
+    """encode a list of service tags. returns (images, statuses): the back to
+    back 5 byte CMOS images and a SYSINFO_SVC_TAG_* status per tag"""
+    stride = SYSINFO_SVC_TAG_LEN + 1
+    buf = b"".join( t.encode("latin-1")[:stride].ljust(stride, b"\0") for t in tags )
+    images = ctypes.create_string_buffer(len(tags) * SYSINFO_SVC_TAG_CMOS_LEN)
+    status = (ctypes.c_int * len(tags))()
+    DLL.sysinfo_encode_service_tags(buf, len(tags), images, status)
+    return (images.raw, list(status))
+__all__.append("encode_service_tags")
+
+#int sysinfo_has_nvram_state_bytes();
+DLL.sysinfo_has_nvram_state_bytes.argtypes = []
+DLL.sysinfo_has_nvram_state_bytes.restype = ctypes.c_int
+has_nvram_state_bytes = DLL.sysinfo_has_nvram_state_bytes
+__all__.append("has_nvram_state_bytes")
+
+#int sysinfo_get_nvram_state_bytes( int user );
+DLL.sysinfo_get_nvram_state_bytes.argtypes = [ctypes.c_int]
+DLL.sysinfo_get_nvram_state_bytes.restype = ctypes.c_int
+get_nvram_state_bytes = DLL.sysinfo_get_nvram_state_bytes
+__all__.append("get_nvram_state_bytes")
+
+#void sysinfo_set_nvram_state_bytes(int user, int value);
+DLL.sysinfo_set_nvram_state_bytes.argtypes = [ctypes.c_int, ctypes.c_int]
+DLL.sysinfo_set_nvram_state_bytes.restype = None
+set_nvram_state_bytes = DLL.sysinfo_set_nvram_state_bytes
+__all__.append("set_nvram_state_bytes")
+
+#int sysinfo_has_up_boot_flag();
+DLL.sysinfo_has_up_boot_flag.argtypes = []
+DLL.sysinfo_has_up_boot_flag.restype = ctypes.c_int
+has_up_boot_flag = DLL.sysinfo_has_up_boot_flag
+__all__.append("has_up_boot_flag")
+
+#int sysinfo_get_up_boot_flag();
+DLL.sysinfo_get_up_boot_flag.argtypes = []
+DLL.sysinfo_get_up_boot_flag.restype = ctypes.c_int
+get_up_boot_flag = DLL.sysinfo_get_up_boot_flag
+__all__.append("get_up_boot_flag")
+
+#int sysinfo_set_up_boot_flag(int state);
+DLL.sysinfo_set_up_boot_flag.argtypes = [ctypes.c_int]
+DLL.sysinfo_set_up_boot_flag.restype = ctypes.c_int
+set_up_boot_flag = DLL.sysinfo_set_up_boot_flag
+__all__.append("set_up_boot_flag")
+
+# enum sysinfo_source
+SYSINFO_SRC_NONE = 0
+SYSINFO_SRC_BIOS_INFO = 1
+SYSINFO_SRC_SYSTEM_INFO = 2
+SYSINFO_SRC_ENCLOSURE = 3
+SYSINFO_SRC_OEM_STRINGS = 4
+SYSINFO_SRC_REV_AND_ID = 5
+SYSINFO_SRC_MEMORY = 6
+SYSINFO_SRC_SMI = 7
+SYSINFO_SRC_CMOS = 8
+
+SYSINFO_ALL_SOURCES = -1
+def SYSINFO_SOURCE_BIT(src): return 1 << src
+
+def _mk_sysinfo_tag_src_fn(name):
+    import sys
+    fn = getattr(DLL, "sysinfo_%s_src" % name)
+    fn.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_int)]
+    fn.restype = ctypes.POINTER(ctypes.c_char)
+    fn.errcheck = strip_trailing_whitespace()(freeLibStringFN( DLL.sysinfo_string_free, lambda r,f,a: Exception(_strerror() )))
+    @traceLog()
+    def get_with_source(sources=SYSINFO_ALL_SOURCES):
+        """returns (tag, SYSINFO_SRC_*), only trying the sources in the mask"""
+        src = ctypes.c_int(SYSINFO_SRC_NONE)
+        tag = fn(sources, ctypes.byref(src))
+        return (tag, src.value)
+    sys.modules[__name__].__dict__["%s_with_source" % name] = get_with_source
+    __all__.append("%s_with_source" % name)
+
+_mk_sysinfo_tag_src_fn("get_service_tag")
+_mk_sysinfo_tag_src_fn("get_asset_tag")
+
+#void sysinfo_tag_cache_invalidate();
+DLL.sysinfo_tag_cache_invalidate.argtypes = []
+DLL.sysinfo_tag_cache_invalidate.restype = None
+tag_cache_invalidate = DLL.sysinfo_tag_cache_invalidate
+__all__.append("tag_cache_invalidate")
+
+_snapshot_strings = ("vendor_name", "system_name", "bios_version", "service_tag", "asset_tag")
+_snapshot_ints = ("dell_system_id", "dell_oem_system_id")
+
+class _SysinfoSnapshot(ctypes.Structure):
+    _fields_ = [ (n, ctypes.c_char_p) for n in _snapshot_strings ] + \
+               [ (n, ctypes.c_int) for n in _snapshot_ints ] + \
+               [ (n + "_src", ctypes.c_int) for n in _snapshot_strings + _snapshot_ints ]
+
+#struct sysinfo_snapshot * sysinfo_snapshot();
+DLL.sysinfo_snapshot.argtypes = []
+DLL.sysinfo_snapshot.restype = ctypes.POINTER(_SysinfoSnapshot)
+DLL.sysinfo_snapshot.errcheck = errorOnNullPtrFN(lambda r,f,a: Exception(_strerror()))
+
+#struct sysinfo_snapshot * sysinfo_snapshot_from(const struct smbios_table *, struct memory_access_obj *, const struct cmos_access_obj *);
+DLL.sysinfo_snapshot_from.argtypes = [ ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p ]
+DLL.sysinfo_snapshot_from.restype = ctypes.POINTER(_SysinfoSnapshot)
+DLL.sysinfo_snapshot_from.errcheck = errorOnNullPtrFN(lambda r,f,a: Exception("could not read system information"))
+
+#void sysinfo_snapshot_free(struct sysinfo_snapshot *);
+DLL.sysinfo_snapshot_free.argtypes = [ ctypes.POINTER(_SysinfoSnapshot) ]
+DLL.sysinfo_snapshot_free.restype = None
+
+def _snapshot_dict(snap):
+    try:
+        ret = {}
+        for n, t in snap.contents._fields_:
+            v = getattr(snap.contents, n)
+            if isinstance(v, bytes):
+                v = v.decode("utf-8", "replace")
+            ret[n] = v
+        return ret
+    finally:
+        DLL.sysinfo_snapshot_free(snap)
+
+@traceLog()
+def snapshot():
+    """all system information at once, as a dict. Each value 'x' has a
+    matching 'x_src' entry holding one of the SYSINFO_SRC_* values."""
+    return _snapshot_dict(DLL.sysinfo_snapshot())
+__all__.append("snapshot")
+
+@traceLog()
+def snapshot_from(table, memory=None, cmos=None):
+    """snapshot() of the system the given SmbiosTable, MemoryAccess and
+    CmosAccess objects describe. memory and cmos are optional."""
+    return _snapshot_dict(DLL.sysinfo_snapshot_from(
+        table._tableobj,
+        memory._memobj if memory is not None else None,
+        cmos._cmosobj if cmos is not None else None))
+__all__.append("snapshot_from")
+
 if __name__ == "__main__":
     exitRet = 0
     def pr(s, f):
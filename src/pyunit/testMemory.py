@@ -73,6 +73,120 @@ class TestCase(TestLib.TestCase):
             for j in range(pagesize):
                 self.assertEqual( buf[ i*pagesize + j ], chr(ord("0")+i).encode('utf-8') )
 
+    def testMemoryPersistent(self):
+        import libsmbios_c.memory as m
+        mObj = m.MemoryAccess(m.MEMORY_GET_NEW | m.MEMORY_UNIT_TEST_MODE | m.MEMORY_PERSISTENT, self.testfile)
+        self.assertEqual( False, mObj.close_hint() )
+
+        # small reads go through pread, large ones through the mapping
+        self.assertEqual( b"xyz0", mObj.read(23, 4).raw )
+        buf = mObj.read(26 + pagesize - 2, pagesize)
+        self.assertEqual( b"0011", buf.raw[:4] )
+
+        # sessions nest and never force a persistent object closed
+        mObj.close_hint(1)
+        mObj.close_hint(0)
+        mObj.close_hint(0)
+        self.assertEqual( False, mObj.close_hint() )
+        del(mObj)
+
+    def testMemorySessions(self):
+        import libsmbios_c.memory as m
+        mObj = m.MemoryAccess(m.MEMORY_GET_NEW | m.MEMORY_UNIT_TEST_MODE, self.testfile)
+        self.assertEqual( True, mObj.close_hint() )
+        mObj.close_hint(1)
+        mObj.close_hint(1)
+        self.assertEqual( False, mObj.close_hint(0) )
+        self.assertEqual( True, mObj.close_hint(0) )
+        # unbalanced close does not require an extra leave_open later
+        self.assertEqual( True, mObj.close_hint(0) )
+        self.assertEqual( False, mObj.close_hint(1) )
+        del(mObj)
+
+    def testMemorySegments(self):
+        import os
+        import libsmbios_c.memory as m
+        d = getTempDir()
+        open(os.path.join(d, "seg-a.dat"), "wb").write(b"AAAAAAAA")
+        open(os.path.join(d, "seg-b.dat"), "wb").write(b"BB")
+        manifest = os.path.join(d, "%s.manifest" % self._testMethodName)
+        open(manifest, "w").write("# offset file\n0xFE000 seg-a.dat\n\n0xFE006 seg-b.dat  # overlays a\n")
+
+        mObj = m.MemoryAccess(m.MEMORY_GET_NEW | m.MEMORY_UNIT_TEST_MODE, manifest.encode('utf-8'))
+        # holes read back as zeros, later segments win on overlap
+        self.assertEqual( b"\0\0AAAAAABB\0\0", mObj.read(0xFDFFE, 12).raw )
+        self.assertEqual( 0xFE006, mObj.search(b"BB", 0xF0000, 0xFFFFF, 1) )
+
+        mObj.write(b"CC", 0xFE001)
+        self.assertEqual( b"ACCA", mObj.read(0xFE000, 4).raw )
+        self.assertRaises(Exception, mObj.write, b"CC", 0xFE009)
+        del(mObj)
+
+    def testMemoryFromBuffer(self):
+        import ctypes
+        import libsmbios_c.memory as m
+        buf = ctypes.create_string_buffer(b"_SM_abcdef", 10)
+        mObj = m.MemoryAccess(m.MEMORY_GET_NEW | m.MEMORY_FROM_BUFFER, ctypes.c_uint64(0xF0000), buf, ctypes.c_size_t(10))
+        self.assertEqual( b"\0_SM_a", mObj.read(0xEFFFF, 6).raw )
+        self.assertEqual( 0xF0000, mObj.search(b"_SM_", 0xE0000, 0xFFFFF, 16) )
+
+        # writes land in the borrowed buffer
+        mObj.write(b"Z", 0xF0004)
+        self.assertEqual( b"_SM_Zbcdef", buf.raw )
+        del(mObj)
+
+    def testCmosFromBuffer(self):
+        import ctypes
+        import libsmbios_c.cmos as c
+        buf = ctypes.create_string_buffer(512)
+        buf[256 + 3] = b"x"
+        cObj = c.CmosAccess(c.CMOS_GET_NEW | c.CMOS_FROM_BUFFER, buf, ctypes.c_size_t(512))
+        self.assertEqual( ord("x"), cObj.readByte(1, 0, 3) )
+        cObj.writeByte( ord("y"), 0, 0, 7 )
+        self.assertEqual( b"y", buf[7] )
+        self.assertRaises(Exception, cObj.readByte, 2, 0, 0)
+        del(cObj)
+
+    def testStats(self):
+        import libsmbios_c.memory as m
+        import libsmbios_c.cmos as c
+        import libsmbios_c.stats as stats
+        stats.enable(True)
+        try:
+            mObj = m.MemoryAccess(m.MEMORY_GET_NEW | m.MEMORY_UNIT_TEST_MODE, self.testfile)
+            mObj.read(0, 3)
+            mObj.read(0, pagesize * 2)
+            self.assertRaises(Exception, mObj.read, pagesize * 8, 1)
+            s = mObj.get_stats()
+            self.assertEqual( 3, s.read.calls )
+            self.assertEqual( 1, s.read.errors )
+            self.assertEqual( 3 + pagesize * 2, s.read.bytes )
+            self.assertEqual( 0, s.write.calls )
+            self.assertEqual( 3, sum(s.read.hist) )
+            self.assertTrue( s.remaps >= 2 )
+            self.assertTrue( s.reopens >= 1 )
+
+            mObj.reset_stats()
+            self.assertEqual( 0, mObj.get_stats().read.calls )
+            del(mObj)
+
+            cObj = c.CmosAccess(c.CMOS_GET_NEW | c.CMOS_UNIT_TEST_MODE, self.testfile)
+            cObj.registerCallback(lambda o, u, d: 0, None, None)
+            cObj.writeByte(ord("q"), 0, 0, 40)
+            cObj.readByte(0, 0, 40)
+            s = cObj.get_stats()
+            self.assertEqual( (1, 1, 1), (s.read.calls, s.write.calls, s.callbacks) )
+            del(cObj)
+
+            # nothing is counted while collection is off
+            stats.enable(False)
+            mObj = m.MemoryAccess(m.MEMORY_GET_NEW | m.MEMORY_UNIT_TEST_MODE, self.testfile)
+            mObj.read(0, 3)
+            self.assertEqual( 0, mObj.get_stats().read.calls )
+            del(mObj)
+        finally:
+            stats.enable(False)
+
     def testMemorySearch(self):
         ret = self.memObj.search("abc".encode("utf-8"), 0, 4096, 1);
         self.assertEqual( 0, ret );
@@ -85,6 +199,22 @@ class TestCase(TestLib.TestCase):
 
         self.assertRaises(Exception, self.memObj.search, "nonexistent", 0, 4096, 1);
 
+        # stride: "1" page starts at 26 + pagesize, only aligned hits count
+        ret = self.memObj.search("1".encode("utf-8"), 0, pagesize * 4, 16);
+        self.assertEqual( 26 + pagesize + 6, ret );
+
+        # match straddling the internal search window boundary
+        ret = self.memObj.search("12".encode("utf-8"), 0, pagesize * 4, 1);
+        self.assertEqual( 26 + pagesize * 2 - 1, ret );
+
+    def testMemorySearchMulti(self):
+        pats = [ "xyz".encode("utf-8"), "01".encode("utf-8"), "abc".encode("utf-8"), "12".encode("utf-8") ]
+        ret = self.memObj.search_multi(pats, 0, pagesize * 4, 1)
+        self.assertEqual( [(2, 0), (0, 23), (1, 26 + pagesize - 1), (3, 26 + pagesize * 2 - 1)], ret )
+
+        ret = self.memObj.search_multi(pats, 0, pagesize * 4, 3)
+        self.assertEqual( [(2, 0), (3, 26 + pagesize * 2 - 1)], ret )
+
     def testCmosRead(self):
         for i in range(26):
             # index/data ports to 0 for unit testing
@@ -120,6 +250,42 @@ class TestCase(TestLib.TestCase):
             c = cObj.readByte(1, 0, i)
             self.assertEqual(c, ord('0'))
 
+    def testCmosWriteBatch(self):
+        import libsmbios_c.cmos as c
+        import ctypes
+        cObj = c._CmosAccess(c.CMOS_GET_NEW | c.CMOS_UNIT_TEST_MODE, self.testfile)
+
+        def _test_cb(cmosObj, do_update, userdata):
+            i = ctypes.cast(userdata, ctypes.POINTER(ctypes.c_uint16))
+            i[0] = i[0] + 1
+            return 0
+
+        int = ctypes.c_uint16(0)
+        cObj.registerCallback(_test_cb, ctypes.pointer(int), None)
+
+        # callbacks run once, at the end of the outermost batch
+        cObj.beginWriteBatch()
+        cObj.beginWriteBatch()
+        for i in range(4):
+            cObj.writeByte( ord('A') + i, 0, 0, i )
+        self.assertEqual( cObj.endWriteBatch(), 0 )
+        self.assertEqual( int.value, 0 )
+        self.assertEqual( cObj.endWriteBatch(), 0 )
+        self.assertEqual( int.value, 1 )
+        for i in range(4):
+            self.assertEqual( cObj.readByte(0, 0, i), ord('A') + i )
+
+        # nothing written, nothing to run
+        cObj.beginWriteBatch()
+        cObj.endWriteBatch()
+        self.assertEqual( int.value, 1 )
+
+        # unbalanced end
+        self.assertRaises( Exception, cObj.endWriteBatch )
+
+        cObj.writeByte( ord('z'), 0, 0, 0 )
+        self.assertEqual( int.value, 2 )
+
 
 
 
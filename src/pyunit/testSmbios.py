@@ -23,6 +23,49 @@ def getTestDir():
     import sys
     return sys.argv[2]
 
+# 0xD4 checksums: (indexPort, dataPort, checkType, start, end, location)
+def d4Checksums(table):
+    import struct
+    sums = set()
+    for d4 in table.iterByType(0xd4):
+        indexPort, dataPort, checkType, start, end, loc = struct.unpack("<HHBBBB", d4.getData(4, 8))
+        if start or end or loc:
+            sums.add((indexPort, dataPort, checkType, start, end, loc))
+    return sorted(sums)
+
+# (stored, calculated) value of a 0xD4 checksum, see token/checksum.c
+def readChecksum(cmos, csum):
+    indexPort, dataPort, checkType, start, end, loc = csum
+    data = [ cmos.readByte(indexPort, dataPort, i) for i in range(start, end + 1) ]
+    if checkType == 1:
+        calculated, size = sum(data) & 0xff, 1
+    elif checkType == 3:
+        calculated, size = -sum(data) & 0xffff, 2
+    elif checkType == 2:
+        calculated, size = 0, 2
+        for byte in data:
+            calculated ^= byte
+            for j in range(7):
+                carry = calculated & 1
+                calculated >>= 1
+                if carry:
+                    calculated = (calculated | 0x8000) ^ 0xA001
+    else:
+        calculated, size = sum(data) & 0xffff, 2
+    stored = 0
+    for i in range(size):
+        stored = (stored << 8) | cmos.readByte(indexPort, dataPort, loc + i)
+    return stored, calculated
+
+def cmosImage(cmos, checksums):
+    ports = set([ (c[0], c[1]) for c in checksums ])
+    return dict([ ((i, d, off), cmos.readByte(i, d, off)) for (i, d) in ports for off in range(128) ])
+
+# checksums over the bytes that differ between two images
+def checksumsCovering(checksums, before, after):
+    changed = [ k for k in after if after[k] != before[k] ]
+    return [ c for c in checksums if [ k for k in changed if c[0] == k[0] and c[3] <= k[2] <= c[4] ] ]
+
 class TestCase(TestLib.TestCase):
     def checkSkip(self):
         for testElem in HelperXml.iterNodeElement(self.dom, "TESTINPUT", "testsToSkip"):
@@ -43,8 +86,8 @@ class TestCase(TestLib.TestCase):
         import libsmbios_c.smbios as s
 
         # initialize global singletons
-        filename = "%s/memdump.dat" % getTempDir()
-        filename = filename.encode('utf-8')
+        # the dump directory is served directly as a sparse memory image
+        filename = getTempDir().encode('utf-8')
         m.MemoryAccess(m.MEMORY_GET_SINGLETON | m.MEMORY_UNIT_TEST_MODE, filename)
         filename = "%s/cmos.dat" % getTempDir()
         filename = filename.encode('utf-8')
@@ -57,8 +100,7 @@ class TestCase(TestLib.TestCase):
             s.SmbiosTable(s.SMBIOS_GET_SINGLETON)
 
         # use private copies for testing
-        filename = "%s/memdump.dat" % getTempDir()
-        filename = filename.encode('utf-8')
+        filename = getTempDir().encode('utf-8')
         self.memObj = m.MemoryAccess(m.MEMORY_GET_NEW | m.MEMORY_UNIT_TEST_MODE, filename)
         filename = "%s/cmos.dat" % getTempDir()
         filename = filename.encode('utf-8')
@@ -94,6 +136,20 @@ class TestCase(TestLib.TestCase):
         except SkipTest as e:
             print("skip ", end=' ')
 
+    def testTableFromBuffer(self):
+        import ctypes
+        import libsmbios_c.smbios as s
+        dmi = os.path.join(getTempDir(), "DMI")
+        if not os.path.exists(dmi):
+            return
+
+        raw = open(dmi, "rb").read()
+        buf = ctypes.create_string_buffer(raw, len(raw))
+        table = s.SmbiosTable(s.SMBIOS_GET_NEW | s.SMBIOS_FROM_BUFFER, buf, ctypes.c_size_t(len(raw)))
+        self.assertEqual( self.tableObj.getStructureByType(0).getString(5), table.getStructureByType(0).getString(5) )
+        self.assertEqual( self.tableObj.getStructureByType(1).getString(4), table.getStructureByType(1).getString(4) )
+        del(table)
+
     def testIdByte(self):
         try:
             if self.skip: raise SkipTest()
@@ -114,5 +170,423 @@ class TestCase(TestLib.TestCase):
         except SkipTest as e:
             print("skip ", end=' ')
 
+    def testSnapshot(self):
+        import libsmbios_c.system_info as si
+        snap = si.snapshot()
+
+        def individual(fn):
+            try:
+                return fn()
+            except Exception:
+                return None
+
+        for name in ("vendor_name", "system_name", "bios_version", "service_tag", "asset_tag"):
+            # the python getters hand back "" for a NULL string
+            self.assertEqual( snap[name] or "", individual(getattr(si, "get_" + name)) or "" )
+            if snap[name] is None:
+                self.assertEqual( snap[name + "_src"], si.SYSINFO_SRC_NONE )
+            elif name != "asset_tag":
+                self.assertNotEqual( snap[name + "_src"], si.SYSINFO_SRC_NONE )
+        self.assertEqual( snap["dell_system_id"], individual(si.get_dell_system_id) or 0 )
+
+    def testSnapshotFrom(self):
+        import threading
+        import libsmbios_c.memory as m
+        import libsmbios_c.cmos as c
+        import libsmbios_c.smbios as s
+        import libsmbios_c.system_info as si
+
+        # the way a batch tool reads a dump: private objects only
+        def from_dump():
+            filename = getTempDir().encode('utf-8')
+            mem = m.MemoryAccess(m.MEMORY_GET_NEW | m.MEMORY_UNIT_TEST_MODE, filename)
+            filename = ("%s/cmos.dat" % getTempDir()).encode('utf-8')
+            cmos = c.CmosAccess(c.CMOS_GET_NEW | c.CMOS_UNIT_TEST_MODE, filename)
+            if os.path.exists(os.path.join(getTempDir(), "DMI")):
+                filename = getTempDir().encode('utf-8')
+                table = s.SmbiosTable(s.SMBIOS_GET_NEW | s.SMBIOS_UNIT_TEST_MODE, filename)
+            else:
+                table = s.SmbiosTable(s.SMBIOS_GET_NEW | s.SMBIOS_FROM_MEMORY, mem._memobj)
+            snap = si.snapshot_from(table, mem, cmos)
+            del(table)
+            return snap
+
+        expected = si.snapshot()
+        self.assertEqual( from_dump(), expected )
+
+        results = []
+        def worker():
+            for i in range(4):
+                results.append(from_dump())
+        threads = [ threading.Thread(target=worker) for i in range(4) ]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual( results, [expected] * 16 )
+
+        # without memory and cmos only the table is used
+        snap = si.snapshot_from(self.tableObj)
+        self.assertEqual( snap["system_name"], expected["system_name"] )
+        self.assertNotEqual( snap["service_tag_src"], si.SYSINFO_SRC_CMOS )
+
+    def testDellOemTags(self):
+        import re
+        expected = []
+        for st in self.tableObj.iterByType(0x0B):
+            strings = []
+            try:
+                for i in range(1, 256):
+                    strings.append(st.getStringNumber(i))
+            except IndexError:
+                pass
+            if not strings or not strings[0].startswith("Dell System"):
+                continue
+            for item in strings[1:]:
+                m = re.match(r"^(\d+)\[([^\]]*)", item)
+                if m and len(item) > 3:
+                    expected.append((int(m.group(1)), m.group(2)))
+
+        self.assertEqual( self.tableObj.getDellOemTags(), expected )
+        for tag, value in expected:
+            self.assertEqual( self.tableObj.getDellOemTag(tag), dict(reversed(expected))[tag] )
+        self.assertRaises( IndexError, self.tableObj.getDellOemTag, 12345 )
+
+    def testIdCache(self):
+        import libsmbios_c.system_info as si
+        if not os.path.exists("/proc/sys/kernel/random/boot_id"):
+            return
+
+        def individual(fn):
+            try:
+                return fn()
+            except Exception:
+                return 0
+
+        expected = individual(si.get_dell_system_id)
+        cachedir = os.path.join(getTempDir(), "idcache")
+        cachefile = os.path.join(cachedir, "system-id")
+        si.id_cache_set_dir(cachedir.encode('utf-8'))
+        try:
+            self.assertEqual( individual(si.get_dell_system_id), expected )
+            if not expected:
+                # a failed lookup is not kept for the rest of the boot
+                if os.path.exists(cachefile):
+                    self.assertFalse( int(open(cachefile).read().split()[3], 16) & 2 )
+                return
+
+            fields = open(cachefile).read().split()
+            self.assertEqual( fields[1], open("/proc/sys/kernel/random/boot_id").read().strip() )
+            self.assertTrue( int(fields[3], 16) & 2 )
+            self.assertEqual( int(fields[5], 16), expected )
+
+            # later lookups come from the file
+            fields[5] = "1234"
+            open(cachefile, "w").write(" ".join(fields) + "\n")
+            self.assertEqual( individual(si.get_dell_system_id), 0x1234 )
+
+            # ... but only for the same boot
+            fields[1] = "00000000-0000-0000-0000-000000000000"
+            open(cachefile, "w").write(" ".join(fields) + "\n")
+            self.assertEqual( individual(si.get_dell_system_id), expected )
+
+            # not from (or into) a directory others can write to
+            fields[1] = open("/proc/sys/kernel/random/boot_id").read().strip()
+            planted = " ".join(fields) + "\n"
+            open(cachefile, "w").write(planted)
+            os.chmod(cachedir, 0o777)
+            try:
+                self.assertEqual( individual(si.get_dell_system_id), expected )
+            finally:
+                os.chmod(cachedir, 0o755)
+            self.assertEqual( open(cachefile).read(), planted )
+
+            # links are neither read nor written through
+            target = os.path.join(getTempDir(), "idcache-target")
+            open(target, "w").write(planted)
+            os.remove(cachefile)
+            os.symlink(target, cachefile)
+            self.assertEqual( individual(si.get_dell_system_id), expected )
+            self.assertEqual( open(target).read(), planted )
+            self.assertFalse( os.path.islink(cachefile) )
+            self.assertEqual( [ f for f in os.listdir(cachedir) if f != "system-id" ], [] )
+        finally:
+            si.id_cache_set_dir(None)
+        self.assertEqual( individual(si.get_dell_system_id), expected )
+
+    def testNvramStateBytes(self):
+        import libsmbios_c.system_info as si
+        if not si.has_nvram_state_bytes():
+            return
+
+        # OM Toolkit owns both bytes now, DSA reads the default
+        si.set_nvram_state_bytes(0x8000, 0x123)
+        self.assertEqual( si.get_nvram_state_bytes(0x8000), 0x123 )
+        self.assertEqual( si.get_nvram_state_bytes(0x0000), 0 )
+
+        si.set_nvram_state_bytes(0x0000, 0x4567)
+        self.assertEqual( si.get_nvram_state_bytes(0x0000), 0x4567 )
+        self.assertEqual( si.get_nvram_state_bytes(0x8000), 0 )
+
+    def testTokenChecksum(self):
+        import libsmbios_c.cmos as c
+        import libsmbios_c.smbios_token as t
+        checksums = d4Checksums(self.tableObj)
+        if not checksums:
+            return
+
+        # activate D4 bool tokens until one lands in a checksummed range
+        cmos = c.CmosAccess(c.CMOS_GET_SINGLETON)
+        for tok in t.TokenTable():
+            if tok.getType() != 0xD4 or not tok.isBool() or tok.isActive():
+                continue
+            before = cmosImage(cmos, checksums)
+            tok.activate()
+            self.assertTrue( tok.isActive() )
+            covering = checksumsCovering(checksums, before, cmosImage(cmos, checksums))
+            if covering:
+                break
+        else:
+            return
+
+        for csum in covering:
+            stored, calculated = readChecksum(cmos, csum)
+            self.assertEqual( stored, calculated, "checksum %s" % (csum,) )
+
+    def testUpFlagChecksum(self):
+        import shutil
+        import struct
+        import subprocess
+        import textwrap
+        import libsmbios_c.cmos as c
+        checksums = d4Checksums(self.tableObj)
+        if not checksums:
+            return
+        indexPort = struct.unpack("<H", self.tableObj.getStructureByType(0xd4).getData(4, 2))[0]
+        ranges = [ s for s in checksums if s[0] == indexPort ]
+        if not ranges:
+            return
+
+        # none of the dumps has a _UP_ structure: plant one over a
+        # checksummed byte. The search result is cached per process, so
+        # the flag is written from a fresh one.
+        scratch = os.path.join(getTempDir(), "upflag")
+        os.mkdir(scratch)
+        for f in os.listdir(getTempDir()):
+            if os.path.isfile(os.path.join(getTempDir(), f)):
+                shutil.copy(os.path.join(getTempDir(), f), scratch)
+        up = struct.pack("<4sHBHB", b"_UP_", 0, ranges[0][3], 0, 0x04)
+        open(os.path.join(scratch, "offset-0xf0000.dat"), "wb").write(up)
+
+        cmosfile = os.path.join(scratch, "cmos.dat").encode('utf-8')
+        before = cmosImage(c.CmosAccess(c.CMOS_GET_NEW | c.CMOS_UNIT_TEST_MODE, cmosfile), checksums)
+
+        script = textwrap.dedent("""\
+            import os
+            import libsmbios_c.memory as m
+            import libsmbios_c.cmos as c
+            import libsmbios_c.smbios as s
+            import libsmbios_c.system_info as si
+            m.MemoryAccess(m.MEMORY_GET_SINGLETON | m.MEMORY_UNIT_TEST_MODE, %(dir)r)
+            c.CmosAccess(c.CMOS_GET_SINGLETON | c.CMOS_UNIT_TEST_MODE, %(cmos)r)
+            if os.path.exists(os.path.join(%(dir)r, b"DMI")):
+                s.SmbiosTable(s.SMBIOS_GET_SINGLETON | s.SMBIOS_UNIT_TEST_MODE, %(dir)r)
+            else:
+                s.SmbiosTable(s.SMBIOS_GET_SINGLETON)
+            assert si.has_up_boot_flag()
+            state = si.get_up_boot_flag()
+            assert si.set_up_boot_flag(not state) == 1
+            assert si.get_up_boot_flag() == (not state)
+            """) % { "dir": scratch.encode('utf-8'), "cmos": cmosfile }
+        p = subprocess.Popen([sys.executable, "-c", script], stderr=subprocess.PIPE)
+        err = p.communicate()[1].decode('utf-8', 'replace')
+        self.assertEqual(p.returncode, 0, err)
+
+        cmos = c.CmosAccess(c.CMOS_GET_NEW | c.CMOS_UNIT_TEST_MODE, cmosfile)
+        covering = checksumsCovering(checksums, before, cmosImage(cmos, checksums))
+        self.assertTrue( ranges[0] in covering )
+        for csum in covering:
+            stored, calculated = readChecksum(cmos, csum)
+            self.assertEqual( stored, calculated, "checksum %s" % (csum,) )
+        shutil.rmtree(scratch)
+
+    def testDmiIdFiles(self):
+        import shutil
+        import libsmbios_c.system_info as si
+        # a unit test table directory stands in for /sys/class/dmi/id with
+        # its "id" subdirectory
+        if not os.path.exists(os.path.join(getTempDir(), "DMI")):
+            return
+
+        table_vendor = si.get_vendor_name()
+        table_name = si.get_system_name()
+        table_tag = si.get_service_tag()
+        iddir = os.path.join(getTempDir(), "id")
+        os.mkdir(iddir)
+        try:
+            open(os.path.join(iddir, "sys_vendor"), "w").write("Sysfs Vendor  \n")
+            open(os.path.join(iddir, "product_serial"), "w").write("SYSFS01\n")
+            open(os.path.join(iddir, "product_name"), "w").write("\n")
+            si.tag_cache_invalidate()
+            self.assertEqual( si.get_vendor_name(), "Sysfs Vendor" )
+            self.assertEqual( si.get_service_tag_with_source(), ("SYSFS01", si.SYSINFO_SRC_SYSTEM_INFO) )
+            # empty files fall back to the table
+            self.assertEqual( si.get_system_name(), table_name )
+
+            old = si.set_flags(si.SYSINFO_FORCE_TABLE)
+            try:
+                si.tag_cache_invalidate()
+                self.assertEqual( si.get_vendor_name(), table_vendor )
+                self.assertEqual( si.get_service_tag(), table_tag )
+            finally:
+                si.set_flags(old)
+        finally:
+            shutil.rmtree(iddir)
+            si.tag_cache_invalidate()
+
+    def testDaemon(self):
+        import signal
+        import libsmbios_c.smbios_token as t
+        import libsmbios_c.smbiosd as d
+        import libsmbios_c.system_info as si
+
+        # the socket is listening before the fork, so no need to wait
+        path = os.path.join(getTempDir(), "smbiosd.sock")
+        server = d.Server(path)
+        pid = os.fork()
+        if pid == 0:
+            try:
+                server.run()
+            finally:
+                os._exit(0)
+
+        try:
+            client = d.Client(path)
+            client.ping()
+            self.assertEqual( client.snapshot(), si.snapshot() )
+
+            raw = client.getTable()
+            table = s_from_buffer(raw)
+            self.assertEqual( self.tableObj.getStructureByType(0).getString(5), table.getStructureByType(0).getString(5) )
+            self.assertEqual( self.tableObj.getStructureByType(1).getString(4), table.getStructureByType(1).getString(4) )
+            del(table)
+
+            tokens = client.getTokens()
+            local = list(t.TokenTable())
+            self.assertEqual( [ tok["id"] for tok in tokens ], [ tok.getId() for tok in local ] )
+            for tok, loc in zip(tokens, local):
+                self.assertEqual( bool(tok["flags"] & d.SMBIOSD_TOKEN_BOOL), bool(loc.isBool()) )
+                if loc.isBool():
+                    try:
+                        active = loc.isActive()
+                    except t.TokenManipulationFailure:
+                        self.assertTrue( tok["flags"] & d.SMBIOSD_TOKEN_ERROR )
+                        continue
+                    self.assertEqual( bool(tok["flags"] & d.SMBIOSD_TOKEN_ACTIVE), active > 0 )
+                if loc.isString():
+                    self.assertEqual( tok["value"], loc.getString() )
+
+            # single token queries from a client without the list
+            other = d.Client(path)
+            for tok in tokens[:8]:
+                self.assertEqual( other.getToken(tok["id"]), tok )
+            # 0xFFFF is never a real token id
+            self.assertEqual( other.getToken(0xFFFF), None )
+            other.ping()
+            del(other)
+
+            if os.geteuid() == 0:
+                client.reload()
+                self.assertEqual( client.getTokens(), tokens )
+            else:
+                self.assertRaises( d.SmbiosdError, client.reload )
+            del(client)
+        finally:
+            os.kill(pid, signal.SIGTERM)
+            os.waitpid(pid, 0)
+            del(server)
+        self.assertFalse( os.path.exists(path) )
+
+    def testDaemonLimits(self):
+        import signal
+        import socket
+        import struct
+        import time
+        import libsmbios_c.smbiosd as d
+
+        path = os.path.join(getTempDir(), "smbiosd-limits.sock")
+        server = d.Server(path)
+        pid = os.fork()
+        if pid == 0:
+            try:
+                server.run()
+            finally:
+                os._exit(0)
+
+        def raw():
+            sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            sock.settimeout(5)
+            sock.connect(path)
+            return sock
+
+        # the daemon notices closed connections on its next poll
+        def whenServed(fn):
+            deadline = time.time() + 5
+            while True:
+                try:
+                    return fn()
+                except d.SmbiosdError:
+                    if time.time() > deadline:
+                        raise
+                    time.sleep(0.05)
+
+        def pinged():
+            client = d.Client(path)
+            client.ping()
+            return client
+
+        # magic "SMBD", version 1, GET_TABLE
+        getTable = struct.pack("<IHHI", 0x44424d53, 1, 2, 0)
+
+        idle = []
+        try:
+            # a second daemon must not steal a live socket
+            self.assertRaises( d.SmbiosdError, d.Server, path )
+            d.Client(path).ping()
+
+            # idle connections from one uid cannot lock everybody out
+            idle = [ raw() for i in range(8) ]
+            extra = raw()
+            self.assertEqual( extra.recv(1), b"" )
+            extra.close()
+            idle.pop().close()
+            whenServed(pinged)
+
+            # a peer that never reads its replies does not stall the others:
+            # their requests are answered within the client's own deadline
+            idle.pop().close()
+            slow = raw()
+            slow.sendall(getTable * 200)
+            client = whenServed(pinged)
+            for i in range(5):
+                client.ping()
+            slow.close()
+            del(client)
+        finally:
+            for sock in idle:
+                sock.close()
+            os.kill(pid, signal.SIGTERM)
+            os.waitpid(pid, 0)
+            del(server)
+        self.assertFalse( os.path.exists(path) )
+
+def s_from_buffer(raw):
+    import ctypes
+    import libsmbios_c.smbios as s
+    buf = ctypes.create_string_buffer(raw, len(raw))
+    table = s.SmbiosTable(s.SMBIOS_GET_NEW | s.SMBIOS_FROM_BUFFER, buf, ctypes.c_size_t(len(raw)))
+    table._buf = buf    # the table borrows it
+    return table
+
 if __name__ == "__main__":
     sys.exit(not TestLib.runTests( [TestCase] ))
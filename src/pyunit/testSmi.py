@@ -0,0 +1,388 @@
+#!/usr/bin/python3
+# vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=python:
+"""
+"""
+
+
+
+import ctypes
+import os
+import threading
+import time
+import TestLib
+
+def getTempDir():
+    import sys
+    return sys.argv[1]
+
+def inThread(fn, *args):
+    # a new thread gets a new default smi object, set up against whatever
+    # interface is current at that moment
+    errors = []
+    def run():
+        try:
+            fn(*args)
+        except Exception as e:
+            errors.append(e)
+    t = threading.Thread(target=run)
+    t.start()
+    t.join()
+    if errors:
+        raise errors[0]
+
+class TestCase(TestLib.TestCase):
+    def setUp(self):
+        import libsmbios_c.memory as m
+        import libsmbios_c.cmos as c
+        import libsmbios_c.smbios as s
+
+        # smi objects take their command port from the 0xDA structure
+        filename = getTempDir().encode('utf-8')
+        m.MemoryAccess(m.MEMORY_GET_SINGLETON | m.MEMORY_UNIT_TEST_MODE, filename)
+        filename = "%s/cmos.dat" % getTempDir()
+        c.CmosAccess(c.CMOS_GET_SINGLETON | c.CMOS_UNIT_TEST_MODE, filename.encode('utf-8'))
+        s.SmbiosTable(s.SMBIOS_GET_SINGLETON)
+
+    def _emulator(self, interface):
+        import libsmbios_c.smi as smi
+        directory = "%s/%s-emu" % (getTempDir(), self._testMethodName)
+        if not os.path.exists(directory):
+            os.mkdir(directory)
+        emu = smi.Emulator(directory.encode('utf-8'), interface)
+        self.addCleanup(emu.close)
+        return emu
+
+    def testEmulatorResults(self):
+        import libsmbios_c.smi as smi
+        emu = self._emulator(smi.DELL_SMI_EMU_DCDBAS)
+        emu.set_result(17, 3, 0, 5, 6, 7)
+
+        def check():
+            self.assertEqual(smi.simple_ci_smi(17, 3, 1, 2, 3, 4), [0, 5, 6, 7])
+            self.assertEqual(emu.last_request(), (17, 3, [1, 2, 3, 4]))
+            # unprogrammed selectors are "not supported"
+            self.assertEqual(smi.simple_ci_smi(17, 4, 0, 0, 0, 0)[0], -2)
+        inThread(check)
+
+        self.assertEqual(emu.count(17, 3), 1)
+        self.assertEqual(emu.count(17, 4), 1)
+        self.assertEqual(emu.count(), 2)
+
+    def testEmulatorBuffers(self):
+        import libsmbios_c.smi as smi
+        import libsmbios_c.system_info as sysinfo
+        for interface in (smi.DELL_SMI_EMU_DCDBAS, smi.DELL_SMI_EMU_WMI):
+            emu = self._emulator(interface)
+            tag = "tag %d" % interface
+            # class 20 select 0: property ownership tag, read into cbARG1 buffer
+            emu.set_buffer(20, 0, smi.cbARG1, tag.encode('utf-8'))
+            emu.set_result(20, 0, 0, 0, 0, 0)
+            def check():
+                self.assertEqual(sysinfo.get_property_ownership_tag(), tag)
+            inThread(check)
+            self.assertEqual(emu.count(20, 0), 1)
+            emu.close()
+
+    def testEmulatorLatency(self):
+        import libsmbios_c.smi as smi
+        emu = self._emulator(smi.DELL_SMI_EMU_DCDBAS)
+        emu.set_result(17, 0, 0, 0, 0, 0)
+        emu.set_latency(5000)
+        def check():
+            start = time.time()
+            for i in range(4):
+                smi.simple_ci_smi(17, 0, 0, 0, 0, 0)
+            self.assertTrue(time.time() - start >= 0.02)
+        inThread(check)
+
+    def testExecuteBatch(self):
+        import libsmbios_c.smi as smi
+        for interface in (smi.DELL_SMI_EMU_DCDBAS, smi.DELL_SMI_EMU_WMI):
+            emu = self._emulator(interface)
+            emu.set_result(17, 3, 0, 5, 6, 7)
+            emu.set_buffer(20, 0, smi.cbARG2, b"from bios")
+            emu.set_result(20, 0, 0, 0, 0, 0)
+            tobios = ctypes.create_string_buffer(b"to bios", 16)
+            frombios = ctypes.create_string_buffer(16)
+
+            reqs = (smi.DellSmiRequest * 3)()
+            reqs[0].smi_class, reqs[0].select = 17, 3
+            reqs[0].args[:] = [1, 2, 3, 4]
+            # unprogrammed: the emulator answers "not supported"
+            reqs[1].smi_class, reqs[1].select = 17, 4
+            reqs[2].smi_class, reqs[2].select = 20, 0
+            reqs[2].buffer[smi.cbARG1] = ctypes.addressof(tobios)
+            reqs[2].buffer_size[smi.cbARG1] = len(tobios)
+            reqs[2].buffer[smi.cbARG2] = ctypes.addressof(frombios)
+            reqs[2].buffer_size[smi.cbARG2] = len(frombios)
+
+            def check():
+                obj = smi._DellSmi(smi.DELL_SMI_GET_NEW)
+                # the call itself goes through, the firmware answer says
+                # "unsupported" in cbRES1
+                self.assertEqual(obj.execute_batch(reqs), 0)
+                self.assertEqual([r.retval for r in reqs], [0, 0, 0])
+                self.assertEqual(list(reqs[0].res), [0, 5, 6, 7])
+                self.assertEqual(reqs[1].res[0], 0xfffffffe)
+                self.assertEqual(frombios.value, b"from bios")
+                self.assertEqual(tobios.value, b"to bios")
+            inThread(check)
+
+            self.assertEqual(emu.count(17, 3), 1)
+            self.assertEqual(emu.count(17, 4), 1)
+            self.assertEqual(emu.count(20, 0), 1)
+            self.assertEqual(emu.count(), 3)
+            emu.close()
+
+    def testWmiSetupRetry(self):
+        import struct
+        import libsmbios_c.smi as smi
+        emu = self._emulator(smi.DELL_SMI_EMU_WMI)
+        emu.set_result(17, 3, 0, 5, 6, 7)
+        device = "%s/%s-emu/dell-smbios" % (getTempDir(), self._testMethodName)
+        reqs = (smi.DellSmiRequest * 1)()
+        reqs[0].smi_class, reqs[0].select = 17, 3
+
+        def check():
+            obj = smi._DellSmi(smi.DELL_SMI_GET_NEW)
+            # the driver reports a length it cannot serve ...
+            open(device, "wb").write(struct.pack("<Q", 0))
+            self.assertEqual(obj.execute_batch(reqs), 1)
+            self.assertTrue(reqs[0].retval < 0)
+            # ... and later recovers: the same object must too
+            open(device, "wb").write(struct.pack("<Q", 32768))
+            self.assertEqual(obj.execute_batch(reqs), 0)
+            self.assertEqual(list(reqs[0].res), [0, 5, 6, 7])
+        inThread(check)
+
+    def testAsync(self):
+        import select
+        import libsmbios_c.smi as smi
+        emu = self._emulator(smi.DELL_SMI_EMU_DCDBAS)
+        for n in range(8):
+            emu.set_result(17, n, 0, n, n * 2, n * 3)
+        emu.set_latency(1000)
+        numRequests = 32
+
+        def check():
+            # library owned objects are driven by this thread too: refused
+            # (raw pointers: the per-thread one is freed when this thread exits)
+            for flags in (smi.DELL_SMI_GET_SINGLETON, smi.DELL_SMI_DEFAULTS):
+                shared = smi.DLL.dell_smi_factory(flags)
+                self.assertRaises(smi.SmiCreateError, smi.DLL.dell_smi_async_new, shared)
+
+            ctx = smi.AsyncContext(smi._DellSmi(smi.DELL_SMI_GET_NEW))
+            reqs = [ smi.DellSmiRequest() for i in range(numRequests) ]
+            done = []
+            for i, r in enumerate(reqs):
+                r.smi_class, r.select = 17, i % 8
+                r.args[0] = i
+                ctx.submit(r, done.append)
+
+            while len(done) < numRequests:
+                readable = select.select([ctx.fileno()], [], [], 5)[0]
+                self.assertEqual(readable, [ctx.fileno()])
+                ctx.complete(0)
+            ctx.close()
+
+            # callbacks run in submission order
+            self.assertEqual([ r.args[0] for r in done ], list(range(numRequests)))
+            for i, r in enumerate(done):
+                n = i % 8
+                self.assertEqual((r.retval, list(r.res)), (0, [0, n, n * 2, n * 3]))
+        inThread(check)
+        self.assertEqual(emu.count(), numRequests)
+
+    def testCacheKeyboardBacklight(self):
+        import libsmbios_c.smi as smi
+        emu = self._emulator(smi.DELL_SMI_EMU_DCDBAS)
+        emu.set_result(4, 11, 0, 1, 2, 3)
+
+        def check():
+            obj = smi._DellSmi(smi.DELL_SMI_GET_NEW | smi.DELL_SMI_CACHE_RESULTS)
+            def call(arg0):
+                before = emu.count(4, 11)
+                obj.setClass(4)
+                obj.setSelect(11)
+                obj.setArg(smi.cbARG1, arg0)
+                obj.setArg(smi.cbARG2, 5)
+                obj.execute()
+                return emu.count(4, 11) - before
+
+            # capability query (sub-function 0) is answered from the cache
+            self.assertEqual(call(0), 1)
+            self.assertEqual(call(0), 0)
+            # get state is not cached
+            self.assertEqual(call(1), 1)
+            self.assertEqual(call(1), 1)
+            # every set reaches the bios and flushes what was cached
+            self.assertEqual(call(2), 1)
+            self.assertEqual(call(2), 1)
+            self.assertEqual(call(0), 1)
+            self.assertEqual(call(1), 1)
+        inThread(check)
+
+    def testStats(self):
+        import libsmbios_c.smi as smi
+        import libsmbios_c.stats as stats
+        emu = self._emulator(smi.DELL_SMI_EMU_DCDBAS)
+        emu.set_result(17, 3, 0, 0, 0, 0)
+        stats.enable(True)
+        self.addCleanup(stats.enable, False)
+        def check():
+            # not smi.DellSmi(): that one is shared with the other tests
+            obj = smi._DellSmi(smi.DELL_SMI_GET_NEW)
+            for i in range(3):
+                obj.setClass(17)
+                obj.setSelect(3)
+                obj.execute()
+            s = obj.get_stats()
+            self.assertEqual( 3, s.read.calls )
+            self.assertEqual( 0, s.read.errors )
+            obj.reset_stats()
+            self.assertEqual( 0, obj.get_stats().read.calls )
+        inThread(check)
+
+    def testStatsAtExit(self):
+        # the default object of the main thread is never freed, its calls
+        # still belong in the summary printed at exit
+        import subprocess
+        import sys
+        import textwrap
+        directory = "%s/%s-emu" % (getTempDir(), self._testMethodName)
+        script = textwrap.dedent("""\
+            import os
+            import libsmbios_c.memory as m
+            import libsmbios_c.cmos as c
+            import libsmbios_c.smbios as s
+            import libsmbios_c.smi as smi
+            m.MemoryAccess(m.MEMORY_GET_SINGLETON | m.MEMORY_UNIT_TEST_MODE, %(tmp)r)
+            c.CmosAccess(c.CMOS_GET_SINGLETON | c.CMOS_UNIT_TEST_MODE, %(cmos)r)
+            s.SmbiosTable(s.SMBIOS_GET_SINGLETON)
+            os.mkdir(%(dir)r)
+            emu = smi.Emulator(%(dir)r, smi.DELL_SMI_EMU_DCDBAS)
+            emu.set_result(17, 3, 0, 0, 0, 0)
+            for i in range(5):
+                smi.simple_ci_smi(17, 3, 0, 0, 0, 0)
+            """) % { "tmp": getTempDir().encode('utf-8'),
+                "cmos": ("%s/cmos.dat" % getTempDir()).encode('utf-8'),
+                "dir": directory.encode('utf-8') }
+        env = dict(os.environ, LIBSMBIOS_C_STATS="1")
+        p = subprocess.Popen([sys.executable, "-c", script], env=env, stderr=subprocess.PIPE)
+        err = p.communicate()[1].decode('utf-8', 'replace')
+        self.assertEqual(p.returncode, 0, err)
+        self.assertTrue("  smi    execute calls 5 " in err, err)
+
+    def testSupportedCmds(self):
+        import struct
+        import libsmbios_c.smi as smi
+        import libsmbios_c.smbios as smbios
+        da = smbios.SmbiosTable().getStructureByType(0xda)
+        supported = struct.unpack("<I", da.getData(7, 4))[0]
+
+        emu = self._emulator(smi.DELL_SMI_EMU_DCDBAS)
+        def check():
+            obj = smi.DellSmi(smi.DELL_SMI_GET_NEW)
+            self.assertEqual(obj.supportedCmds(), supported)
+            for c in range(32):
+                self.assertEqual(obj.classSupported(c), not supported or bool(supported & (1 << c)))
+            self.assertTrue(obj.classSupported(40))
+        inThread(check)
+
+    def testTagCache(self):
+        import struct
+        import libsmbios_c.smi as smi
+        import libsmbios_c.system_info as sysinfo
+        emu = self._emulator(smi.DELL_SMI_EMU_DCDBAS)
+        # the test table has no asset tag, so the chain ends up at smi
+        emu.set_result(11, 0, 0, *struct.unpack("<3i", b"ASSET01\xff\xff\xff\xff\xff"))
+        # no passwords installed, asset tag write succeeds
+        for which in (smi.DELL_SMI_PASSWORD_ADMIN, smi.DELL_SMI_PASSWORD_USER):
+            emu.set_result(which, 3, 0, 0, 0, 0)
+            emu.set_result(which, 0, 1, 0, 0, 0)
+        emu.set_result(11, 1, 0, 0, 0, 0)
+        sysinfo.tag_cache_invalidate()
+        self.addCleanup(sysinfo.tag_cache_invalidate)
+
+        def check():
+            expected = ("ASSET01", sysinfo.SYSINFO_SRC_SMI)
+            self.assertEqual(sysinfo.get_asset_tag_with_source(), expected)
+            self.assertEqual(sysinfo.get_asset_tag_with_source(), expected)
+            self.assertEqual(sysinfo.get_asset_tag(), "ASSET01")
+            self.assertEqual(emu.count(11, 0), 1)
+
+            # cached source not in the mask: look again, smbios only
+            self.assertEqual(sysinfo.get_asset_tag_with_source(sysinfo.SYSINFO_SOURCE_BIT(sysinfo.SYSINFO_SRC_ENCLOSURE)),
+                             ("Not Specified", sysinfo.SYSINFO_SRC_NONE))
+            self.assertEqual(sysinfo.get_asset_tag_with_source(sysinfo.SYSINFO_SOURCE_BIT(sysinfo.SYSINFO_SRC_SMI)), expected)
+            self.assertEqual(emu.count(11, 0), 1)
+
+            # setting the tag drops the cached one
+            self.assertEqual(sysinfo.set_asset_tag(b"ASSET01"), 0)
+            self.assertEqual(sysinfo.get_asset_tag_with_source(), expected)
+            self.assertEqual(emu.count(11, 0), 2)
+        inThread(check)
+
+    def testSecurityContextVerifiesOnce(self):
+        import libsmbios_c.smi as smi
+        emu = self._emulator(smi.DELL_SMI_EMU_DCDBAS)
+        # admin password installed, ascii, max length 32; verify gives key 0x1234
+        emu.set_result(smi.DELL_SMI_PASSWORD_ADMIN, 3, 0, (1 << 24) | (32 << 8), 0, 0)
+        emu.set_result(smi.DELL_SMI_PASSWORD_ADMIN, 0, 0, 0, 0, 0)
+        emu.set_result(smi.DELL_SMI_PASSWORD_ADMIN, 4, 0, 0x1234, 0, 0)
+        def check():
+            sec = smi.SecurityContext(b"secret", b"\x1f\x12")
+            for i in range(10):
+                self.assertEqual(sec.get_key(), 0x1234)
+            self.assertEqual(sec.password_type(), smi.DELL_SMI_PASSWORD_ADMIN)
+            self.assertEqual(sec.password_format(), smi.DELL_SMI_PASSWORD_FMT_ASCII)
+        inThread(check)
+        self.assertEqual(emu.count(smi.DELL_SMI_PASSWORD_ADMIN, 4), 1)
+
+    def _useLoopback(self):
+        # point this thread's default smi object at the built-in loopback
+        # backend. Must happen before the thread issues any other SMI.
+        import libsmbios_c.smi as smi
+        from libsmbios_c import libsmbios_c_DLL as DLL
+        obj = DLL.dell_smi_factory(smi.DELL_SMI_GET_PER_THREAD | smi.DELL_SMI_UNIT_TEST_MODE, None)
+        return ctypes.cast(obj, ctypes.c_void_p).value
+
+    def testThreadStress(self):
+        import libsmbios_c.smi as smi
+        numThreads = 16
+        iterations = 2000
+        errors = []
+        objects = {}
+        allStarted = threading.Barrier(numThreads)
+
+        def worker(n):
+            try:
+                objects[n] = self._useLoopback()
+                if self._useLoopback() != objects[n]:
+                    errors.append("thread %d: got a second default object" % n)
+                allStarted.wait()
+                for i in range(iterations):
+                    select = i & 0xffff
+                    args = (i, n, i * n, 0xffffffff - i)
+                    tag = (n << 16) | select
+                    res = [ r & 0xffffffff for r in smi.simple_ci_smi(n, select, *args) ]
+                    expected = [0] + [a ^ tag for a in args[1:]]
+                    if res != expected:
+                        errors.append("thread %d iteration %d: %s != %s" % (n, i, res, expected))
+                        return
+            except Exception as e:
+                errors.append("thread %d: %s" % (n, e))
+
+        threads = [ threading.Thread(target=worker, args=(n,)) for n in range(numThreads) ]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+        self.assertEqual(errors, [])
+        # all threads were alive at once, so no object can have been reused
+        self.assertEqual(len(set(objects.values())), numThreads)
+
+if __name__ == "__main__":
+    import sys
+    sys.exit(not TestLib.runTests( [TestCase] ))
@@ -0,0 +1,152 @@
+#!/usr/bin/python3
+# vim:expandtab:autoindent:tabstop=4:shiftwidth=4:filetype=python:
+"""
+"""
+
+
+
+import os
+import random
+import sys
+import time
+import TestLib
+
+def getTempDir():
+    import sys
+    return sys.argv[1]
+
+def getTestDir():
+    import sys
+    return sys.argv[2]
+
+TAG_CHARS = "0123456789BCDFGHJKLMNPQRSTVWXYZ"
+
+class TestCase(TestLib.TestCase):
+    def setUp(self):
+        self.random = random.Random(0x5e7a6)
+
+    def randomTag(self, length):
+        return "".join( self.random.choice(TAG_CHARS) for i in range(length) )
+
+    def testSysInfoBatch(self):
+        import csv
+        import json
+        import subprocess
+        tool = os.path.join(self.top_builddir, "out", "smbios-sys-info-lite")
+        if not os.path.exists(tool):
+            self.skipTest("%s is not built" % tool)
+
+        def run(*args):
+            p = subprocess.Popen([tool, "--batch"] + list(args), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+            out, err = p.communicate()
+            return p.returncode, out.decode("utf-8")
+
+        # not in name order: records come out in input order, whatever the
+        # workers finish first
+        dumps = os.path.join(self.top_srcdir, "pyunit", "system_dumps")
+        dirs = [ os.path.join(dumps, d) for d in ("xps9365", "PE1300", "PE0400") ]
+        empty = os.path.join(getTempDir(), "batch-empty")
+        os.mkdir(empty)
+
+        ret, out = run("--jobs", "3", *dirs)
+        self.assertEqual( ret, 0 )
+        records = [ json.loads(line) for line in out.splitlines() ]
+        self.assertEqual( [ r["dir"] for r in records ], dirs )
+        self.assertEqual( [ r.get("error") for r in records ], [None] * 3 )
+        self.assertEqual( (records[0]["system"], records[0]["bios_version"]), ("XPS 13 9365", "1.0.21") )
+        self.assertEqual( (records[1]["bios_version"], records[1]["service_tag"], records[1]["system_id"]), ("A05", "BYYE0", 0x8E) )
+
+        # a directory without a dump fails the run, the others still print
+        ret, out = run("--format", "csv", "--jobs", "2", dirs[1], empty, dirs[0])
+        self.assertEqual( ret, 1 )
+        rows = list(csv.reader(out.splitlines()))
+        self.assertEqual( rows[0], ["dir", "vendor", "system", "bios_version", "service_tag", "asset_tag", "system_id", "oem_system_id", "error"] )
+        self.assertEqual( [ r[0] for r in rows[1:] ], [dirs[1], empty, dirs[0]] )
+        self.assertEqual( rows[1][3:5] + rows[1][6:], ["A05", "BYYE0", "0x008E", "0x008E", ""] )
+        self.assertEqual( rows[2][1:8], [""] * 7 )
+        self.assertTrue( rows[2][8] )
+        self.assertEqual( rows[3][3], "1.0.21" )
+
+        ret, out = run(os.path.join(getTempDir(), "no-such-dump"))
+        self.assertEqual( ret, 1 )
+        self.assertTrue( "error" in json.loads(out) )
+
+        for jobs in ("abc", "-3", "0", "2x"):
+            self.assertEqual( run("--jobs", jobs, dirs[0])[0], 1 )
+
+    def testServiceTagKnownImage(self):
+        import libsmbios_c.system_info as si
+        images, status = si.encode_service_tags(["9XK2M7Q"])
+        self.assertEqual( images, b"\xb9\x39\x11\x4c\xf6" )
+        self.assertEqual( status, [0] )
+        self.assertEqual( si.decode_service_tags(images), [("9XK2M7Q", 0)] )
+
+    def testServiceTagRoundTrip(self):
+        import libsmbios_c.system_info as si
+        for length in range(1, si.SYSINFO_SVC_TAG_LEN + 1):
+            tags = [ self.randomTag(length) for i in range(500) ]
+            images, status = si.encode_service_tags(tags)
+            self.assertEqual( len(images), len(tags) * si.SYSINFO_SVC_TAG_CMOS_LEN )
+            decoded = si.decode_service_tags(images)
+
+            uncoded = length <= si.SYSINFO_SVC_TAG_CMOS_LEN
+            for tag, st, (back, backst) in zip(tags, status, decoded):
+                self.assertEqual( st, si.SYSINFO_SVC_TAG_UNCODED if uncoded else 0 )
+                self.assertEqual( backst, st )
+                # the missing seventh char of a 6 char tag is coded as '0'
+                self.assertEqual( back, tag if length != 6 else tag + "0" )
+
+        # lower case comes back upper case, except for the first char
+        images, status = si.encode_service_tags(["bcdfghj"])
+        self.assertEqual( si.decode_service_tags(images), [("bCDFGHJ", 0)] )
+
+        # every coded image with valid digits survives decode + encode
+        images = bytearray()
+        for i in range(500):
+            word = 0
+            for d in range(6):
+                word = (word << 5) | self.random.randrange(0x1F)
+            images += bytes([0x80 | ord(self.random.choice(TAG_CHARS))]) + word.to_bytes(4, "big")
+        decoded = si.decode_service_tags(bytes(images))
+        self.assertEqual( [ st for tag, st in decoded ], [0] * 500 )
+        self.assertEqual( si.encode_service_tags([ tag for tag, st in decoded ])[0], bytes(images) )
+
+    def testServiceTagValidation(self):
+        import libsmbios_c.system_info as si
+        images, status = si.encode_service_tags(["9XK2M7QZ", "9X!2M7Q", "AB", "9XK2M7Q"])
+        self.assertEqual( status[0], si.SYSINFO_SVC_TAG_TOO_LONG )
+        self.assertEqual( status[1], si.SYSINFO_SVC_TAG_BAD_CHAR )
+        self.assertEqual( status[2], si.SYSINFO_SVC_TAG_UNCODED | si.SYSINFO_SVC_TAG_BAD_CHAR )
+        self.assertEqual( status[3], 0 )
+        decoded = si.decode_service_tags(images)
+        self.assertEqual( decoded[0], ("9XK2M7Q", 0) )
+        self.assertEqual( decoded[1], ("9X02M7Q", 0) )
+
+        # digit 0x1F has no character
+        decoded = si.decode_service_tags(b"\xb9\x39\x11\x4c\xff")
+        self.assertEqual( decoded, [("9XK2M7[", si.SYSINFO_SVC_TAG_BAD_CHAR)] )
+        self.assertRaises( ValueError, si.decode_service_tags, b"\xb9\x39" )
+
+    def testServiceTagThroughput(self):
+        # a benchmark: only prints its rate, so only runs when asked for
+        #   LIBSMBIOS_C_BENCHMARK=1 TEST_STANDALONE_ONLY=1 runtests.sh
+        if not os.environ.get("LIBSMBIOS_C_BENCHMARK"):
+            self.skipTest("set LIBSMBIOS_C_BENCHMARK=1 to run")
+
+        import libsmbios_c.system_info as si
+        count = 200000
+        images, status = si.encode_service_tags([ self.randomTag(7) for i in range(1000) ])
+        images = images * (count // 1000)
+
+        # time the C call alone, not the python list building around it
+        import ctypes
+        tags = ctypes.create_string_buffer(count * (si.SYSINFO_SVC_TAG_LEN + 1))
+        start = time.time()
+        good = si.DLL.sysinfo_decode_service_tags(images, count, tags, None)
+        elapsed = max(time.time() - start, 1e-9)
+        self.assertEqual( good, count )
+        sys.stderr.write("decoded %d service tags in %.4fs (%.1f M/s) ... " % (count, elapsed, count / elapsed / 1e6))
+
+
+if __name__ == "__main__":
+    sys.exit(not TestLib.runTests( [TestCase] ))